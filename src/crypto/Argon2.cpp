@@ -0,0 +1,427 @@
+// Argon2.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#pragma hdrstop
+
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include "Argon2.h"
+#include "SecureMem.h"
+#include "Parallel.h"
+#include "hrtimer.h"
+#ifdef _WIN64
+#include "../crypto/blake2/blake2.h"
+#else
+#include "../crypto/blake2/ref/blake2.h"
+#endif
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+namespace {
+
+const word32
+  ARGON2_QWORDS_IN_BLOCK    = ARGON2_BLOCK_SIZE / 8,
+  ARGON2_ADDRESSES_IN_BLOCK = 128,
+  ARGON2_PREHASH_LENGTH     = 64,
+  ARGON2_TYPE_ID            = 2;
+
+struct Block {
+  word64 v[ARGON2_QWORDS_IN_BLOCK];
+};
+
+inline void store32_le(word8* p, word32 v)
+{
+  p[0] = static_cast<word8>(v);
+  p[1] = static_cast<word8>(v >> 8);
+  p[2] = static_cast<word8>(v >> 16);
+  p[3] = static_cast<word8>(v >> 24);
+}
+
+inline word64 load64_le(const word8* p)
+{
+  word64 v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+inline void store64_le(word8* p, word64 v)
+{
+  for (int i = 0; i < 8; i++, v >>= 8)
+    p[i] = static_cast<word8>(v);
+}
+
+inline void blake2b_update32(blake2b_state* pState, word32 lVal)
+{
+  word8 buf[4];
+  store32_le(buf, lVal);
+  blake2b_update(pState, buf, 4);
+}
+
+// variable-length hash function H' (RFC 9106, section 3.3)
+void blake2b_long(word8* pOut,
+  word32 lOutLen,
+  const word8* pIn,
+  word32 lInLen)
+{
+  blake2b_state state;
+  if (lOutLen <= BLAKE2B_OUTBYTES) {
+    blake2b_init(&state, lOutLen);
+    blake2b_update32(&state, lOutLen);
+    blake2b_update(&state, pIn, lInLen);
+    blake2b_final(&state, pOut, lOutLen);
+  }
+  else {
+    word8 v[BLAKE2B_OUTBYTES];
+    blake2b_init(&state, BLAKE2B_OUTBYTES);
+    blake2b_update32(&state, lOutLen);
+    blake2b_update(&state, pIn, lInLen);
+    blake2b_final(&state, v, BLAKE2B_OUTBYTES);
+    memcpy(pOut, v, BLAKE2B_OUTBYTES / 2);
+    pOut += BLAKE2B_OUTBYTES / 2;
+    word32 lToProduce = lOutLen - BLAKE2B_OUTBYTES / 2;
+    while (lToProduce > BLAKE2B_OUTBYTES) {
+      blake2b(v, BLAKE2B_OUTBYTES, v, BLAKE2B_OUTBYTES, nullptr, 0);
+      memcpy(pOut, v, BLAKE2B_OUTBYTES / 2);
+      pOut += BLAKE2B_OUTBYTES / 2;
+      lToProduce -= BLAKE2B_OUTBYTES / 2;
+    }
+    blake2b(v, lToProduce, v, BLAKE2B_OUTBYTES, nullptr, 0);
+    memcpy(pOut, v, lToProduce);
+    memzero(v, sizeof(v));
+  }
+  memzero(&state, sizeof(state));
+}
+
+inline word64 rotr64(word64 x, int n)
+{
+  return (x >> n) | (x << (64 - n));
+}
+
+inline word64 fBlaMka(word64 x, word64 y)
+{
+  const word64 m = 0xffffffff;
+  return x + y + 2 * ((x & m) * (y & m));
+}
+
+inline void G(word64& a, word64& b, word64& c, word64& d)
+{
+  a = fBlaMka(a, b); d = rotr64(d ^ a, 32);
+  c = fBlaMka(c, d); b = rotr64(b ^ c, 24);
+  a = fBlaMka(a, b); d = rotr64(d ^ a, 16);
+  c = fBlaMka(c, d); b = rotr64(b ^ c, 63);
+}
+
+// BLAKE2b round without message, applied to 16 words with the given indices
+inline void blake2RoundNoMsg(word64* v, const int* pIdx)
+{
+  G(v[pIdx[0]], v[pIdx[4]], v[pIdx[8]],  v[pIdx[12]]);
+  G(v[pIdx[1]], v[pIdx[5]], v[pIdx[9]],  v[pIdx[13]]);
+  G(v[pIdx[2]], v[pIdx[6]], v[pIdx[10]], v[pIdx[14]]);
+  G(v[pIdx[3]], v[pIdx[7]], v[pIdx[11]], v[pIdx[15]]);
+  G(v[pIdx[0]], v[pIdx[5]], v[pIdx[10]], v[pIdx[15]]);
+  G(v[pIdx[1]], v[pIdx[6]], v[pIdx[11]], v[pIdx[12]]);
+  G(v[pIdx[2]], v[pIdx[7]], v[pIdx[8]],  v[pIdx[13]]);
+  G(v[pIdx[3]], v[pIdx[4]], v[pIdx[9]],  v[pIdx[14]]);
+}
+
+// compression function G (RFC 9106, section 3.5):
+// next = (blxWithXor ? next : 0) ^ P(prev ^ ref) ^ (prev ^ ref)
+void fillBlock(const Block& prev,
+  const Block& ref,
+  Block& next,
+  bool blWithXor)
+{
+  Block R, tmp;
+  for (word32 i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++)
+    R.v[i] = tmp.v[i] = prev.v[i] ^ ref.v[i];
+  if (blWithXor) {
+    for (word32 i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++)
+      tmp.v[i] ^= next.v[i];
+  }
+
+  int idx[16];
+
+  // rows
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j < 16; j++)
+      idx[j] = 16 * i + j;
+    blake2RoundNoMsg(R.v, idx);
+  }
+
+  // columns
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j < 8; j++) {
+      idx[2 * j] = 2 * i + 16 * j;
+      idx[2 * j + 1] = 2 * i + 16 * j + 1;
+    }
+    blake2RoundNoMsg(R.v, idx);
+  }
+
+  for (word32 i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++)
+    next.v[i] = tmp.v[i] ^ R.v[i];
+}
+
+struct Instance {
+  Block* Memory;
+  word32 Passes;
+  word32 MemoryBlocks;
+  word32 Lanes;
+  word32 LaneLength;
+  word32 SegmentLength;
+};
+
+word32 indexAlpha(const Instance& inst,
+  word32 lPass,
+  word32 lSlice,
+  word32 lIndex,
+  word32 lPseudoRand,
+  bool blSameLane)
+{
+  word32 lRefAreaSize;
+  if (lPass == 0) {
+    if (lSlice == 0)
+      lRefAreaSize = lIndex - 1; // all but the previous
+    else if (blSameLane)
+      lRefAreaSize = lSlice * inst.SegmentLength + lIndex - 1;
+    else
+      lRefAreaSize = lSlice * inst.SegmentLength - (lIndex == 0 ? 1 : 0);
+  }
+  else {
+    if (blSameLane)
+      lRefAreaSize = inst.LaneLength - inst.SegmentLength + lIndex - 1;
+    else
+      lRefAreaSize = inst.LaneLength - inst.SegmentLength -
+        (lIndex == 0 ? 1 : 0);
+  }
+
+  word64 qRelPos = lPseudoRand;
+  qRelPos = (qRelPos * qRelPos) >> 32;
+  qRelPos = lRefAreaSize - 1 - ((lRefAreaSize * qRelPos) >> 32);
+
+  word32 lStartPos = 0;
+  if (lPass != 0 && lSlice != ARGON2_SYNC_POINTS - 1)
+    lStartPos = (lSlice + 1) * inst.SegmentLength;
+
+  return (lStartPos + qRelPos) % inst.LaneLength;
+}
+
+void nextAddresses(Block& address,
+  Block& input,
+  const Block& zero)
+{
+  input.v[6]++;
+  fillBlock(zero, input, address, false);
+  fillBlock(zero, address, address, false);
+}
+
+void fillSegment(const Instance& inst,
+  word32 lPass,
+  word32 lLane,
+  word32 lSlice)
+{
+  // Argon2id: data-independent addressing in the first half of the first
+  // pass, data-dependent addressing afterwards
+  const bool blDataIndep = lPass == 0 && lSlice < ARGON2_SYNC_POINTS / 2;
+
+  Block addressBlock, inputBlock, zeroBlock;
+  if (blDataIndep) {
+    memset(&zeroBlock, 0, sizeof(Block));
+    memset(&inputBlock, 0, sizeof(Block));
+    inputBlock.v[0] = lPass;
+    inputBlock.v[1] = lLane;
+    inputBlock.v[2] = lSlice;
+    inputBlock.v[3] = inst.MemoryBlocks;
+    inputBlock.v[4] = inst.Passes;
+    inputBlock.v[5] = ARGON2_TYPE_ID;
+  }
+
+  word32 lStartIndex = 0;
+  if (lPass == 0 && lSlice == 0) {
+    // first two blocks of each lane have already been computed
+    lStartIndex = 2;
+    if (blDataIndep)
+      nextAddresses(addressBlock, inputBlock, zeroBlock);
+  }
+
+  word32 lCurrOffset = lLane * inst.LaneLength +
+    lSlice * inst.SegmentLength + lStartIndex;
+  word32 lPrevOffset = (lCurrOffset % inst.LaneLength == 0) ?
+    lCurrOffset + inst.LaneLength - 1 : lCurrOffset - 1;
+
+  for (word32 i = lStartIndex; i < inst.SegmentLength;
+       i++, lCurrOffset++, lPrevOffset++) {
+    if (lCurrOffset % inst.LaneLength == 1)
+      lPrevOffset = lCurrOffset - 1;
+
+    word64 qPseudoRand;
+    if (blDataIndep) {
+      if (i % ARGON2_ADDRESSES_IN_BLOCK == 0)
+        nextAddresses(addressBlock, inputBlock, zeroBlock);
+      qPseudoRand = addressBlock.v[i % ARGON2_ADDRESSES_IN_BLOCK];
+    }
+    else
+      qPseudoRand = inst.Memory[lPrevOffset].v[0];
+
+    word32 lRefLane = (lPass == 0 && lSlice == 0) ? lLane :
+      static_cast<word32>((qPseudoRand >> 32) % inst.Lanes);
+
+    word32 lRefIndex = indexAlpha(inst, lPass, lSlice, i,
+      static_cast<word32>(qPseudoRand), lRefLane == lLane);
+
+    fillBlock(inst.Memory[lPrevOffset],
+      inst.Memory[inst.LaneLength * lRefLane + lRefIndex],
+      inst.Memory[lCurrOffset],
+      lPass != 0);
+  }
+
+  if (blDataIndep) {
+    memzero(&addressBlock, sizeof(Block));
+    memzero(&inputBlock, sizeof(Block));
+  }
+}
+
+}
+
+//---------------------------------------------------------------------------
+void argon2id(const word8* pPassw,
+  word32 lPasswLen,
+  const word8* pSalt,
+  word32 lSaltLen,
+  word8* pDerivedKey,
+  word32 lKeyLen,
+  word32 lTimeCost,
+  word32 lMemoryCost,
+  word32 lParallelism,
+  std::atomic<bool>* pCancelFlag,
+  const word8* pSecret,
+  word32 lSecretLen,
+  const word8* pAssocData,
+  word32 lAssocDataLen)
+{
+  if (lParallelism < ARGON2_MIN_PARALLELISM ||
+      lParallelism > ARGON2_MAX_PARALLELISM)
+    throw std::invalid_argument("Argon2: Invalid degree of parallelism");
+  if (lTimeCost < ARGON2_MIN_TIME_COST)
+    throw std::invalid_argument("Argon2: Invalid time cost");
+  if (lMemoryCost < 2 * ARGON2_SYNC_POINTS * lParallelism)
+    throw std::invalid_argument("Argon2: Memory cost too low");
+  if (lSaltLen < 8)
+    throw std::invalid_argument("Argon2: Salt too short");
+  if (lKeyLen < 4)
+    throw std::invalid_argument("Argon2: Output length too short");
+
+  // compute H_0
+  word8 h0[ARGON2_PREHASH_LENGTH + 8];
+  blake2b_state state;
+  blake2b_init(&state, ARGON2_PREHASH_LENGTH);
+  blake2b_update32(&state, lParallelism);
+  blake2b_update32(&state, lKeyLen);
+  blake2b_update32(&state, lMemoryCost);
+  blake2b_update32(&state, lTimeCost);
+  blake2b_update32(&state, ARGON2_VERSION);
+  blake2b_update32(&state, ARGON2_TYPE_ID);
+  blake2b_update32(&state, lPasswLen);
+  blake2b_update(&state, pPassw, lPasswLen);
+  blake2b_update32(&state, lSaltLen);
+  blake2b_update(&state, pSalt, lSaltLen);
+  blake2b_update32(&state, lSecretLen);
+  if (lSecretLen != 0)
+    blake2b_update(&state, pSecret, lSecretLen);
+  blake2b_update32(&state, lAssocDataLen);
+  if (lAssocDataLen != 0)
+    blake2b_update(&state, pAssocData, lAssocDataLen);
+  blake2b_final(&state, h0, ARGON2_PREHASH_LENGTH);
+  memzero(&state, sizeof(state));
+
+  // round down memory size to a multiple of 4 * lanes
+  Instance inst;
+  inst.Passes = lTimeCost;
+  inst.Lanes = lParallelism;
+  inst.SegmentLength = lMemoryCost / (ARGON2_SYNC_POINTS * lParallelism);
+  inst.LaneLength = inst.SegmentLength * ARGON2_SYNC_POINTS;
+  inst.MemoryBlocks = inst.LaneLength * lParallelism;
+
+  SecureMem<word64> memory(inst.MemoryBlocks * ARGON2_QWORDS_IN_BLOCK);
+  inst.Memory = reinterpret_cast<Block*>(memory.Data());
+
+  // compute first two blocks of each lane
+  word8 blockBytes[ARGON2_BLOCK_SIZE];
+  for (word32 lLane = 0; lLane < inst.Lanes; lLane++) {
+    for (word32 i = 0; i < 2; i++) {
+      store32_le(h0 + ARGON2_PREHASH_LENGTH, i);
+      store32_le(h0 + ARGON2_PREHASH_LENGTH + 4, lLane);
+      blake2b_long(blockBytes, ARGON2_BLOCK_SIZE, h0, sizeof(h0));
+      Block& block = inst.Memory[lLane * inst.LaneLength + i];
+      for (word32 j = 0; j < ARGON2_QWORDS_IN_BLOCK; j++)
+        block.v[j] = load64_le(blockBytes + 8 * j);
+    }
+  }
+  memzero(h0, sizeof(h0));
+
+  // fill memory; segments of the same slice are independent of each other
+  // and computed in parallel
+  for (word32 lPass = 0; lPass < inst.Passes; lPass++) {
+    for (word32 lSlice = 0; lSlice < ARGON2_SYNC_POINTS; lSlice++) {
+      if (pCancelFlag && *pCancelFlag) {
+        memzero(blockBytes, sizeof(blockBytes));
+        return;
+      }
+      ParallelFor(inst.Lanes, [&inst,lPass,lSlice](word32 lLane) {
+        fillSegment(inst, lPass, lLane, lSlice);
+      }, inst.Lanes);
+    }
+  }
+
+  // final block = XOR of last blocks of all lanes
+  Block& finalBlock = inst.Memory[inst.LaneLength - 1];
+  for (word32 lLane = 1; lLane < inst.Lanes; lLane++) {
+    const Block& last = inst.Memory[lLane * inst.LaneLength +
+      inst.LaneLength - 1];
+    for (word32 j = 0; j < ARGON2_QWORDS_IN_BLOCK; j++)
+      finalBlock.v[j] ^= last.v[j];
+  }
+
+  for (word32 j = 0; j < ARGON2_QWORDS_IN_BLOCK; j++)
+    store64_le(blockBytes + 8 * j, finalBlock.v[j]);
+
+  blake2b_long(pDerivedKey, lKeyLen, blockBytes, ARGON2_BLOCK_SIZE);
+
+  memzero(blockBytes, sizeof(blockBytes));
+}
+//---------------------------------------------------------------------------
+word32 argon2id_calibrate(word32 lTargetMs,
+  word32 lMemoryCost,
+  word32 lParallelism)
+{
+  const word8 dummy[32] = { 0 };
+  word8 result[32];
+
+  // passes take approximately the same time, so one pass is sufficient
+  Stopwatch clock;
+  argon2id(dummy, sizeof(dummy), dummy, sizeof(dummy), result,
+    sizeof(result), 1, lMemoryCost, lParallelism);
+  double dPassTime = std::max(clock.ElapsedSeconds(), 1e-6);
+
+  return std::max<word32>(ARGON2_MIN_TIME_COST,
+    static_cast<word32>(lTargetMs / 1000.0 / dPassTime + 0.5));
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+// Argon2.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef Argon2H
+#define Argon2H
+//---------------------------------------------------------------------------
+#include <atomic>
+#include "types.h"
+
+const word32
+  ARGON2_VERSION           = 0x13,
+  ARGON2_MIN_PARALLELISM   = 1,
+  ARGON2_MAX_PARALLELISM   = 255,
+  ARGON2_MIN_TIME_COST     = 1,
+  ARGON2_BLOCK_SIZE        = 1024,
+  ARGON2_SYNC_POINTS       = 4;
+
+// derives a key from a password and salt using Argon2id (RFC 9106);
+// lanes are computed in parallel using the worker pool (see Parallel.h)
+// -> password
+// -> password length in bytes
+// -> salt
+// -> salt length in bytes (at least 8)
+// -> where to store the derived key
+// -> length of derived key in bytes (at least 4)
+// -> time cost (number of passes)
+// -> memory cost in KiB (at least 8 * parallelism)
+// -> degree of parallelism (number of lanes)
+// -> flag to cancel the derivation (optional)
+// -> secret value (optional)
+// -> secret length in bytes
+// -> associated data (optional)
+// -> associated data length in bytes
+// throws std::invalid_argument if parameters are out of range
+void argon2id(const word8* pPassw,
+  word32 lPasswLen,
+  const word8* pSalt,
+  word32 lSaltLen,
+  word8* pDerivedKey,
+  word32 lKeyLen,
+  word32 lTimeCost,
+  word32 lMemoryCost,
+  word32 lParallelism,
+  std::atomic<bool>* pCancelFlag = nullptr,
+  const word8* pSecret = nullptr,
+  word32 lSecretLen = 0,
+  const word8* pAssocData = nullptr,
+  word32 lAssocDataLen = 0);
+
+// determines the number of Argon2id passes that take a certain time on
+// this machine with the given memory cost and parallelism
+// -> target time in milliseconds
+// -> memory cost in KiB
+// -> degree of parallelism
+// <- time cost (number of passes)
+word32 argon2id_calibrate(word32 lTargetMs,
+  word32 lMemoryCost,
+  word32 lParallelism);
+
+#endif
@@ -0,0 +1,412 @@
+// Base64Codec.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#pragma hdrstop
+
+#include <string.h>
+#include <algorithm>
+#ifdef _WIN64
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#include "Base64Codec.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+namespace {
+
+const char BASE64_ENC_MAP[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+const word8 BASE64_INVALID = 0xff;
+
+struct Base64DecodeMap {
+  word8 Map[256];
+
+  Base64DecodeMap()
+  {
+    memset(Map, BASE64_INVALID, sizeof(Map));
+    for (int i = 0; i < 64; i++)
+      Map[static_cast<word8>(BASE64_ENC_MAP[i])] = i;
+  }
+};
+
+const Base64DecodeMap BASE64_DEC_MAP;
+
+// encodes complete 3-byte groups and the final incomplete group (if any)
+char* encodeScalar(char* pDest,
+  const word8* pSrc,
+  word32 lLen)
+{
+  for ( ; lLen >= 3; lLen -= 3, pSrc += 3) {
+    word32 x = (pSrc[0] << 16) | (pSrc[1] << 8) | pSrc[2];
+    *pDest++ = BASE64_ENC_MAP[x >> 18];
+    *pDest++ = BASE64_ENC_MAP[(x >> 12) & 63];
+    *pDest++ = BASE64_ENC_MAP[(x >> 6) & 63];
+    *pDest++ = BASE64_ENC_MAP[x & 63];
+  }
+
+  if (lLen != 0) {
+    word32 x = pSrc[0] << 16;
+    if (lLen == 2)
+      x |= pSrc[1] << 8;
+    *pDest++ = BASE64_ENC_MAP[x >> 18];
+    *pDest++ = BASE64_ENC_MAP[(x >> 12) & 63];
+    *pDest++ = (lLen == 2) ? BASE64_ENC_MAP[(x >> 6) & 63] : '=';
+    *pDest++ = '=';
+  }
+
+  return pDest;
+}
+
+#ifdef _WIN64
+
+// The SIMD routines follow the algorithms by W. Mula and D. Lemire
+// ("Faster Base64 Encoding and Decoding Using AVX2 Instructions"):
+// 3-byte groups are spread to 4 bytes with 6 significant bits each, which
+// are then translated to ASCII by adding an offset depending on the range
+// of the value; decoding reverses these steps and validates the input via
+// nibble lookup tables at the same time.
+
+struct CpuFeatures {
+  bool Sse41 = false;
+  bool Avx2 = false;
+
+  CpuFeatures()
+  {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+      return;
+    Sse41 = c & bit_SSE4_1;
+    const bool blOsXsave = c & bit_OSXSAVE;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+      return;
+    if (blOsXsave && (b & bit_AVX2)) {
+      // check whether OS saves YMM registers
+      word32 lXcr0Lo, lXcr0Hi;
+      asm volatile("xgetbv" : "=a" (lXcr0Lo), "=d" (lXcr0Hi) : "c" (0));
+      Avx2 = (lXcr0Lo & 6) == 6;
+    }
+  }
+};
+
+const CpuFeatures& GetCpuFeatures(void)
+{
+  static const CpuFeatures features;
+  return features;
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i encodeTranslate128(__m128i in)
+{
+  const __m128i lut = _mm_setr_epi8(
+    65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+  __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+  __m128i mask = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+  indices = _mm_sub_epi8(indices, mask);
+  return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+// 12 bytes -> 16 characters per step, reads 16 bytes from the source
+__attribute__((target("sse4.1")))
+void encodeSse41(char*& pDest,
+  const word8*& pSrc,
+  word32& lLen,
+  const word8* pSrcEnd)
+{
+  const __m128i shuffle = _mm_setr_epi8(
+    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+  while (lLen >= 12 && pSrcEnd - pSrc >= 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+    in = _mm_shuffle_epi8(in, shuffle);
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest),
+      encodeTranslate128(_mm_or_si128(t1, t3)));
+    pDest += 16;
+    pSrc += 12;
+    lLen -= 12;
+  }
+}
+
+__attribute__((target("avx2")))
+inline __m256i encodeTranslate256(__m256i in)
+{
+  const __m256i lut = _mm256_setr_epi8(
+    65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+    65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+  __m256i indices = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+  __m256i mask = _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25));
+  indices = _mm256_sub_epi8(indices, mask);
+  return _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, indices));
+}
+
+// 24 bytes -> 32 characters per step, reads 32 bytes from the source
+__attribute__((target("avx2")))
+void encodeAvx2(char*& pDest,
+  const word8*& pSrc,
+  word32& lLen,
+  const word8* pSrcEnd)
+{
+  // bytes 0..11 of each lane are spread to the 16 bytes of the lane; the
+  // input is shifted by 4 bytes, so that the lower lane holds source bytes
+  // 0..11 at positions 4..15 and the upper lane source bytes 12..23
+  const __m256i permute = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+  const __m256i shuffle = _mm256_setr_epi8(
+    5, 4, 6, 5, 8, 7, 9, 8, 11, 10, 12, 11, 14, 13, 15, 14,
+    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+  while (lLen >= 24 && pSrcEnd - pSrc >= 32) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+    in = _mm256_permutevar8x32_epi32(in, permute);
+    in = _mm256_shuffle_epi8(in, shuffle);
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDest),
+      encodeTranslate256(_mm256_or_si256(t1, t3)));
+    pDest += 32;
+    pSrc += 24;
+    lLen -= 24;
+  }
+}
+
+// 16 characters -> 12 bytes per step; stops at the first block containing
+// characters other than A-Z, a-z, 0-9, '+', '/'
+__attribute__((target("sse4.1")))
+void decodeSse41(word8*& pDest,
+  const char*& pSrc,
+  const char* pSrcEnd)
+{
+  const __m128i lutLo = _mm_setr_epi8(
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i lutHi = _mm_setr_epi8(
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lutRoll = _mm_setr_epi8(
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask2f = _mm_set1_epi8(0x2f);
+  const __m128i shuffle = _mm_setr_epi8(
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  word8 buf[16];
+  while (pSrcEnd - pSrc >= 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask2f);
+    __m128i loNibbles = _mm_and_si128(in, mask2f);
+    __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm_testz_si128(lo, hi))
+      break;
+    __m128i eq2f = _mm_cmpeq_epi8(in, mask2f);
+    __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2f, hiNibbles));
+    in = _mm_add_epi8(in, roll);
+    in = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    in = _mm_madd_epi16(in, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(buf),
+      _mm_shuffle_epi8(in, shuffle));
+    memcpy(pDest, buf, 12);
+    pDest += 12;
+    pSrc += 16;
+  }
+}
+
+// 32 characters -> 24 bytes per step (see decodeSse41())
+__attribute__((target("avx2")))
+void decodeAvx2(word8*& pDest,
+  const char*& pSrc,
+  const char* pSrcEnd)
+{
+  const __m256i lutLo = _mm256_setr_epi8(
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lutHi = _mm256_setr_epi8(
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lutRoll = _mm256_setr_epi8(
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask2f = _mm256_set1_epi8(0x2f);
+  const __m256i shuffle = _mm256_setr_epi8(
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+  word8 buf[32];
+  while (pSrcEnd - pSrc >= 32) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+    __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask2f);
+    __m256i loNibbles = _mm256_and_si256(in, mask2f);
+    __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm256_testz_si256(lo, hi))
+      break;
+    __m256i eq2f = _mm256_cmpeq_epi8(in, mask2f);
+    __m256i roll = _mm256_shuffle_epi8(lutRoll,
+      _mm256_add_epi8(eq2f, hiNibbles));
+    in = _mm256_add_epi8(in, roll);
+    in = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+    in = _mm256_madd_epi16(in, _mm256_set1_epi32(0x00011000));
+    in = _mm256_shuffle_epi8(in, shuffle);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf),
+      _mm256_permutevar8x32_epi32(in, permute));
+    memcpy(pDest, buf, 24);
+    pDest += 24;
+    pSrc += 32;
+  }
+}
+
+#endif
+
+// encodes a single line (or the entire data if there are no line breaks)
+char* encodeLine(char* pDest,
+  const word8* pSrc,
+  word32 lLen,
+  const word8* pSrcEnd)
+{
+#ifdef _WIN64
+  if (GetCpuFeatures().Avx2)
+    encodeAvx2(pDest, pSrc, lLen, pSrcEnd);
+  if (GetCpuFeatures().Sse41)
+    encodeSse41(pDest, pSrc, lLen, pSrcEnd);
+#endif
+  return encodeScalar(pDest, pSrc, lLen);
+}
+
+}
+
+//---------------------------------------------------------------------------
+word32 base64EncodedLen(word32 lSrcLen,
+  word32 lLineLen)
+{
+  word32 lQuads = (lSrcLen + 2) / 3;
+  word32 lLen = 4 * lQuads;
+  if (lLineLen != 0 && lQuads != 0)
+    lLen += (lQuads - 1) / ((lLineLen + 3) / 4) * 2;
+  return lLen;
+}
+//---------------------------------------------------------------------------
+word32 base64Encode(char* pDest,
+  const word8* pSrc,
+  word32 lSrcLen,
+  word32 lLineLen)
+{
+  const word8* pSrcEnd = pSrc + lSrcLen;
+  const word32 lLineBytes = (lLineLen != 0) ? (lLineLen + 3) / 4 * 3 :
+    lSrcLen;
+  char* p = pDest;
+
+  for (word32 lPos = 0; lPos < lSrcLen; lPos += lLineBytes) {
+    if (lPos != 0) {
+      *p++ = '\r';
+      *p++ = '\n';
+    }
+    p = encodeLine(p, pSrc + lPos, std::min(lLineBytes, lSrcLen - lPos),
+      pSrcEnd);
+  }
+
+  *p = '\0';
+
+  return p - pDest;
+}
+//---------------------------------------------------------------------------
+int base64Decode(word8* pDest,
+  const char* pSrc,
+  word32 lSrcLen)
+{
+  const char* pSrcEnd = pSrc + lSrcLen;
+  word8* p = pDest;
+  word32 lAcc = 0, lChars = 0, lPad = 0;
+
+  while (pSrc < pSrcEnd) {
+#ifdef _WIN64
+    // use SIMD routines only at group boundaries
+    if (lChars == 0 && lPad == 0) {
+      if (GetCpuFeatures().Avx2)
+        decodeAvx2(p, pSrc, pSrcEnd);
+      if (GetCpuFeatures().Sse41)
+        decodeSse41(p, pSrc, pSrcEnd);
+      if (pSrc == pSrcEnd)
+        break;
+    }
+#endif
+
+    word8 c = *pSrc++;
+
+    if (c == '\n')
+      continue;
+
+    if (c == '\r') {
+      if (pSrc == pSrcEnd || *pSrc != '\n')
+        return -1;
+      pSrc++;
+      continue;
+    }
+
+    if (c == ' ') {
+      // spaces are only allowed at the end of a line
+      while (pSrc < pSrcEnd && *pSrc == ' ')
+        pSrc++;
+      if (pSrc < pSrcEnd && *pSrc != '\r' && *pSrc != '\n')
+        return -1;
+      continue;
+    }
+
+    word32 lValue;
+    if (c == '=') {
+      if (++lPad > 2)
+        return -1;
+      lValue = 0;
+    }
+    else {
+      lValue = BASE64_DEC_MAP.Map[c];
+      // no data characters allowed after padding
+      if (lValue == BASE64_INVALID || lPad != 0)
+        return -1;
+    }
+
+    lAcc = (lAcc << 6) | lValue;
+
+    if (++lChars == 4) {
+      *p++ = static_cast<word8>(lAcc >> 16);
+      if (lPad < 2)
+        *p++ = static_cast<word8>(lAcc >> 8);
+      if (lPad < 1)
+        *p++ = static_cast<word8>(lAcc);
+      lAcc = lChars = 0;
+    }
+  }
+
+  // incomplete group?
+  if (lChars != 0)
+    return -1;
+
+  return p - pDest;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+// Base64Codec.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef Base64CodecH
+#define Base64CodecH
+//---------------------------------------------------------------------------
+#include "types.h"
+
+// Base64 encoder/decoder processing 24 (AVX2) or 12 (SSE4.1) bytes at once
+// if the processor supports it; the output is identical to that of the
+// polarssl functions base64_encode() and base64_decode(), but the buffer
+// sizes can be computed in advance without a second pass over the data.
+
+// returns the exact length of the base64-encoded data
+// -> length of the binary data in bytes
+// -> max. number of characters per line (rounded up to a multiple of 4);
+//    lines are separated by "\r\n" (0 = no line breaks)
+// <- length in characters (without terminating zero)
+word32 base64EncodedLen(word32 lSrcLen,
+  word32 lLineLen = 0);
+
+// returns the max. length of the data resulting from decoding a base64
+// string (the actual length may be shorter due to line breaks and padding)
+// -> length of the base64 string
+// <- length in bytes
+inline word32 base64DecodedMaxLen(word32 lSrcLen)
+{
+  return lSrcLen / 4 * 3;
+}
+
+// encodes binary data as base64 string
+// -> destination buffer (must provide base64EncodedLen() + 1 characters)
+// -> binary data
+// -> length of the binary data
+// -> max. number of characters per line (see base64EncodedLen())
+// <- number of characters written (without terminating zero)
+word32 base64Encode(char* pDest,
+  const word8* pSrc,
+  word32 lSrcLen,
+  word32 lLineLen = 0);
+
+// decodes a base64 string; line breaks ("\r\n" or "\n") are skipped,
+// spaces are allowed only at the end of a line
+// -> destination buffer (must provide base64DecodedMaxLen() bytes)
+// -> base64 string
+// -> length of the base64 string
+// <- number of bytes written, or -1 if the string is not valid base64
+int base64Decode(word8* pDest,
+  const char* pSrc,
+  word32 lSrcLen);
+
+#endif
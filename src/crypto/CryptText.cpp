@@ -20,15 +20,20 @@
 //---------------------------------------------------------------------------
 #include <vcl.h>
 #include <clipbrd.hpp>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
 #pragma hdrstop
 
 #include "CryptText.h"
 #include "aes.h"
 #include "sha256.h"
-#include "base64.h"
+#include "Base64Codec.h"
 #include "minilzo.h"
 #include "Util.h"
 #include "CryptUtil.h"
+#include "Parallel.h"
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
 
@@ -46,6 +51,37 @@ HMAC_LENGTH        = 32,
 HEADER_SIZE        = sizeof(CryptTextHeader),
 BASE64_LINE_LENGTH = 76;
 
+static const word8
+CRYPTFILE_MAGIC[4] = { 'P', 'W', 'G', 'F' };
+
+struct CryptFileHeader {
+  word8 Magic[4];
+  word8 Version;
+  word8 Reserved[3];
+  word32 ChunkSize;
+  word32 KdfIterations;
+  word8 Salt[16];
+};
+
+struct CryptFileChunkHeader {
+  word32 PlainSize;
+  word32 DataSize;
+  word8 Flags;
+  word8 Reserved[3];
+};
+
+static const word8
+CRYPTFILE_VERSION          = 1,
+CRYPTFILE_CHUNK_COMPRESSED = 1,
+CRYPTFILE_CHUNK_LAST       = 2;
+
+static const word32
+CRYPTFILE_CHUNK_SIZE         = 1048576, // 1 MB
+CRYPTFILE_MAX_CHUNK_SIZE     = 16777216,
+CRYPTFILE_KDF_ITERATIONS     = 8192,
+CRYPTFILE_MAX_KDF_ITERATIONS = 16777216,
+CRYPTFILE_MAX_BATCH_SIZE     = 16;
+
 //---------------------------------------------------------------------------
 static void initCrypto(aes_context* pCryptCtx,
   sha256_context* pHashCtx,
@@ -192,18 +228,13 @@ int EncryptText(const SecureWString* psText,
 
     word32 lConvertLen = 16 + lCryptLen;
 
-    // get the required base64 buffer size
-    size_t outBufSize = 0;
-    base64_encode(nullptr, &outBufSize, nullptr, lConvertLen, BASE64_LINE_LENGTH);
-
     // create a new buffer for base64
-    SecureMem<word8> outBuf(outBufSize);
-    base64_encode(outBuf, &outBufSize, buf, lConvertLen, BASE64_LINE_LENGTH);
-
-    //outBuf.back() = '\0';
+    SecureAnsiString asOutBuf(base64EncodedLen(lConvertLen,
+      BASE64_LINE_LENGTH) + 1);
+    base64Encode(asOutBuf, buf, lConvertLen, BASE64_LINE_LENGTH);
 
     // copy the output buffer to the clipboard
-    SetClipboardTextBufAnsi(reinterpret_cast<const char*>(outBuf.c_str()));
+    SetClipboardTextBufAnsi(asOutBuf.c_str());
   }
   catch (EClipboardException& e) {
     return CRYPTTEXT_ERROR_CLIPBOARD;
@@ -249,14 +280,16 @@ int DecryptText(const SecureWString* psText,
     }
 
     // base64-decode the text
-    size_t bufSize = 0;
     word32 lMinLen = (nVersion == 0) ? 48 : 64;
-    if (base64_decode(nullptr, &bufSize, asText.Bytes(), lTextLen)
-          == POLARSSL_ERR_BASE64_INVALID_CHARACTER || bufSize < lMinLen)
+    if (base64DecodedMaxLen(lTextLen) < lMinLen)
+      return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+
+    SecureMem<word8> buf(base64DecodedMaxLen(lTextLen));
+    int nDecodedLen = base64Decode(buf, asText, lTextLen);
+    if (nDecodedLen < static_cast<int>(lMinLen))
       return CRYPTTEXT_ERROR_TEXTCORRUPTED;
 
-    SecureMem<word8> buf(bufSize);
-    base64_decode(buf, &bufSize, asText.Bytes(), lTextLen);
+    size_t bufSize = nDecodedLen;
 
     asText.Clear();
 
@@ -403,4 +436,382 @@ int DecryptText(const SecureWString* psText,
   return CRYPTTEXT_OK;
 }
 //---------------------------------------------------------------------------
+static word32 getMaxChunkDataSize(word32 lChunkSize)
+{
+  // worst-case expansion of LZO for incompressible data
+  return lChunkSize + lChunkSize / 16 + 64 + 3;
+}
+//---------------------------------------------------------------------------
+static void deriveFileKeys(const word8* pPassw,
+  int nPasswLen,
+  const CryptFileHeader& header,
+  word8* pEncKey,
+  word8* pMacKey)
+{
+  SecureMem<word8> masterKey(32);
+  pbkdf2_256bit(pPassw, nPasswLen, header.Salt, sizeof(header.Salt),
+    masterKey, header.KdfIterations);
+
+  sha256_hmac(masterKey, 32, reinterpret_cast<const word8*>("enc"), 3,
+    pEncKey, 0);
+  sha256_hmac(masterKey, 32, reinterpret_cast<const word8*>("mac"), 3,
+    pMacKey, 0);
+}
+//---------------------------------------------------------------------------
+static void computeChunkMac(const word8* pMacKey,
+  word64 qChunkIndex,
+  const CryptFileChunkHeader& chunkHeader,
+  const word8* pData,
+  word8* pMac)
+{
+  // include chunk index to prevent chunks from being swapped
+  SecureMem<sha256_context> hashCtx(1);
+  sha256_init(hashCtx);
+  sha256_hmac_starts(hashCtx, pMacKey, 32, 0);
+  sha256_hmac_update(hashCtx, reinterpret_cast<const word8*>(&qChunkIndex), 8);
+  sha256_hmac_update(hashCtx, reinterpret_cast<const word8*>(&chunkHeader),
+    sizeof(CryptFileChunkHeader));
+  sha256_hmac_update(hashCtx, pData, chunkHeader.DataSize);
+  sha256_hmac_finish(hashCtx, pMac);
+}
+//---------------------------------------------------------------------------
+static void cryptChunk(aes_context* pCryptCtx,
+  word64 qChunkIndex,
+  word8* pData,
+  word32 lDataLen)
+{
+  // the chunk index occupies the upper 8 bytes of the counter block,
+  // the block counter within the chunk runs in the lower 8 bytes
+  word8 nonce[16], streamBlock[16];
+  memcpy(nonce, &qChunkIndex, 8);
+  memset(nonce + 8, 0, 8);
+
+  size_t ncOffset = 0;
+  aes_crypt_ctr(pCryptCtx, lDataLen, &ncOffset, nonce, streamBlock,
+    pData, pData);
+
+  memzero(streamBlock, sizeof(streamBlock));
+}
+//---------------------------------------------------------------------------
+static int encryptFileChunks(TStream* pSrcFile,
+  TStream* pDestFile,
+  const word8* pPassw,
+  int nPasswLen,
+  RandomGenerator& randGen,
+  const std::function<bool(word64, word64)>& progressFunc)
+{
+  const word64 qSrcSize = pSrcFile->Size;
+
+  // an empty file still gets one (empty) chunk carrying the "last" flag
+  const word64 qNumChunks = std::max<word64>(1,
+    (qSrcSize + CRYPTFILE_CHUNK_SIZE - 1) / CRYPTFILE_CHUNK_SIZE);
+
+  CryptFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.Magic, CRYPTFILE_MAGIC, sizeof(CRYPTFILE_MAGIC));
+  header.Version = CRYPTFILE_VERSION;
+  header.ChunkSize = CRYPTFILE_CHUNK_SIZE;
+  header.KdfIterations = CRYPTFILE_KDF_ITERATIONS;
+  randGen.GetData(header.Salt, sizeof(header.Salt));
+
+  SecureMem<word8> encKey(32), macKey(32);
+  deriveFileKeys(pPassw, nPasswLen, header, encKey, macKey);
+
+  SecureMem<aes_context> cryptCtx(1);
+  aes_setkey_enc(cryptCtx, encKey, 256);
+  encKey.Clear();
+
+  word8 mac[32];
+  sha256_hmac(macKey, 32, reinterpret_cast<const word8*>(&header),
+    sizeof(header), mac, 0);
+
+  pDestFile->WriteBuffer(&header, sizeof(header));
+  pDestFile->WriteBuffer(mac, sizeof(mac));
+
+  // process a few chunks per thread in each batch, so that all threads
+  // are kept busy while memory consumption remains constant
+  const word32 lBatchSize = std::min(2 * GetNumWorkerThreads(),
+    CRYPTFILE_MAX_BATCH_SIZE);
+  const word32 lMaxDataSize = getMaxChunkDataSize(CRYPTFILE_CHUNK_SIZE);
+
+  SecureMem<word8> plainBuf(lBatchSize * CRYPTFILE_CHUNK_SIZE),
+    dataBuf(lBatchSize * lMaxDataSize),
+    workBuf(lBatchSize * LZO1X_1_MEM_COMPRESS),
+    macBuf(lBatchSize * 32);
+  std::vector<CryptFileChunkHeader> chunkHeaders(lBatchSize);
+
+  word64 qChunk = 0;
+  while (qChunk < qNumChunks) {
+    word32 lNumSlots = static_cast<word32>(std::min<word64>(lBatchSize,
+      qNumChunks - qChunk));
+
+    // read the plaintext chunks sequentially
+    for (word32 i = 0; i < lNumSlots; i++) {
+      word64 qPos = (qChunk + i) * CRYPTFILE_CHUNK_SIZE;
+      auto& chunkHeader = chunkHeaders[i];
+      memset(&chunkHeader, 0, sizeof(CryptFileChunkHeader));
+      chunkHeader.PlainSize = static_cast<word32>(std::min<word64>(
+        CRYPTFILE_CHUNK_SIZE, qSrcSize - qPos));
+      if (qChunk + i == qNumChunks - 1)
+        chunkHeader.Flags = CRYPTFILE_CHUNK_LAST;
+      pSrcFile->ReadBuffer(plainBuf.Data() + i * CRYPTFILE_CHUNK_SIZE,
+        chunkHeader.PlainSize);
+    }
+
+    ParallelFor(lNumSlots, [&](word32 i) {
+      auto& chunkHeader = chunkHeaders[i];
+      const word8* pPlain = plainBuf.Data() + i * CRYPTFILE_CHUNK_SIZE;
+      word8* pData = dataBuf.Data() + i * lMaxDataSize;
+
+      lzo_uint comprLen = 0;
+      if (chunkHeader.PlainSize != 0)
+        lzo1x_1_compress(pPlain, chunkHeader.PlainSize, pData, &comprLen,
+          workBuf.Data() + i * LZO1X_1_MEM_COMPRESS);
+
+      if (comprLen != 0 && comprLen < chunkHeader.PlainSize) {
+        chunkHeader.DataSize = comprLen;
+        chunkHeader.Flags |= CRYPTFILE_CHUNK_COMPRESSED;
+      }
+      else {
+        // store incompressible data as is
+        memcpy(pData, pPlain, chunkHeader.PlainSize);
+        chunkHeader.DataSize = chunkHeader.PlainSize;
+      }
+
+      cryptChunk(cryptCtx, qChunk + i, pData, chunkHeader.DataSize);
+      computeChunkMac(macKey, qChunk + i, chunkHeader, pData,
+        macBuf.Data() + i * 32);
+    });
+
+    // write the encrypted chunks in their original order
+    for (word32 i = 0; i < lNumSlots; i++) {
+      const auto& chunkHeader = chunkHeaders[i];
+      pDestFile->WriteBuffer(&chunkHeader, sizeof(CryptFileChunkHeader));
+      pDestFile->WriteBuffer(dataBuf.Data() + i * lMaxDataSize,
+        chunkHeader.DataSize);
+      pDestFile->WriteBuffer(macBuf.Data() + i * 32, 32);
+    }
+
+    qChunk += lNumSlots;
+
+    if (progressFunc && !progressFunc(pSrcFile->Position, qSrcSize))
+      return CRYPTTEXT_ERROR_CANCELLED;
+  }
+
+  return CRYPTTEXT_OK;
+}
+//---------------------------------------------------------------------------
+static int decryptFileChunks(TStream* pSrcFile,
+  TStream* pDestFile,
+  const word8* pPassw,
+  int nPasswLen,
+  const std::function<bool(word64, word64)>& progressFunc)
+{
+  const word64 qSrcSize = pSrcFile->Size;
+
+  CryptFileHeader header;
+  word8 mac[32];
+
+  if (qSrcSize < sizeof(header) + sizeof(mac))
+    return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+
+  pSrcFile->ReadBuffer(&header, sizeof(header));
+  pSrcFile->ReadBuffer(mac, sizeof(mac));
+
+  if (memcmp(header.Magic, CRYPTFILE_MAGIC, sizeof(CRYPTFILE_MAGIC)) != 0 ||
+      header.Version != CRYPTFILE_VERSION ||
+      header.ChunkSize == 0 || header.ChunkSize > CRYPTFILE_MAX_CHUNK_SIZE ||
+      header.KdfIterations == 0 ||
+      header.KdfIterations > CRYPTFILE_MAX_KDF_ITERATIONS)
+    return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+
+  SecureMem<word8> encKey(32), macKey(32);
+  deriveFileKeys(pPassw, nPasswLen, header, encKey, macKey);
+
+  word8 headerMac[32];
+  sha256_hmac(macKey, 32, reinterpret_cast<const word8*>(&header),
+    sizeof(header), headerMac, 0);
+
+  if (memcmp(mac, headerMac, sizeof(mac)) != 0)
+    return CRYPTTEXT_ERROR_BADKEY;
+
+  // CTR mode uses the encryption key schedule for both directions
+  SecureMem<aes_context> cryptCtx(1);
+  aes_setkey_enc(cryptCtx, encKey, 256);
+  encKey.Clear();
 
+  const word32 lBatchSize = std::min(2 * GetNumWorkerThreads(),
+    CRYPTFILE_MAX_BATCH_SIZE);
+  const word32 lMaxDataSize = getMaxChunkDataSize(header.ChunkSize);
+
+  SecureMem<word8> plainBuf(lBatchSize * header.ChunkSize),
+    dataBuf(lBatchSize * lMaxDataSize),
+    macBuf(lBatchSize * 32);
+  std::vector<CryptFileChunkHeader> chunkHeaders(lBatchSize);
+
+  enum {
+    CHUNK_OK,
+    CHUNK_INVALID_MAC,
+    CHUNK_DECOMPRESSION_ERROR
+  };
+  std::vector<int> chunkStatus(lBatchSize);
+
+  word64 qChunk = 0;
+  bool blLastChunk = false;
+
+  while (!blLastChunk) {
+    word32 lNumSlots = 0;
+
+    // read and check the chunk headers sequentially
+    while (lNumSlots < lBatchSize && !blLastChunk) {
+      auto& chunkHeader = chunkHeaders[lNumSlots];
+
+      if (qSrcSize - pSrcFile->Position < sizeof(CryptFileChunkHeader))
+        return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+
+      pSrcFile->ReadBuffer(&chunkHeader, sizeof(CryptFileChunkHeader));
+
+      blLastChunk = chunkHeader.Flags & CRYPTFILE_CHUNK_LAST;
+
+      if ((chunkHeader.Flags & ~(CRYPTFILE_CHUNK_COMPRESSED |
+            CRYPTFILE_CHUNK_LAST)) != 0 ||
+          chunkHeader.PlainSize > header.ChunkSize ||
+          (!blLastChunk && chunkHeader.PlainSize != header.ChunkSize) ||
+          chunkHeader.DataSize > lMaxDataSize ||
+          (!(chunkHeader.Flags & CRYPTFILE_CHUNK_COMPRESSED) &&
+           chunkHeader.DataSize != chunkHeader.PlainSize) ||
+          qSrcSize - pSrcFile->Position < chunkHeader.DataSize + 32)
+        return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+
+      pSrcFile->ReadBuffer(dataBuf.Data() + lNumSlots * lMaxDataSize,
+        chunkHeader.DataSize);
+      pSrcFile->ReadBuffer(macBuf.Data() + lNumSlots * 32, 32);
+
+      lNumSlots++;
+    }
+
+    ParallelFor(lNumSlots, [&](word32 i) {
+      const auto& chunkHeader = chunkHeaders[i];
+      word8* pData = dataBuf.Data() + i * lMaxDataSize;
+
+      word8 chunkMac[32];
+      computeChunkMac(macKey, qChunk + i, chunkHeader, pData, chunkMac);
+      if (memcmp(chunkMac, macBuf.Data() + i * 32, 32) != 0) {
+        chunkStatus[i] = CHUNK_INVALID_MAC;
+        return;
+      }
+
+      cryptChunk(cryptCtx, qChunk + i, pData, chunkHeader.DataSize);
+
+      if (chunkHeader.Flags & CRYPTFILE_CHUNK_COMPRESSED) {
+        lzo_uint decomprLen = chunkHeader.PlainSize;
+        if (lzo1x_decompress_safe(pData, chunkHeader.DataSize,
+              plainBuf.Data() + i * header.ChunkSize, &decomprLen,
+              nullptr) != LZO_E_OK ||
+            decomprLen != chunkHeader.PlainSize) {
+          chunkStatus[i] = CHUNK_DECOMPRESSION_ERROR;
+          return;
+        }
+      }
+
+      chunkStatus[i] = CHUNK_OK;
+    });
+
+    // write the plaintext chunks in their original order
+    for (word32 i = 0; i < lNumSlots; i++) {
+      switch (chunkStatus[i]) {
+      case CHUNK_INVALID_MAC:
+        return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+      case CHUNK_DECOMPRESSION_ERROR:
+        return CRYPTTEXT_ERROR_DECOMPRFAILED;
+      }
+
+      const auto& chunkHeader = chunkHeaders[i];
+      if (chunkHeader.Flags & CRYPTFILE_CHUNK_COMPRESSED)
+        pDestFile->WriteBuffer(plainBuf.Data() + i * header.ChunkSize,
+          chunkHeader.PlainSize);
+      else
+        pDestFile->WriteBuffer(dataBuf.Data() + i * lMaxDataSize,
+          chunkHeader.PlainSize);
+    }
+
+    qChunk += lNumSlots;
+
+    if (progressFunc && !progressFunc(pSrcFile->Position, qSrcSize))
+      return CRYPTTEXT_ERROR_CANCELLED;
+  }
+
+  // no data must follow the last chunk
+  if (pSrcFile->Position != qSrcSize)
+    return CRYPTTEXT_ERROR_TEXTCORRUPTED;
+
+  return CRYPTTEXT_OK;
+}
+//---------------------------------------------------------------------------
+static int cryptFile(const WString& sSrcFileName,
+  const WString& sDestFileName,
+  const std::function<int(TStream*, TStream*)>& processFunc)
+{
+  int nResult = CRYPTTEXT_OK;
+  bool blDestCreated = false;
+
+  try {
+    std::unique_ptr<TFileStream> pSrcFile(new TFileStream(sSrcFileName,
+        fmOpenRead | fmShareDenyWrite));
+    std::unique_ptr<TFileStream> pDestFile(new TFileStream(sDestFileName,
+        fmCreate));
+    blDestCreated = true;
+
+    nResult = processFunc(pSrcFile.get(), pDestFile.get());
+  }
+  catch (EStreamError& e) {
+    nResult = CRYPTTEXT_ERROR_FILEIO;
+  }
+  catch (std::bad_alloc& e) {
+    nResult = CRYPTTEXT_ERROR_OUTOFMEMORY;
+  }
+  catch (EOutOfMemory& e) {
+    nResult = CRYPTTEXT_ERROR_OUTOFMEMORY;
+  }
+  catch (...) {
+    if (blDestCreated)
+      DeleteFile(sDestFileName.c_str());
+    throw;
+  }
+
+  // don't leave incomplete or unauthenticated data behind
+  if (nResult != CRYPTTEXT_OK && blDestCreated)
+    DeleteFile(sDestFileName.c_str());
+
+  return nResult;
+}
+//---------------------------------------------------------------------------
+int EncryptFileChunked(const WString& sSrcFileName,
+  const WString& sDestFileName,
+  const word8* pPassw,
+  int nPasswLen,
+  RandomGenerator& randGen,
+  const std::function<bool(word64, word64)>& progressFunc)
+{
+  return cryptFile(sSrcFileName, sDestFileName,
+    [&](TStream* pSrcFile, TStream* pDestFile)
+    {
+      return encryptFileChunks(pSrcFile, pDestFile, pPassw, nPasswLen,
+        randGen, progressFunc);
+    });
+}
+//---------------------------------------------------------------------------
+int DecryptFileChunked(const WString& sSrcFileName,
+  const WString& sDestFileName,
+  const word8* pPassw,
+  int nPasswLen,
+  const std::function<bool(word64, word64)>& progressFunc)
+{
+  return cryptFile(sSrcFileName, sDestFileName,
+    [&](TStream* pSrcFile, TStream* pDestFile)
+    {
+      return decryptFileChunks(pSrcFile, pDestFile, pPassw, nPasswLen,
+        progressFunc);
+    });
+}
+//---------------------------------------------------------------------------
@@ -21,6 +21,7 @@
 #ifndef CryptTextH
 #define CryptTextH
 //---------------------------------------------------------------------------
+#include <functional>
 #include "RandomGenerator.h"
 #include "SecureMem.h"
 
@@ -35,7 +36,9 @@ CRYPTTEXT_ERROR_TEXTTOOLONG   = 3,
 CRYPTTEXT_ERROR_OUTOFMEMORY   = 4,
 CRYPTTEXT_ERROR_TEXTCORRUPTED = 5,
 CRYPTTEXT_ERROR_BADKEY        = 6,
-CRYPTTEXT_ERROR_DECOMPRFAILED = 7;
+CRYPTTEXT_ERROR_DECOMPRFAILED = 7,
+CRYPTTEXT_ERROR_FILEIO        = 8,
+CRYPTTEXT_ERROR_CANCELLED     = 9;
 
 const word32
 CRYPTTEXT_MAXTEXTBYTES = 134217728; // 128MB
@@ -89,4 +92,55 @@ int DecryptText(const SecureWString* psText,
   int nPasswLen,
   int nVersion = CRYPTTEXT_VERSION);
 
+// Encrypts files of arbitrary size in a binary chunked format, using a
+// constant amount of memory. The file is split into chunks of 1 MB, and each
+// chunk is compressed with LZO (stored uncompressed if LZO does not reduce
+// its size), encrypted with AES in CTR mode and authenticated with an
+// HMAC-SHA256 independently of the other chunks, which allows processing
+// several chunks in parallel. The password is hashed with PBKDF2 and a
+// random salt; separate keys for encryption and authentication are derived
+// from the result.
+// Encrypted files have the following structure:
+//
+//   [file header]  [HMAC]   [chunk 0]  [chunk 1]  ...  [chunk N-1]
+//     32 bytes    32 bytes
+//
+// Each chunk consists of a 12-byte chunk header (plaintext size, size of the
+// stored data, flags), the encrypted data and an HMAC computed from the chunk
+// index, the chunk header and the encrypted data. The HMAC of the file header
+// is used to detect a wrong password. The last chunk is marked with a flag,
+// so that truncated files are detected.
+// Both functions may be called from a background thread. The progress
+// function (optional) is called after each batch of chunks with the number
+// of bytes of the source file processed so far and the size of the source
+// file; if it returns false, the operation is cancelled.
+
+// encrypts a file
+// -> name of the source file
+// -> name of the destination file (will be overwritten)
+// -> password
+// -> password length
+// -> random generator to create the salt
+// -> progress function
+// <- error code
+int EncryptFileChunked(const WString& sSrcFileName,
+  const WString& sDestFileName,
+  const word8* pPassw,
+  int nPasswLen,
+  RandomGenerator& randGen,
+  const std::function<bool(word64, word64)>& progressFunc = nullptr);
+
+// decrypts a file which was encrypted with EncryptFileChunked()
+// -> name of the source file
+// -> name of the destination file (will be overwritten)
+// -> password
+// -> password length
+// -> progress function
+// <- error code
+int DecryptFileChunked(const WString& sSrcFileName,
+  const WString& sDestFileName,
+  const word8* pPassw,
+  int nPasswLen,
+  const std::function<bool(word64, word64)>& progressFunc = nullptr);
+
 #endif
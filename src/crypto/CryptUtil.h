@@ -32,6 +32,7 @@
 // -> salt length in bytes
 // -> where to store the derived key
 // -> number of iterations (default: 8192)
+// -> flag to cancel the derivation (optional)
 void pbkdf2_256bit(const word8* pPassw,
   word32 lPasswLen,
   const word8* pSalt,
@@ -40,6 +41,39 @@ void pbkdf2_256bit(const word8* pPassw,
   word32 lIterations = 8192,
   std::atomic<bool>* pCancelFlag = nullptr);
 
+// parameters of a single key derivation for pbkdf2_256bit_multi()
+struct Pbkdf2Params {
+  const word8* Passw;
+  word32 PasswLen;
+  const word8* Salt;
+  word32 SaltLen;
+  word8* DerivedKey;
+};
+
+// derives multiple 256-bit keys with the same number of iterations,
+// processing several keys simultaneously if SIMD instructions (SSE2/AVX2)
+// are available; results are identical to those of pbkdf2_256bit()
+// -> array of parameters
+// -> number of keys to derive
+// -> number of iterations
+// -> flag to cancel the derivation (optional)
+void pbkdf2_256bit_multi(const Pbkdf2Params* pParams,
+  word32 lNumKeys,
+  word32 lIterations,
+  std::atomic<bool>* pCancelFlag = nullptr);
+
+// checks whether pbkdf2_256bit_multi() derives a batch of keys in parallel
+// SIMD lanes on this machine (otherwise, the keys are derived sequentially)
+// -> number of keys in the batch
+// <- true if keys are derived in parallel
+bool pbkdf2_multi_is_parallel(word32 lNumKeys);
+
+// determines the number of PBKDF2 iterations that take a certain time
+// on this machine by running a short benchmark
+// -> target time in milliseconds
+// <- number of iterations
+word32 pbkdf2_calibrate(word32 lTargetMs);
+
 template<int Nbits> void incrementCounter(word8* pCounter)
 {
   for (int i = Nbits/8-1; i >= 0 && ++pCounter[i] == 0; i--);
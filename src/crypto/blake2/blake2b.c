@@ -13,6 +13,7 @@
    https://blake2.net.
 */
 
+#ifdef _WIN64
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -371,3 +372,5 @@ fail:
   return -1;
 }
 #endif
+
+#endif
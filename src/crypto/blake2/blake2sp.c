@@ -13,6 +13,7 @@
    https://blake2.net.
 */
 
+#ifdef _WIN64
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -356,3 +357,5 @@ fail:
   return -1;
 }
 #endif
+
+#endif
@@ -13,6 +13,7 @@
    https://blake2.net.
 */
 
+#ifndef _WIN64
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -377,3 +378,5 @@ fail:
   return -1;
 }
 #endif
+
+#endif
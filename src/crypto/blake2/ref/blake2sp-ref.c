@@ -13,6 +13,7 @@
    https://blake2.net.
 */
 
+#ifndef _WIN64
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -357,3 +358,5 @@ fail:
   return -1;
 }
 #endif
+
+#endif
@@ -87,13 +87,7 @@ __fastcall TConfigurationDlg::TConfigurationDlg(TComponent* Owner)
     AppIconList->ItemsEx->AddItem(p.first, i++, -1, -1, -1, nullptr);
   }
 
-  for (i = 0; i < NUM_RANDOM_POOL_CIPHERS; i++) {
-    WString sCipher = TRLFormat("%1 (%2-bit key, operates on %3-bit blocks)",
-      { RANDOM_POOL_CIPHER_NAMES[i],
-        IntToStr(RANDOM_POOL_CIPHER_INFO[i][0]),
-        IntToStr(RANDOM_POOL_CIPHER_INFO[i][1]) });
-    RandomPoolCipherList->Items->Add(sCipher);
-  }
+  UpdateCipherList();
 
   for (i = 0; i <= 10; i++)
     BenchmarkMemList->Items->Add(IntToStr(1 << i) + " MB");
@@ -116,6 +110,7 @@ __fastcall TConfigurationDlg::TConfigurationDlg(TComponent* Owner)
 
     TRLCaption(SecuritySheet);
     TRLCaption(RandomPoolCipherLbl);
+    TRLCaption(RandomPoolCipherAutoCheck);
     TRLCaption(BenchmarkBtn);
     TRLHint(BenchmarkMemList);
     TRLCaption(TestCommonPasswCheck);
@@ -217,6 +212,8 @@ void __fastcall TConfigurationDlg::GetOptions(Configuration& config)
   config.LoadProfileName = LoadProfileBox->Text;
   config.LaunchSystemStartup = LaunchSystemStartupCheck->Checked;
   config.RandomPoolCipher = RandomPoolCipherList->ItemIndex;
+  config.RandomPoolCipherAuto = RandomPoolCipherAutoCheck->Checked;
+  config.RandomPoolCipherRates = m_cipherRates;
   config.TestCommonPassw = TestCommonPasswCheck->Checked;
   config.UseAdvancedPasswEst = UseAdvancedPasswEst->Checked;
   config.ShowSysTrayIconConst = ShowSysTrayIconConstCheck->Checked;
@@ -261,7 +258,11 @@ void __fastcall TConfigurationDlg::SetOptions(const Configuration& config)
   AppIconList->ItemIndex = std::max(0, AppIconList->Items->IndexOf(config.AppIconName));
   StringToFont(config.GUIFontString, FontDlg->Font);
   ShowFontSample(FontDlg->Font);
+  m_cipherRates = config.RandomPoolCipherRates;
+  UpdateCipherList();
   RandomPoolCipherList->ItemIndex = config.RandomPoolCipher;
+  RandomPoolCipherAutoCheck->Checked = config.RandomPoolCipherAuto;
+  RandomPoolCipherAutoCheckClick(this);
   TestCommonPasswCheck->Checked = config.TestCommonPassw;
   UseAdvancedPasswEst->Checked = config.UseAdvancedPasswEst;
   AutoClearClipCheck->Checked = config.AutoClearClip;
@@ -349,6 +350,25 @@ void __fastcall TConfigurationDlg::UpdateHotKeyList(void)
   }
 }
 //---------------------------------------------------------------------------
+void __fastcall TConfigurationDlg::UpdateCipherList(void)
+{
+  int nIndex = RandomPoolCipherList->ItemIndex;
+  RandomPoolCipherList->Clear();
+
+  for (int i = 0; i < NUM_RANDOM_POOL_CIPHERS; i++) {
+    WString sCipher = TRLFormat("%1 (%2-bit key, operates on %3-bit blocks)",
+      { RANDOM_POOL_CIPHER_NAMES[i],
+        IntToStr(RANDOM_POOL_CIPHER_INFO[i][0]),
+        IntToStr(RANDOM_POOL_CIPHER_INFO[i][1]) });
+    if (i < static_cast<int>(m_cipherRates.size()))
+      sCipher += Format(" - %.0f MB/s", ARRAYOFCONST((
+        static_cast<TVARREC_DOUBLE>(m_cipherRates[i]))));
+    RandomPoolCipherList->Items->Add(sCipher);
+  }
+
+  RandomPoolCipherList->ItemIndex = nIndex;
+}
+//---------------------------------------------------------------------------
 void __fastcall TConfigurationDlg::SelectFontBtnClick(TObject *Sender)
 {
   TopMostManager::GetInstance().NormalizeTopMosts(this);
@@ -493,6 +513,7 @@ void __fastcall TConfigurationDlg::BenchmarkBtnClick(TObject *Sender)
     word32 lDataSizeMB = 1 << std::max(0, BenchmarkMemList->ItemIndex);
     word32 lBufSize = lDataSizeMB << 20;
     auto buf = std::make_unique<word8[]>(lBufSize);
+    std::vector<double> rates(NUM_RANDOM_POOL_CIPHERS);
     WString sResult;
     Screen->Cursor = crHourGlass;
     for (int i = 0; i < NUM_RANDOM_POOL_CIPHERS; i++) {
@@ -501,10 +522,20 @@ void __fastcall TConfigurationDlg::BenchmarkBtnClick(TObject *Sender)
       Stopwatch clock;
       rp.GetData(buf.get(), lBufSize);
       double rate = lDataSizeMB / clock.ElapsedSeconds();
+      rates[i] = rate;
       sResult += "\n" + Format("%s: %.2f MB/s", ARRAYOFCONST((
         RANDOM_POOL_CIPHER_NAMES[i], static_cast<TVARREC_DOUBLE>(rate))));
     }
     Screen->Cursor = crDefault;
+
+    // record measured throughput in the cipher list
+    m_cipherRates = rates;
+    UpdateCipherList();
+
+    auto recommended = RandomPool::GetFastestCipher(rates);
+    sResult += "\n\n" + TRLFormat("Recommended: %1",
+      { RANDOM_POOL_CIPHER_NAMES[static_cast<int>(recommended)] });
+
     MsgBox(TRLFormat("Benchmark results (data size: %1 MB):",
       { IntToStr(static_cast<int>(lDataSizeMB)) }) + sResult, MB_ICONINFORMATION);
   }
@@ -516,6 +547,12 @@ void __fastcall TConfigurationDlg::BenchmarkBtnClick(TObject *Sender)
   }
 }
 //---------------------------------------------------------------------------
+void __fastcall TConfigurationDlg::RandomPoolCipherAutoCheckClick(
+  TObject *Sender)
+{
+  RandomPoolCipherList->Enabled = !RandomPoolCipherAutoCheck->Checked;
+}
+//---------------------------------------------------------------------------
 void __fastcall TConfigurationDlg::ConvertLangFileBtnClick(TObject *Sender)
 {
   int nIndex = LanguageList->ItemIndex;
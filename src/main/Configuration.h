@@ -131,6 +131,8 @@ struct Configuration {
   bool LoadProfileStartup = false;
   WString LoadProfileName;
   int RandomPoolCipher = 1;
+  bool RandomPoolCipherAuto = false;
+  std::vector<double> RandomPoolCipherRates; // calibration results (MB/s)
   AutoCheckUpdates AutoCheckUpdates = acuWeekly;
   CharacterEncoding FileEncoding = ceUtf8;
   NewlineChar FileNewlineChar = nlcWindows;
@@ -246,6 +248,7 @@ __published:	// IDE-managed Components
   TOpenDialog *OpenDlg;
   TButton *RemoveLanguageBtn;
   TCheckBox *KeepRecentFilesCheck;
+  TCheckBox *RandomPoolCipherAutoCheck;
   void __fastcall SelectFontBtnClick(TObject *Sender);
   void __fastcall AutoClearClipCheckClick(TObject *Sender);
   void __fastcall FormShow(TObject *Sender);
@@ -267,12 +270,15 @@ __published:	// IDE-managed Components
     void __fastcall LoadProfileStartupCheckClick(TObject *Sender);
   void __fastcall InstallLanguageBtnClick(TObject *Sender);
   void __fastcall RemoveLanguageBtnClick(TObject *Sender);
+  void __fastcall RandomPoolCipherAutoCheckClick(TObject *Sender);
 private:	// User declarations
   HotKeyList m_hotKeys;
+  std::vector<double> m_cipherRates;
   //std::vector<LanguageEntry> m_langList;
   void __fastcall ShowFontSample(TFont* pFont);
   void __fastcall UpdateHotKeyList(void);
   void __fastcall UpdateProfileList(void);
+  void __fastcall UpdateCipherList(void);
 public:		// User declarations
   __fastcall TConfigurationDlg(TComponent* Owner);
   void __fastcall LoadConfig(void);
@@ -22,6 +22,8 @@
 #define DataCompressorH
 //---------------------------------------------------------------------------
 #include "miniz.h"
+#include "minilzo.h"
+#include "SecureMem.h"
 
 class CompressorError : public std::runtime_error
 {
@@ -169,4 +171,141 @@ private:
   z_stream m_stream;
 };
 
+// LZO1X-1 compression: much faster than Deflate, but lower compression ratio;
+// as LZO is a block codec, the whole input is compressed at once when the
+// stream is finished. The compressed stream starts with the uncompressed size
+// (32 bits), followed by the LZO data.
+class LzoCompress : public DataCompressor
+{
+public:
+  LzoCompress()
+    : m_workMem(LZO1X_1_MEM_COMPRESS), m_lInSize(0), m_lOutSize(0),
+      m_lOutPos(0), m_blCompressed(false)
+  {}
+
+  bool Process(const word8* pIn,
+    word32 lInSize,
+    word8* pOut,
+    word32 lOutSize,
+    bool blFinish,
+    word32& lAvailOut) override
+  {
+    if (!m_blCompressed) {
+      // collect input unless the entire data are passed in a single call
+      if (lInSize && (!blFinish || m_lInSize)) {
+        m_inBuf.BufferedGrow(m_lInSize + lInSize);
+        m_inBuf.Copy(m_lInSize, pIn, lInSize);
+        m_lInSize += lInSize;
+      }
+      if (!blFinish) {
+        lAvailOut = 0;
+        return false;
+      }
+      if (m_lInSize) {
+        pIn = m_inBuf;
+        lInSize = m_lInSize;
+      }
+      // worst-case expansion of LZO for incompressible data
+      m_outBuf.New(4 + lInSize + lInSize / 16 + 64 + 3);
+      memcpy(m_outBuf, &lInSize, 4);
+      lzo_uint comprLen = 0;
+      if (lInSize && lzo1x_1_compress(pIn, lInSize, m_outBuf.Data() + 4,
+            &comprLen, m_workMem) != LZO_E_OK)
+        throw CompressorError("lzo1x_1_compress() failed");
+      m_lOutSize = 4 + comprLen;
+      m_inBuf.Clear();
+      m_workMem.Clear();
+      m_blCompressed = true;
+    }
+    lAvailOut = std::min(lOutSize, m_lOutSize - m_lOutPos);
+    memcpy(pOut, m_outBuf.Data() + m_lOutPos, lAvailOut);
+    m_lOutPos += lAvailOut;
+    return m_lOutPos == m_lOutSize;
+  }
+
+  bool CheckRefill(void) override
+  {
+    // input is always consumed completely
+    return true;
+  }
+
+private:
+  SecureMem<word8> m_workMem;
+  SecureMem<word8> m_inBuf;
+  SecureMem<word8> m_outBuf;
+  word32 m_lInSize;
+  word32 m_lOutSize;
+  word32 m_lOutPos;
+  bool m_blCompressed;
+};
+
+
+class LzoDecompress : public DataCompressor
+{
+public:
+  LzoDecompress()
+    : m_lInSize(0), m_lOutSize(0), m_lOutPos(0), m_blDecompressed(false)
+  {}
+
+  bool Process(const word8* pIn,
+    word32 lInSize,
+    word8* pOut,
+    word32 lOutSize,
+    bool blFinish,
+    word32& lAvailOut) override
+  {
+    if (!m_blDecompressed) {
+      if (lInSize && (!blFinish || m_lInSize)) {
+        m_inBuf.BufferedGrow(m_lInSize + lInSize);
+        m_inBuf.Copy(m_lInSize, pIn, lInSize);
+        m_lInSize += lInSize;
+      }
+      if (!blFinish) {
+        lAvailOut = 0;
+        return false;
+      }
+      if (m_lInSize) {
+        pIn = m_inBuf;
+        lInSize = m_lInSize;
+      }
+      if (lInSize < 4)
+        throw CompressorError("Invalid LZO stream");
+      memcpy(&m_lOutSize, pIn, 4);
+      // decompress directly into the output buffer if possible
+      word8* pDest = pOut;
+      if (m_lOutSize > lOutSize) {
+        m_outBuf.New(m_lOutSize);
+        pDest = m_outBuf;
+      }
+      lzo_uint decomprLen = m_lOutSize;
+      if (m_lOutSize && (lzo1x_decompress_safe(pIn + 4, lInSize - 4, pDest,
+            &decomprLen, nullptr) != LZO_E_OK || decomprLen != m_lOutSize))
+        throw CompressorError("lzo1x_decompress_safe() failed");
+      m_inBuf.Clear();
+      m_blDecompressed = true;
+      if (pDest == pOut) {
+        lAvailOut = m_lOutPos = m_lOutSize;
+        return true;
+      }
+    }
+    lAvailOut = std::min(lOutSize, m_lOutSize - m_lOutPos);
+    memcpy(pOut, m_outBuf.Data() + m_lOutPos, lAvailOut);
+    m_lOutPos += lAvailOut;
+    return m_lOutPos == m_lOutSize;
+  }
+
+  bool CheckRefill(void) override
+  {
+    return true;
+  }
+
+private:
+  SecureMem<word8> m_inBuf;
+  SecureMem<word8> m_outBuf;
+  word32 m_lInSize;
+  word32 m_lOutSize;
+  word32 m_lOutPos;
+  bool m_blDecompressed;
+};
+
 #endif
\ No newline at end of file
@@ -31,7 +31,7 @@
 #include "Util.h"
 #include "CryptUtil.h"
 #include "sha1.h"
-#include "base64.h"
+#include "Base64Codec.h"
 #include "FastPRNG.h"
 #include "dragdrop.h"
 #include "TopMostManager.h"
@@ -402,10 +402,7 @@ void __fastcall TMPPasswGenForm::GenerateBtnClick(TObject *Sender)
       passwBytes.Data());
 
     SecureAnsiString asPassw(9);
-	  size_t outputLen = 9;
-
-	  base64_encode(reinterpret_cast<word8*>(asPassw.Data()),
-	    &outputLen, passwBytes.Data(), 6, 0);
+    base64Encode(asPassw, passwBytes, 6);
 
     SecureWString sPassw(9);
     asciiToUnicode(asPassw, sPassw, 9);
@@ -245,7 +245,8 @@ __fastcall TMainForm::TMainForm(TComponent* Owner)
     m_randPool(RandomPool::GetInstance()),
     m_entropyMng(EntropyManager::GetInstance()),
     m_blStartup(true), m_nNumStartupErrors(0), m_passwGen(&m_randPool),
-    m_nAutoClearClipCnt(0), m_nAutoClearPasswCnt(0), m_pUpdCheckThread(nullptr)
+    m_nAutoClearClipCnt(0), m_nAutoClearPasswCnt(0), m_pUpdCheckThread(nullptr),
+    m_blCryptFileProgress(false)
 {
 //  SetSecureMemoryManager();
   Application->OnMessage = AppMessage;
@@ -461,6 +462,17 @@ __fastcall TMainForm::TMainForm(TComponent* Owner)
 
   SaveDlg->Filter = OpenDlg->Filter;
 
+  // add menu items for encrypting/decrypting files after the clipboard items
+  int nCryptFileIdx = MainMenu_Tools->IndexOf(MainMenu_Tools_DecryptClip) + 1;
+  for (int i = 0; i < 2; i++) {
+    TMenuItem* pItem = new TMenuItem(MainMenu_Tools);
+    pItem->Caption = (i == 0) ? TRL("Encrypt File...") : TRL("Decrypt File...");
+    pItem->Tag = i;
+    pItem->OnClick = MainMenu_Tools_CryptFileClick;
+    MainMenu_Tools->Insert(nCryptFileIdx + i, pItem);
+    m_cryptFileMenuItems.push_back(pItem);
+  }
+
   switch (g_donorInfo.Valid) {
   case DONOR_KEY_VALID:
     break;
@@ -1000,6 +1012,14 @@ void __fastcall TMainForm::LoadConfig(void)
 
   int nCipher = g_pIni->ReadInteger(CONFIG_ID, "RandomPoolCipher",
     static_cast<int>(RandomPool::CipherType::ChaCha20));
+  g_config.RandomPoolCipherAuto = g_pIni->ReadBool(CONFIG_ID,
+    "RandomPoolCipherAuto", false);
+  if (g_config.RandomPoolCipherAuto) {
+    // calibration takes only a few milliseconds
+    g_config.RandomPoolCipherRates = RandomPool::CalibrateCiphers();
+    nCipher = static_cast<int>(RandomPool::GetFastestCipher(
+      g_config.RandomPoolCipherRates));
+  }
   if (nCipher >= 0 && nCipher <= static_cast<int>(RandomPool::CipherType::ChaCha8))
   {
     g_config.RandomPoolCipher = nCipher;
@@ -1266,6 +1286,8 @@ bool __fastcall TMainForm::SaveConfig(const WString& sFileName)
     g_pIni->WriteBool(CONFIG_ID, "LoadProfileStartup", g_config.LoadProfileStartup);
     g_pIni->WriteString(CONFIG_ID, "LoadProfileStartupName", g_config.LoadProfileName);
     g_pIni->WriteInteger(CONFIG_ID, "RandomPoolCipher", g_config.RandomPoolCipher);
+    g_pIni->WriteBool(CONFIG_ID, "RandomPoolCipherAuto",
+      g_config.RandomPoolCipherAuto);
     g_pIni->WriteBool(CONFIG_ID, "TestCommonPassw", g_config.TestCommonPassw);
     g_pIni->WriteBool(CONFIG_ID, "UseAdvancedPasswEst",
       g_config.UseAdvancedPasswEst);
@@ -1616,6 +1638,213 @@ void __fastcall TMainForm::CryptText(bool blEncrypt,
   }
 }
 //---------------------------------------------------------------------------
+// state of a file encryption/decryption running in the background; owned by
+// the task, so the cancel token is only registered while the task is running
+struct CryptFileTask {
+  TaskCancelToken CancelToken;
+  bool Encrypt;
+  WString SrcFileName;
+  WString DestFileName;
+  SecureWString Passw;
+  std::unique_ptr<RandomPool> RandPool;
+  std::shared_ptr<std::atomic<word64>> Progress; // in MB
+};
+
+void __fastcall TMainForm::CryptFile(bool blEncrypt)
+{
+  OpenDlg->FilterIndex = 0;
+  OpenDlg->Title = blEncrypt ? TRL("Select file to encrypt") :
+    TRL("Select file to decrypt");
+
+  BeforeDisplayDlg();
+  bool blSuccess = OpenDlg->Execute();
+  AfterDisplayDlg();
+
+  if (!blSuccess)
+    return;
+
+  WString sSrcFileName = OpenDlg->FileName;
+
+  SaveDlg->FilterIndex = 0;
+  SaveDlg->Title = blEncrypt ? TRL("Save encrypted file") :
+    TRL("Save decrypted file");
+  SaveDlg->FileName = blEncrypt ? sSrcFileName + ".pwgf" :
+    ChangeFileExt(sSrcFileName, "");
+
+  BeforeDisplayDlg();
+  blSuccess = SaveDlg->Execute();
+  AfterDisplayDlg();
+
+  if (!blSuccess)
+    return;
+
+  WString sDestFileName = SaveDlg->FileName;
+
+  if (SameFileName(ExpandFileName(sSrcFileName),
+      ExpandFileName(sDestFileName))) {
+    MsgBox(TRL("Source and destination file must be different."),
+      MB_ICONERROR);
+    return;
+  }
+
+  int nFlags = PASSWENTER_FLAG_ENABLEPASSWCACHE;
+  nFlags |= blEncrypt ? PASSWENTER_FLAG_ENCRYPT | PASSWENTER_FLAG_CONFIRMPASSW :
+    PASSWENTER_FLAG_DECRYPT;
+  blSuccess = PasswEnterDlg->Execute(nFlags) == mrOk;
+
+  SecureWString sPassw;
+  if (blSuccess)
+    sPassw = PasswEnterDlg->GetPassw();
+
+  PasswEnterDlg->Clear();
+  m_randPool.Flush();
+
+  if (!blSuccess)
+    return;
+
+  // the file is processed in the background, so that the window remains
+  // responsive for large files; the task uses its own copy of the random
+  // pool for creating the salt
+  auto pTask = std::make_shared<CryptFileTask>();
+  pTask->Encrypt = blEncrypt;
+  pTask->SrcFileName = sSrcFileName;
+  pTask->DestFileName = sDestFileName;
+  pTask->Passw = std::move(sPassw);
+  pTask->Progress = std::make_shared<std::atomic<word64>>(0);
+  if (blEncrypt) {
+    pTask->RandPool.reset(new RandomPool(m_randPool));
+    pTask->RandPool->Randomize();
+  }
+
+  for (TMenuItem* pItem : m_cryptFileMenuItems)
+    pItem->Enabled = false;
+
+  TTask::Run([this,pTask]() {
+    auto pCancelFlag = pTask->CancelToken.Get();
+    auto pProgress = pTask->Progress;
+
+    // progress is passed to the main thread after each batch of chunks;
+    // the form must not be accessed any more if the task has been cancelled
+    auto progressFunc = [this,pCancelFlag,pProgress](word64 qDone,
+      word64 qTotal)
+    {
+      TThread::Queue(nullptr, _di_TThreadProcedure(
+        [this,pCancelFlag,pProgress,qDone,qTotal]() {
+          if (!*pCancelFlag)
+            UpdateCryptFileProgress(qDone, qTotal, pCancelFlag, pProgress);
+        }));
+      return !*pCancelFlag;
+    };
+
+    int nResult = CRYPTTEXT_OK;
+    WString sErrorMsg;
+    try {
+      if (pTask->Encrypt)
+        nResult = EncryptFileChunked(pTask->SrcFileName, pTask->DestFileName,
+          pTask->Passw.Bytes(), pTask->Passw.StrLenBytes(), *pTask->RandPool,
+          progressFunc);
+      else
+        nResult = DecryptFileChunked(pTask->SrcFileName, pTask->DestFileName,
+          pTask->Passw.Bytes(), pTask->Passw.StrLenBytes(), progressFunc);
+    }
+    catch (Exception& e) {
+      sErrorMsg = e.Message;
+    }
+
+    pTask->Passw.Clear();
+    pTask->RandPool.reset();
+
+    // nothing is reported if the program is being terminated
+    if (pTask->CancelToken &&
+        pTask->CancelToken.Reason != TaskCancelReason::UserCancel)
+      return;
+
+    const bool blEncrypt = pTask->Encrypt;
+    TThread::Queue(nullptr, _di_TThreadProcedure(
+      [this,blEncrypt,nResult,sErrorMsg]() {
+        CryptFileDone(blEncrypt, nResult, sErrorMsg);
+      }));
+  });
+}
+//---------------------------------------------------------------------------
+void __fastcall TMainForm::UpdateCryptFileProgress(word64 qDone,
+  word64 qTotal,
+  std::shared_ptr<std::atomic<bool>> pCancelFlag,
+  std::shared_ptr<std::atomic<word64>> pProgress)
+{
+  const word64 MB = 1048576;
+  *pProgress = qDone / MB;
+
+  // the progress window may still be used by another operation
+  if (!m_blCryptFileProgress && !ProgressForm->Visible) {
+    m_blCryptFileProgress = true;
+    ProgressForm->Init(this, PROGRAM_NAME, TRL("%1 of %2 MB processed."),
+      std::max<word64>(1, (qTotal + MB - 1) / MB), pCancelFlag, pProgress);
+  }
+}
+//---------------------------------------------------------------------------
+void __fastcall TMainForm::CryptFileDone(bool blEncrypt,
+  int nResult,
+  const WString& sErrorMsg)
+{
+  if (m_blCryptFileProgress) {
+    ProgressForm->Terminate(this);
+    m_blCryptFileProgress = false;
+  }
+
+  for (TMenuItem* pItem : m_cryptFileMenuItems)
+    pItem->Enabled = true;
+
+  if (!sErrorMsg.IsEmpty()) {
+    MsgBox(sErrorMsg, MB_ICONERROR);
+    return;
+  }
+
+  WString sMsg;
+  switch (nResult) {
+  case CRYPTTEXT_OK:
+    if (blEncrypt)
+      sMsg = TRL("File successfully encrypted.");
+    else
+      sMsg = TRL("File successfully decrypted.");
+    break;
+  case CRYPTTEXT_ERROR_FILEIO:
+    sMsg = TRL("Error while reading from or writing to file.");
+    break;
+  case CRYPTTEXT_ERROR_OUTOFMEMORY:
+    sMsg = TRL("Not enough memory available to perform\nthe operation.");
+    break;
+  case CRYPTTEXT_ERROR_TEXTCORRUPTED:
+  case CRYPTTEXT_ERROR_BADKEY:
+    sMsg = TRL("Decryption failed. This may be attributed\nto the following reasons:")
+      + WString("\n");
+    if (nResult == CRYPTTEXT_ERROR_BADKEY)
+      sMsg += TRL("- You entered a wrong password.") + WString("\n");
+    sMsg += TRL("- The file is corrupted.\n"
+        "- The file is not encrypted.");
+    break;
+  case CRYPTTEXT_ERROR_DECOMPRFAILED:
+    sMsg = TRL("This should not have happened:\nDecryption successful, but "
+        "decompression\nfailed.");
+    break;
+  case CRYPTTEXT_ERROR_CANCELLED:
+    sMsg = EUserCancel::UserCancelMsg;
+    break;
+  default:
+    sMsg = "Unknown error"; // should never happen
+  }
+
+  if (nResult == CRYPTTEXT_OK)
+    InfoBoxForm->ShowInfo(sMsg);
+  else
+    MsgBox(sMsg, MB_ICONERROR);
+}
+//---------------------------------------------------------------------------
+void __fastcall TMainForm::MainMenu_Tools_CryptFileClick(TObject *Sender)
+{
+  CryptFile(static_cast<TMenuItem*>(Sender)->Tag == 0);
+}
+//---------------------------------------------------------------------------
 void __fastcall TMainForm::OnSetSensitiveClipboardData(void)
 {
   if (g_config.AutoClearClip)
@@ -1756,9 +1985,6 @@ bool __fastcall TMainForm::ApplyConfig(const Configuration& config)
     }
   }
 
-  m_randPool.SetCipher(static_cast<RandomPool::CipherType>(
-    config.RandomPoolCipher));
-
   SecureClipboard::GetInstance().AutoClear = config.AutoClearClip;
   if (!config.AutoClearClip)
     m_nAutoClearClipCnt = 0;
@@ -1782,6 +2008,16 @@ bool __fastcall TMainForm::ApplyConfig(const Configuration& config)
 
   g_config = config;
 
+  if (g_config.RandomPoolCipherAuto) {
+    if (g_config.RandomPoolCipherRates.empty())
+      g_config.RandomPoolCipherRates = RandomPool::CalibrateCiphers();
+    g_config.RandomPoolCipher = static_cast<int>(RandomPool::GetFastestCipher(
+      g_config.RandomPoolCipherRates));
+  }
+
+  m_randPool.SetCipher(static_cast<RandomPool::CipherType>(
+    g_config.RandomPoolCipher));
+
   if ((blLangChanged || blStyleChanged) &&
       MsgBox(TRL("The program has to be restarted in order\nfor the changes "
         "to take effect.\n\nDo you want to restart now?"),
@@ -3972,6 +4208,9 @@ void __fastcall TMainForm::MainMenu_Options_ConfigClick(TObject *Sender)
   if (ConfigurationDlg->ShowModal() == mrOk) {
     if (g_terminateAction == TerminateAction::RestartProgram)
       Close();
+    else if (g_config.RandomPoolCipherAuto)
+      // show automatically selected cipher
+      ConfigurationDlg->SetOptions(g_config);
   }
   else
     ConfigurationDlg->SetOptions(g_config);
@@ -4021,7 +4260,9 @@ void __fastcall TMainForm::MainMenu_Tools_ProvideAddEntropy_FromFileClick(
     try {
       std::unique_ptr<TFileStream> pFile(new TFileStream(OpenDlg->FileName, fmOpenRead));
 
-      const int IO_BUFSIZE = 65536;
+      // large buffer size, so that the random pool can hash the data
+      // in parallel
+      const int IO_BUFSIZE = 4194304;
       SecureMem<word8> buf(IO_BUFSIZE);
       int nBytesRead;
       word32 lEntBits = 0;
@@ -484,6 +484,8 @@ private:	// User declarations
   std::unique_ptr<LuaScript> m_pScript;
   TDateTime m_lastUpdateCheck;
   std::unique_ptr<TFont> m_pDefaultPasswFont;
+  std::vector<TMenuItem*> m_cryptFileMenuItems;
+  bool m_blCryptFileProgress;
 
   void __fastcall DelayStartupError(const WString& sMsg);
   void __fastcall LoadLangConfig(void);
@@ -518,6 +520,13 @@ private:	// User declarations
   void __fastcall RestoreAction(void);
   void __fastcall OnSetSensitiveClipboardData(void);
   void __fastcall OnQueryEndSession(TWMQueryEndSession& msg);
+  void __fastcall UpdateCryptFileProgress(word64 qDone,
+    word64 qTotal,
+    std::shared_ptr<std::atomic<bool>> pCancelFlag,
+    std::shared_ptr<std::atomic<word64>> pProgress);
+  void __fastcall CryptFileDone(bool blEncrypt,
+    int nResult,
+    const WString& sErrorMsg);
 public:		// User declarations
   __fastcall TMainForm(TComponent* Owner);
   __fastcall ~TMainForm();
@@ -536,10 +545,16 @@ public:		// User declarations
   void __fastcall CryptText(bool blEncrypt,
     const SecureWString* psText = nullptr,
     TForm* pParentForm = nullptr);
+  void __fastcall CryptFile(bool blEncrypt);
+  void __fastcall MainMenu_Tools_CryptFileClick(TObject *Sender);
   void __fastcall GeneratePassw(GeneratePasswDest dest,
     TCustomEdit* pEditBox = nullptr);
   void __fastcall ShowTrayInfo(const WString& sInfo,
     TBalloonFlags flags = bfNone);
+  const std::unordered_set<std::wstring>& __fastcall GetCommonPassw(void)
+  {
+    return m_commonPassw;
+  }
   void __fastcall OnEndSession(TWMEndSession& msg);
   BEGIN_MESSAGE_MAP
     MESSAGE_HANDLER(WM_HOTKEY, TMessage, OnHotKey)
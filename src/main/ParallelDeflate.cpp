@@ -0,0 +1,166 @@
+// ParallelDeflate.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <algorithm>
+#include <memory>
+#pragma hdrstop
+
+#include "ParallelDeflate.h"
+#include "DataCompressor.h"
+#include "MemUtil.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+namespace {
+
+const word32
+  DICT_SIZE = TDEFL_LZ_DICT_SIZE,
+  OUTPUT_BUF_SIZE = 65536;
+
+struct TdeflDeleter {
+  void operator()(tdefl_compressor* pComp) const
+  {
+    // compressor state contains plaintext data
+    memzero(pComp, sizeof(tdefl_compressor));
+    delete pComp;
+  }
+};
+
+}
+
+//---------------------------------------------------------------------------
+ParallelDeflate::ParallelDeflate(const word8* pSrc,
+  word32 lSrcSize,
+  int nLevel,
+  word32 lBlockSize)
+  : m_pSrc(pSrc), m_lSrcSize(lSrcSize),
+    m_lBlockSize(std::max<word32>(lBlockSize, MIN_BLOCK_SIZE)),
+    m_nLevel(nLevel)
+{
+  m_blocks.resize(std::max<word32>(1,
+    (lSrcSize + m_lBlockSize - 1) / m_lBlockSize));
+}
+//---------------------------------------------------------------------------
+word32 ParallelDeflate::GetBlockSize(word32 lSrcSize,
+  word32 lNumParts)
+{
+  if (lNumParts == 0)
+    lNumParts = 1;
+  return std::max<word32>((lSrcSize + lNumParts - 1) / lNumParts,
+    MIN_BLOCK_SIZE);
+}
+//---------------------------------------------------------------------------
+int ParallelDeflate::PutBuf(const void* pBuf,
+  int nLen,
+  void* pUser)
+{
+  Block* pBlock = reinterpret_cast<Block*>(pUser);
+  // output of the priming data is discarded
+  if (pBlock->Priming)
+    return MZ_TRUE;
+  // don't let exceptions propagate through the C code of miniz
+  try {
+    pBlock->Data.BufferedGrow(pBlock->Size + nLen);
+    pBlock->Data.Copy(pBlock->Size, reinterpret_cast<const word8*>(pBuf),
+      nLen);
+  }
+  catch (...) {
+    return MZ_FALSE;
+  }
+  pBlock->Size += nLen;
+  return MZ_TRUE;
+}
+//---------------------------------------------------------------------------
+void ParallelDeflate::CompressBlock(word32 lIndex)
+{
+  Block& block = m_blocks[lIndex];
+  const word32 lStart = lIndex * m_lBlockSize;
+  const word32 lSize = std::min(m_lSrcSize - lStart, m_lBlockSize);
+  const bool blLast = lIndex == m_blocks.size() - 1;
+
+  std::unique_ptr<tdefl_compressor, TdeflDeleter> pComp(new tdefl_compressor);
+
+  // raw Deflate stream without zlib header (added in Finish())
+  const mz_uint lFlags = tdefl_create_comp_flags_from_zip_params(m_nLevel,
+    -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+  if (tdefl_init(pComp.get(), PutBuf, &block, lFlags) != TDEFL_STATUS_OKAY)
+    throw CompressorError("tdefl_init() failed");
+
+  block.Data.New(OUTPUT_BUF_SIZE);
+  block.Size = 0;
+
+  // fill the sliding window with the data preceding this block; a sync
+  // flush ensures that the actual output starts at a byte boundary
+  if (lStart != 0) {
+    const word32 lDictSize = std::min(lStart, DICT_SIZE);
+    block.Priming = true;
+    tdefl_status status = tdefl_compress_buffer(pComp.get(),
+      m_pSrc + lStart - lDictSize, lDictSize, TDEFL_SYNC_FLUSH);
+    block.Priming = false;
+    if (status != TDEFL_STATUS_OKAY)
+      throw CompressorError("tdefl_compress_buffer() failed");
+  }
+
+  // all blocks but the last one end with an empty stored block (sync flush),
+  // so they can simply be concatenated
+  tdefl_status status = tdefl_compress_buffer(pComp.get(), m_pSrc + lStart,
+    lSize, blLast ? TDEFL_FINISH : TDEFL_SYNC_FLUSH);
+  if (status != (blLast ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY))
+    throw CompressorError("tdefl_compress_buffer() failed");
+}
+//---------------------------------------------------------------------------
+word32 ParallelDeflate::Finish(SecureMem<word8>& dest,
+  word32 lReserve)
+{
+  // zlib header (CMF: deflate with 32K window, FLG: level hint + check bits)
+  word8 header[2] = { 0x78, 0x01 };
+  if (m_nLevel < 0 || m_nLevel == MZ_DEFAULT_LEVEL)
+    header[1] = 0x9c;
+  else if (m_nLevel >= 7)
+    header[1] = 0xda;
+  else if (m_nLevel >= 2)
+    header[1] = 0x5e;
+
+  word32 lTotalSize = sizeof(header) + 4;
+  for (const auto& block : m_blocks)
+    lTotalSize += block.Size;
+
+  dest.New(lTotalSize + lReserve);
+  dest.Copy(0, header, sizeof(header));
+
+  word32 lPos = sizeof(header);
+  for (auto& block : m_blocks) {
+    dest.Copy(lPos, block.Data, block.Size);
+    lPos += block.Size;
+    block.Data.Clear();
+    block.Size = 0;
+  }
+
+  // Adler-32 checksum of the uncompressed data in big-endian byte order
+  const word32 lAdler = mz_adler32(MZ_ADLER32_INIT, m_pSrc, m_lSrcSize);
+  dest[lPos++] = static_cast<word8>(lAdler >> 24);
+  dest[lPos++] = static_cast<word8>(lAdler >> 16);
+  dest[lPos++] = static_cast<word8>(lAdler >> 8);
+  dest[lPos++] = static_cast<word8>(lAdler);
+
+  return lPos;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+// ParallelDeflate.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef ParallelDeflateH
+#define ParallelDeflateH
+//---------------------------------------------------------------------------
+#include <vector>
+#include "SecureMem.h"
+
+// pigz-style Deflate compression: the input is split into blocks which can be
+// compressed independently (e.g., by ParallelFor()). Each block is primed
+// with the last 32 KB of the preceding data (the Deflate window), so matches
+// across block boundaries are preserved; blocks are terminated by a sync
+// flush and concatenated into a single zlib stream that can be decompressed
+// by Inflate.
+class ParallelDeflate
+{
+public:
+
+  enum {
+    MIN_BLOCK_SIZE = 65536,
+    DEFAULT_BLOCK_SIZE = 131072
+  };
+
+  // constructor
+  // -> input data (must remain valid until Finish() has been called)
+  // -> size of input data
+  // -> compression level (0..9, or MZ_DEFAULT_LEVEL)
+  // -> block size (at least MIN_BLOCK_SIZE)
+  ParallelDeflate(const word8* pSrc,
+    word32 lSrcSize,
+    int nLevel,
+    word32 lBlockSize = DEFAULT_BLOCK_SIZE);
+
+  // compress a single block; may be called concurrently for different blocks
+  // -> block index in the range [0, GetNumBlocks())
+  void CompressBlock(word32 lIndex);
+
+  // concatenate compressed blocks to a zlib stream
+  // (all blocks must have been compressed before)
+  // -> destination buffer
+  // -> number of additional bytes to reserve at the end of the buffer
+  // <- size of compressed data
+  word32 Finish(SecureMem<word8>& dest,
+    word32 lReserve = 0);
+
+  // determine suitable block size for splitting data among worker threads
+  // -> size of input data
+  // -> number of parts into which the data should be split
+  // <- block size (>= MIN_BLOCK_SIZE)
+  static word32 GetBlockSize(word32 lSrcSize,
+    word32 lNumParts);
+
+  word32 GetNumBlocks(void) const
+  {
+    return m_blocks.size();
+  }
+
+private:
+  struct Block {
+    SecureMem<word8> Data;
+    word32 Size = 0;
+    bool Priming = false;
+  };
+
+  const word8* m_pSrc;
+  word32 m_lSrcSize;
+  word32 m_lBlockSize;
+  int m_nLevel;
+  std::vector<Block> m_blocks;
+
+  static int PutBuf(const void* pBuf,
+    int nLen,
+    void* pUser);
+};
+
+#endif
@@ -50,17 +50,19 @@
 #include "Progress.h"
 #include "SecureClipboard.h"
 #include "TaskCancel.h"
+#include "FuzzyMatcher.h"
+#include "Parallel.h"
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
 #pragma resource "*.dfm"
 TPasswMngForm *PasswMngForm;
 
 
-const char* UI_FIELD_NAMES[PasswDbEntry::NUM_FIELDS] =
+const char* UI_FIELD_NAMES[DBVIEW_NUM_COLUMNS] =
 {
   "Title", "User name", "Password", "URL", "Keyword", "Notes", "Key-value list",
   "Tags", "Creation time", "Last modification", "Password changed",
-  "Password expiry", "Password history"
+  "Password expiry", "Password history", "Password strength"
 };
 
 const WString
@@ -133,6 +135,13 @@ const word32
 
 const TColor DBVIEW_SEARCH_COLOR = clBlue;
 
+const word64 SEARCH_RESULTS_UPDATE_INTERVAL = 100; // ms
+
+// number of passwords evaluated by the strength audit between checks for
+// cancellation; results are passed to the list view at most every
+// SEARCH_RESULTS_UPDATE_INTERVAL ms
+const word32 STRENGTH_AUDIT_BLOCK_SIZE = 256;
+
 const wchar_t* DB_KEYVAL_KEYS[DB_NUM_KEYVAL_KEYS] =
 {
   L"Autotype", L"Run", L"Profile", L"FormatPW"
@@ -173,79 +182,9 @@ const wchar_t* getDbEntryAutotypeSeq(const PasswDbEntry* pEntry)
     g_config.Database.DefaultAutotypeSequence.c_str();
 }
 
-word32 levenshteinDist(const wchar_t* pSrc, word32 lSrcLen,
-  const wchar_t* pTarget, word32 lTargetLen)
+int getExpirySoonNumDays(void)
 {
-  static const int
-    INSERT_COST = 2,
-    DELETE_COST = 1,
-    REPLACE_COST = 1;
-
-  if (lSrcLen > lTargetLen) {
-    return levenshteinDist(pTarget, lTargetLen, pSrc, lSrcLen);
-  }
-
-  const word32 lMinSize = lSrcLen;
-  const word32 lMaxSize = lTargetLen;
-  std::vector<word32> levDist(lMinSize + 1);
-  levDist[0] = 0;
-  for (word32 i = 1; i <= lMinSize; i++)
-    levDist[i] = levDist[i - 1] + DELETE_COST;
-
-  for (word32 j = 1; j <= lMaxSize; j++) {
-    word32 lPrev = levDist[0], lPrevSave;
-    levDist[0] += INSERT_COST;
-    for (word32 i = 1; i <= lMinSize; i++) {
-      lPrevSave = levDist[i];
-      if (pSrc[i - 1] == pTarget[j - 1])
-        levDist[i] = lPrev;
-      else
-        levDist[i] = std::min(std::min(levDist[i] + INSERT_COST,
-          levDist[i - 1] + DELETE_COST), lPrev + REPLACE_COST);
-      lPrev = lPrevSave;
-    }
-  }
-
-  return levDist.back();
-}
-
-float strFindFuzzy(const wchar_t* pSrc, const wchar_t* pPattern)
-{
-  const word32 lSrcLen = wcslen(pSrc);
-  const word32 lPatternLen = wcslen(pPattern);
-  float fBestScore = 0;
-
-  auto levenshteinScore = [&](const wchar_t* p, word32 lLen)
-  {
-    word32 lDist = levenshteinDist(p, lLen, pPattern, lPatternLen);
-    return (lDist < lPatternLen) ?
-      (lPatternLen - lDist) / static_cast<float>(lPatternLen) : 0.0f;
-  };
-
-  if (lSrcLen <= lPatternLen) {
-    if (lSrcLen == lPatternLen && wcscmp(pSrc, pPattern) == 0)
-      fBestScore = 2;
-    else
-      fBestScore = levenshteinScore(pSrc, lSrcLen);
-  }
-  else {
-    const wchar_t* pNext = pSrc;
-    int i = 0;
-    while ((pNext = wcschr(pNext, pPattern[0])) != nullptr) {
-      if (i == 0 && wcsstr(pNext, pPattern) != nullptr) {
-        fBestScore = 1;
-        break;
-      }
-      else {
-        fBestScore = std::max(fBestScore, levenshteinScore(pNext,
-          std::min(lPatternLen, static_cast<word32>(pSrc + lSrcLen - pNext))));
-      }
-      i++;
-      pNext++;
-    }
-  }
-
-  return fBestScore;
+  return std::max(1, std::min(100, g_config.Database.WarnExpireNumDays));
 }
 
 void getExpiryCheckDates(word32& lCurrDate, word32& lExpirySoonDate)
@@ -254,12 +193,28 @@ void getExpiryCheckDates(word32& lCurrDate, word32& lExpirySoonDate)
   unsigned short wYear, wMonth, wDay;
   today.DecodeDate(&wYear, &wMonth, &wDay);
   lCurrDate = PasswDbEntry::EncodeExpiryDate(wYear, wMonth, wDay);
-  TDate expirySoonDate = today + std::max(1,
-    std::min(100, g_config.Database.WarnExpireNumDays));
+  TDate expirySoonDate = today + getExpirySoonNumDays();
   expirySoonDate.DecodeDate(&wYear, &wMonth, &wDay);
   lExpirySoonDate = PasswDbEntry::EncodeExpiryDate(wYear, wMonth, wDay);
 }
 
+const std::unordered_set<std::wstring>* getCommonPasswList(void)
+{
+  return g_config.TestCommonPassw ? &MainForm->GetCommonPassw() : nullptr;
+}
+
+void setExpiryFlags(PasswDbEntry& entry, word32 lCurrDate,
+  word32 lExpirySoonDate)
+{
+  entry.UserFlags &= ~(DB_FLAG_EXPIRED | DB_FLAG_EXPIRES_SOON);
+  if (entry.PasswExpiryDate != 0) {
+    if (lCurrDate >= entry.PasswExpiryDate)
+      entry.UserFlags |= DB_FLAG_EXPIRED;
+    else if (lExpirySoonDate >= entry.PasswExpiryDate)
+      entry.UserFlags |= DB_FLAG_EXPIRES_SOON;
+  }
+}
+
 WString getTimeStampString(bool blMillisec = false)
 {
   SYSTEMTIME st;
@@ -313,7 +268,9 @@ void __fastcall TSelectItemThread::ApplyNow(void)
 __fastcall TPasswMngForm::TPasswMngForm(TComponent* Owner)
   : TForm(Owner), m_pSelectedItem(nullptr), m_nSortByIdx(-1),
     m_nSortOrderFactor(1), m_nTagsSortByIdx(0), m_nTagsSortOrderFactor(1),
-    m_nSearchFlags(INT_MAX), m_nPasswEntropyBits(0)
+    m_nSearchFlags(INT_MAX), m_nPasswEntropyBits(0), m_lSearchGeneration(0),
+    m_lNumSearchResults(0), m_lExpiryFlagsCurrDate(0),
+    m_lExpiryFlagsSoonDate(0)
 {
   SetFormComponentsAnchors(this);
 
@@ -328,7 +285,7 @@ __fastcall TPasswMngForm::TPasswMngForm(TComponent* Owner)
       std::wstring(DB_KEYVAL_UI_KEYS[nI]));
   }
 
-  for (int nI = 0; nI < PasswDbEntry::NUM_FIELDS; nI++) {
+  for (int nI = 0; nI < DBVIEW_NUM_COLUMNS; nI++) {
     m_uiFieldNames[nI] = TRL(UI_FIELD_NAMES[nI]);
 
     TMenuItem* pItem = new TMenuItem(MainMenu_View_ShowColumns);
@@ -482,13 +439,13 @@ void __fastcall TPasswMngForm::LoadConfig(void)
   }
 
   m_nShowColMask = g_pIni->ReadInteger(CONFIG_ID, "ShowColMask", 7);
-  for (int nI = 0; nI < PasswDbEntry::NUM_FIELDS; nI++) {
+  for (int nI = 0; nI < DBVIEW_NUM_COLUMNS; nI++) {
     if (m_nShowColMask & (1 << nI))
       MainMenu_View_ShowColumns->Items[nI]->Checked = true;
   }
 
   int nSortByIdx = g_pIni->ReadInteger(CONFIG_ID, "SortByIdx", -1);
-  if (nSortByIdx >= -1 && nSortByIdx < PasswDbEntry::NUM_FIELDS) {
+  if (nSortByIdx >= -1 && nSortByIdx < DBVIEW_NUM_COLUMNS) {
     m_nSortByIdx = nSortByIdx;
     int nItemIdx = (nSortByIdx < 0) ? 0 : 2 + nSortByIdx;
     MainMenu_View_SortBy->Items[nItemIdx]->Checked = true;
@@ -530,7 +487,7 @@ void __fastcall TPasswMngForm::LoadConfig(void)
     auto splitList = SplitString(asColWidths, ";");
     for (const auto& sLen : splitList) {
       m_listColWidths.push_back(std::max(10, StrToIntDef(sLen, 0)));
-      if (m_listColWidths.size() == PasswDbEntry::NUM_FIELDS)
+      if (m_listColWidths.size() == DBVIEW_NUM_COLUMNS)
         break;
     }
     /*int nLen = asColWidths.Length();
@@ -769,6 +726,12 @@ bool __fastcall TPasswMngForm::OpenDatabase(int nOpenFlags, WString sFileName)
     CloseDatabase(true);
   m_passwDb = passwDb;
   //m_passwDb.reset(passwDb.release());
+  m_searchIndex.Build(*m_passwDb);
+  m_tagIndex.Build(*m_passwDb);
+  m_expiryIndex.Build(*m_passwDb);
+  m_keywordIndex.Build(*m_passwDb);
+  StartStrengthAudit();
+  m_lExpiryFlagsCurrDate = m_lExpiryFlagsSoonDate = 0;
   m_pSelectedItem = nullptr;
   m_nSearchMode = SEARCH_MODE_OFF;
   m_blDbChanged = false;
@@ -785,6 +748,10 @@ bool __fastcall TPasswMngForm::OpenDatabase(int nOpenFlags, WString sFileName)
 
   if (nOpenFlags & DB_OPEN_FLAG_EXISTING) {
     ResetListView(RELOAD_TAGS);
+    if (m_passwDb->JournalIncomplete && !(nOpenFlags & DB_OPEN_FLAG_UNLOCK))
+      MsgBox(TRL("The database file contains incomplete changes at the end, "
+        "possibly due to an interrupted save operation.\nThese changes have "
+        "been ignored."), MB_ICONWARNING);
     m_sDbFileName = sFileName;
     UpdateRecentFiles();
     if (nOpenFlags & DB_OPEN_FLAG_READONLY)
@@ -838,17 +805,11 @@ bool __fastcall TPasswMngForm::OpenDatabase(int nOpenFlags, WString sFileName)
     m_nLockSelItemIndex = -1;
   }
   else {
-    auto checkExpiryFlag = [this](word32 lFlag)
-    {
-      for (const auto& pEntry : *m_passwDb) {
-        if (pEntry->UserFlags & lFlag)
-          return true;
-      }
-      return false;
-    };
+    word32 lCurrDate, lExpirySoonDate;
+    getExpiryCheckDates(lCurrDate, lExpirySoonDate);
 
     if (g_config.Database.WarnExpiredEntries &&
-        checkExpiryFlag(DB_FLAG_EXPIRED) &&
+        m_expiryIndex.HasEntriesInRange(1, lCurrDate) &&
           MsgBox(TRL("The database contains expired entries.\nDo you want to filter "
             "these entries now?"),
             MB_ICONWARNING + MB_YESNO + MB_DEFBUTTON2) == IDYES) {
@@ -856,7 +817,7 @@ bool __fastcall TPasswMngForm::OpenDatabase(int nOpenFlags, WString sFileName)
       ResetListView();
     }
     if (g_config.Database.WarnEntriesExpireSoon &&
-        checkExpiryFlag(DB_FLAG_EXPIRES_SOON) &&
+        m_expiryIndex.HasEntriesInRange(lCurrDate + 1, lExpirySoonDate) &&
           MsgBox(TRL("The database contains entries that will expire soon.\n"
             "Do you want to filter these entries now?"),
             MB_ICONWARNING + MB_YESNO + MB_DEFBUTTON2) == IDYES) {
@@ -965,7 +926,14 @@ bool __fastcall TPasswMngForm::CloseDatabase(bool blForce, int nLock)
     m_tagViewSelItemThread.reset();
   }
 
+  CancelSearch();
+  CancelStrengthAudit();
   m_passwDb.reset();
+  m_searchIndex.Clear();
+  m_tagIndex.Clear();
+  m_expiryIndex.Clear();
+  m_keywordIndex.Clear();
+  m_strengthCache.Clear();
 
   //m_tempKeyVal.reset();
   //m_tempPasswHistory.reset();
@@ -982,7 +950,6 @@ bool __fastcall TPasswMngForm::CloseDatabase(bool blForce, int nLock)
   //m_globalTags.clear();
   //m_searchResultTags.clear();
   m_tags.clear();
-  m_globalCaseiTags.clear();
   m_tagFilter.clear();
 
   ClearListView();
@@ -1007,6 +974,7 @@ bool __fastcall TPasswMngForm::CloseDatabase(bool blForce, int nLock)
   FilterInfoPanel->Visible = false;
 
   IdleTimer->Enabled = false;
+  ExpiryTimer->Enabled = false;
 
   if (g_config.Database.ClearClipCloseLock)
     Clipboard()->Clear();
@@ -1230,6 +1198,11 @@ int __fastcall TPasswMngForm::AddPassw(const wchar_t* pwszPassw,
       if (!sParam.IsEmpty())
         pNewEntry->Strings[PasswDbEntry::TITLE] = sParam;
 
+      m_searchIndex.AddEntry(*pNewEntry);
+      m_tagIndex.AddEntry(*pNewEntry);
+      m_expiryIndex.AddEntry(*pNewEntry);
+      m_keywordIndex.Invalidate();
+
       nNumPassw++;
     }
 
@@ -1240,6 +1213,7 @@ int __fastcall TPasswMngForm::AddPassw(const wchar_t* pwszPassw,
 
   if (nNumPassw > 0) {
     SetDbChanged(true, true);
+    StartStrengthAudit();
     ResetListView(RELOAD_TAGS);
   }
 
@@ -1253,6 +1227,19 @@ int __fastcall TPasswMngForm::AddPassw(const wchar_t* pwszPassw,
   return nNumPassw;
 }
 //---------------------------------------------------------------------------
+// state of a search running in the background; owned by the search task,
+// so the cancel token is only registered while the task is running
+struct DbSearchTask {
+  TaskCancelToken CancelToken;
+  word32 Generation;
+  WString Pattern;
+  bool CaseSensitive;
+  bool Fuzzy;
+  std::vector<PasswDbEntry*> Entries;
+  std::vector<word32> EntryOffsets; // start of the fields of each entry in Text
+  SecureWString Text;               // null-terminated fields to be searched
+};
+
 void __fastcall TPasswMngForm::SearchDatabase(WString sStr,
   int nFlags,
   bool blCaseSensitive,
@@ -1261,6 +1248,9 @@ void __fastcall TPasswMngForm::SearchDatabase(WString sStr,
   if (!IsDbOpen() || sStr.IsEmpty() || nFlags == 0)
     return;
 
+  // abandon any search that is still running
+  CancelSearch();
+
   // "fuzzy" always performs case-insensitive search, even if the actual
   // fuzzy algorithm is not used
   if (blFuzzy)
@@ -1272,75 +1262,377 @@ void __fastcall TPasswMngForm::SearchDatabase(WString sStr,
     sStr = AnsiLowerCase(sStr);
 
   m_nSearchMode = blFuzzy ? SEARCH_MODE_FUZZY : SEARCH_MODE_NORMAL;
+  m_lNumSearchResults = 0;
 
-  //ClearListView();
-  //DbView->Items->BeginUpdate();
+  // the index is kept up to date incrementally; rebuild it only if it has
+  // missed any changes
+  if (m_searchIndex.GetNumEntries() != m_passwDb->Size)
+    m_searchIndex.Build(*m_passwDb);
 
-  SecureWString sBuf;
+  for (auto& pEntry : *m_passwDb)
+    pEntry->UserFlags &= ~DB_FLAG_FOUND;
 
-  if (!blCaseSensitive)
-    sBuf.New(1024);
+  // the query is evaluated in the background on a copy of the fields to be
+  // searched, so the database may be modified while the search is running
+  auto pTask = std::make_shared<DbSearchTask>();
+  pTask->Generation = m_lSearchGeneration;
+  pTask->Pattern = sStr;
+  pTask->CaseSensitive = blCaseSensitive;
+  pTask->Fuzzy = blFuzzy;
+  pTask->Text.New(4096);
 
-  int nNumFound = 0;
+  word32 lTextPos = 0;
 
-  for (auto& pEntry : *m_passwDb)
+  auto addEntry = [&](PasswDbEntry& entry, const wchar_t* pwszPassw)
   {
-    pEntry->UserFlags &= ~DB_FLAG_FOUND;
+    pTask->Entries.push_back(&entry);
+    pTask->EntryOffsets.push_back(lTextPos);
     for (int nI = 0; nI < PasswDbEntry::NUM_STRING_FIELDS; nI++) {
       if (nFlags & (1 << nI)) {
-        const SecureWString* psSrc;
-        SecureWString sPassw;
-        if (nI == PasswDbEntry::PASSWORD && !pEntry->HasPlaintextPassw()) {
-          sPassw = m_passwDb->GetDbEntryPassw(*pEntry);
-          psSrc = &sPassw;
+        const wchar_t* pwszSrc;
+        word32 lSrcLen;
+        if (nI == PasswDbEntry::PASSWORD) {
+          pwszSrc = pwszPassw;
+          lSrcLen = wcslen(pwszPassw);
+        }
+        else {
+          pwszSrc = entry.Strings[nI].c_str();
+          lSrcLen = entry.Strings[nI].StrLen();
+        }
+        if (lSrcLen != 0) {
+          pTask->Text.BufferedGrow(lTextPos + lSrcLen + 1);
+          pTask->Text.Copy(lTextPos, pwszSrc, lSrcLen + 1);
+          lTextPos += lSrcLen + 1;
+        }
+      }
+    }
+  };
+
+  std::vector<PasswDbEntry*> candidates;
+
+  // passwords are not indexed, and fuzzy matches may not contain all
+  // trigrams of the search string;
+  // passwords are provided by the database in a single pass if the password
+  // field is to be searched
+  if (nFlags & (1 << PasswDbEntry::PASSWORD))
+    m_passwDb->ForEachDbEntryPassw(addEntry);
+  else if (!blFuzzy && m_searchIndex.FindCandidates(sStr.c_str(), nFlags,
+           candidates)) {
+    for (PasswDbEntry* pEntry : candidates)
+      addEntry(*pEntry, L"");
+  }
+  else {
+    for (auto& pEntry : *m_passwDb)
+      addEntry(*pEntry, L"");
+  }
+
+  pTask->EntryOffsets.push_back(lTextPos);
+
+  DbView->Font->Color = DBVIEW_SEARCH_COLOR;
+  SearchResultPanel->Caption = TRL("Searching ...");
+
+  m_pSearchCancelFlag = pTask->CancelToken.Get();
+
+  TTask::Run([this,pTask]() {
+    auto pCancelFlag = pTask->CancelToken.Get();
+
+    // minimum score of fuzzy matches
+    const float fMinScore = 0.5;
+    FuzzyMatcher fuzzyMatcher(pTask->Pattern.c_str());
+
+    SecureWString sBuf;
+    if (!pTask->CaseSensitive)
+      sBuf.New(1024);
+
+    auto pResults = std::make_shared<DbSearchResults>();
+    word64 qLastFlush = GetTickCount64();
+
+    // results are passed to the main thread in batches; the list view
+    // sorts them by score
+    auto flushResults = [&](bool blFinished)
+    {
+      const word32 lGeneration = pTask->Generation;
+      TThread::Queue(nullptr, _di_TThreadProcedure(
+        [this,pCancelFlag,lGeneration,pResults,blFinished]() {
+          // the form must not be accessed any more if the search has been
+          // cancelled
+          if (!*pCancelFlag)
+            ApplySearchResults(lGeneration, *pResults, blFinished);
+        }));
+      pResults = std::make_shared<DbSearchResults>();
+      qLastFlush = GetTickCount64();
+    };
+
+    for (word32 lI = 0; lI < pTask->Entries.size(); lI++) {
+      if (*pCancelFlag)
+        return;
+
+      for (word32 lPos = pTask->EntryOffsets[lI];
+           lPos < pTask->EntryOffsets[lI + 1]; ) {
+        const wchar_t* pwszSrc = pTask->Text + lPos;
+        const word32 lSrcLen = wcslen(pwszSrc);
+        lPos += lSrcLen + 1;
+        if (!pTask->CaseSensitive) {
+          if (lSrcLen + 1 > sBuf.Size())
+            sBuf.New(lSrcLen + 1);
+          wcscpy(sBuf, pwszSrc);
+          CharLower(sBuf);
+          pwszSrc = sBuf.c_str();
         }
+        float fScore;
+        if (pTask->Fuzzy)
+          fScore = fuzzyMatcher.Find(pwszSrc, fMinScore);
         else
-          psSrc = &pEntry->Strings[nI];
-        if (!psSrc->IsStrEmpty()) {
-          if (!blCaseSensitive) {
-            if (psSrc->Size() > sBuf.Size())
-              sBuf.New(psSrc->Size());
-            wcscpy(sBuf, psSrc->c_str());
-            CharLower(sBuf);
-            psSrc = &sBuf;
-          }
-          float fScore;
-          if (blFuzzy)
-            fScore = strFindFuzzy(psSrc->c_str(), sStr.c_str());
-          else
-            fScore = wcsstr(psSrc->c_str(), sStr.c_str()) ? 1 : 0;
-          if (fScore >= 0.5) {
-            pEntry->UserFlags |= DB_FLAG_FOUND;
-            pEntry->UserTag = fScore * 100;
-            //AddModifyListViewEntry(nullptr, pEntry);
-            nNumFound++;
-            break;
-          }
+          fScore = wcsstr(pwszSrc, pTask->Pattern.c_str()) ? 1 : 0;
+        if (fScore >= fMinScore) {
+          pResults->emplace_back(pTask->Entries[lI], fScore * 100);
+          break;
         }
       }
+
+      if (!pResults->empty() && GetTickCount64() - qLastFlush >=
+          SEARCH_RESULTS_UPDATE_INTERVAL)
+        flushResults(false);
     }
+
+    flushResults(true);
+  });
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswMngForm::CancelSearch(void)
+{
+  if (m_pSearchCancelFlag) {
+    *m_pSearchCancelFlag = true;
+    m_pSearchCancelFlag.reset();
+    SearchResultPanel->Caption = TRL("Search cancelled.");
   }
+  // results of previous queries are discarded
+  m_lSearchGeneration++;
+}
+//---------------------------------------------------------------------------
+// state of a strength audit running in the background; owned by the audit
+// task like DbSearchTask
+struct DbStrengthAuditTask {
+  TaskCancelToken CancelToken;
+  std::shared_ptr<PasswDbStrengthCache::Job> Job;
+};
 
-  //m_pSelectedItem = nullptr;
-  //SetItemChanged(false);
-  //ResetNavControls();
+void __fastcall TPasswMngForm::StartStrengthAudit(void)
+{
+  if (!IsDbOpen())
+    return;
 
-  //DbView->Items->EndUpdate();
+  // restart with the current set of passwords
+  CancelStrengthAudit();
 
-  DbView->Font->Color = DBVIEW_SEARCH_COLOR;
+  m_strengthCache.SetParams(g_config.UseAdvancedPasswEst,
+    getCommonPasswList());
 
-  //m_nNumSearchResults = nNumFound;
+  auto pTask = std::make_shared<DbStrengthAuditTask>();
+  pTask->Job = m_strengthCache.CreateJob(*m_passwDb);
+  if (!pTask->Job)
+    return;
 
-  //DbView->Selected = nullptr;
+  m_pStrengthCancelFlag = pTask->CancelToken.Get();
+  m_strengthListItems.reset();
+
+  TTask::Run([this,pTask]() {
+    auto pCancelFlag = pTask->CancelToken.Get();
+    auto pJob = pTask->Job;
+    const word32 lNumItems = pJob->Keys.size();
+    word32 lFlushStart = 0;
+    word64 qLastFlush = GetTickCount64();
+
+    // passwords are evaluated in parallel block by block; results are
+    // passed to the main thread in batches, like search results
+    for (word32 lStart = 0; lStart < lNumItems;
+         lStart += STRENGTH_AUDIT_BLOCK_SIZE) {
+      const word32 lEnd = std::min(lStart + STRENGTH_AUDIT_BLOCK_SIZE,
+        lNumItems);
+
+      ParallelFor(lEnd - lStart, [&](word32 lI)
+        {
+          if (!*pCancelFlag)
+            pJob->Evaluate(lStart + lI);
+        });
+
+      if (*pCancelFlag)
+        return;
 
-  ResetListView(RELOAD_TAGS);
+      if (lEnd == lNumItems || GetTickCount64() - qLastFlush >=
+          SEARCH_RESULTS_UPDATE_INTERVAL) {
+        TThread::Queue(nullptr, _di_TThreadProcedure(
+          [this,pCancelFlag,pJob,lFlushStart,lEnd]() {
+            if (!*pCancelFlag)
+              ApplyStrengthResults(*pJob, lFlushStart, lEnd);
+          }));
+        lFlushStart = lEnd;
+        qLastFlush = GetTickCount64();
+      }
+    }
+  });
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswMngForm::CancelStrengthAudit(void)
+{
+  if (m_pStrengthCancelFlag) {
+    *m_pStrengthCancelFlag = true;
+    m_pStrengthCancelFlag.reset();
+  }
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswMngForm::ApplyStrengthResults(
+  const PasswDbStrengthCache::Job& job,
+  word32 lStart,
+  word32 lEnd)
+{
+  m_strengthCache.AddResults(job, lStart, lEnd);
+
+  if (lEnd == job.Keys.size())
+    m_pStrengthCancelFlag.reset();
+
+  if (!(m_nShowColMask & (1 << DBVIEW_COL_PASSWSTRENGTH)) &&
+      m_nSortByIdx != DBVIEW_COL_PASSWSTRENGTH)
+    return;
+
+  // the list items are looked up by password hash; the map is built once
+  // per job and whenever the list view has been reset
+  if (!m_strengthListItems) {
+    m_strengthListItems.emplace();
+    for (int nI = 0; nI < DbView->Items->Count; nI++) {
+      TListItem* pItem = DbView->Items->Item[nI];
+      PasswDbEntry* pEntry = reinterpret_cast<PasswDbEntry*>(pItem->Data);
+      if (pEntry != nullptr && !pEntry->IsPasswEmpty())
+        m_strengthListItems->emplace(GetPasswHashKey(*pEntry), pItem);
+    }
+  }
+
+  DbView->Items->BeginUpdate();
+  for (word32 lI = lStart; lI < lEnd; lI++) {
+    auto range = m_strengthListItems->equal_range(job.Keys[lI]);
+    for (auto it = range.first; it != range.second; it++)
+      AddModifyListViewEntry(it->second,
+        reinterpret_cast<PasswDbEntry*>(it->second->Data));
+  }
+  // sorting all items is expensive, so the list is sorted only once after
+  // all passwords have been evaluated
+  if (m_nSortByIdx == DBVIEW_COL_PASSWSTRENGTH && lEnd == job.Keys.size())
+    DbView->AlphaSort();
+  DbView->Items->EndUpdate();
+}
+//---------------------------------------------------------------------------
+word32 __fastcall TPasswMngForm::UpdateExpiryFlags(
+  std::vector<PasswDbEntry*>* pChangedEntries)
+{
+  word32 lCurrDate, lExpirySoonDate;
+  getExpiryCheckDates(lCurrDate, lExpirySoonDate);
+
+  if (lCurrDate == m_lExpiryFlagsCurrDate &&
+      lExpirySoonDate == m_lExpiryFlagsSoonDate)
+    return 0;
+
+  // entries that had already expired at the last update remain expired
+  // (unless the system date has been set back), and entries expiring after
+  // both the previous and the current "expires soon" date have no flags, so
+  // only the range in between needs to be checked
+  const word32 lFrom = (lCurrDate >= m_lExpiryFlagsCurrDate) ?
+    m_lExpiryFlagsCurrDate : 0;
+  const word32 lTo = std::max(lExpirySoonDate, m_lExpiryFlagsSoonDate);
+
+  word32 lNumExpired = 0;
+  m_expiryIndex.ForEachInRange(lFrom, lTo,
+    [&](PasswDbEntry& entry)
+    {
+      const word32 lOldFlags = entry.UserFlags;
+      setExpiryFlags(entry, lCurrDate, lExpirySoonDate);
+      if (entry.UserFlags != lOldFlags) {
+        if (entry.UserFlags & DB_FLAG_EXPIRED)
+          lNumExpired++;
+        if (pChangedEntries)
+          pChangedEntries->push_back(&entry);
+      }
+    });
+
+  m_lExpiryFlagsCurrDate = lCurrDate;
+  m_lExpiryFlagsSoonDate = lExpirySoonDate;
+
+  return lNumExpired;
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswMngForm::ScheduleExpiryTimer(void)
+{
+  ExpiryTimer->Enabled = false;
+
+  if (!IsDbOpen() || m_expiryIndex.GetNumDates() == 0)
+    return;
+
+  word32 lCurrDate, lExpirySoonDate;
+  getExpiryCheckDates(lCurrDate, lExpirySoonDate);
+
+  // an entry expires at the beginning of its expiry date, and it starts
+  // to "expire soon" the configured number of days before
+  TDateTime nextEvent;
+  bool blEvent = false;
+  auto addEvent = [&](word32 lDate, int nDaysBefore)
+  {
+    int nYear, nMonth, nDay;
+    TDateTime eventTime;
+    if (lDate != 0 &&
+        PasswDbEntry::DecodeExpiryDate(lDate, nYear, nMonth, nDay) &&
+        TryEncodeDate(nYear, nMonth, nDay, eventTime)) {
+      eventTime = IncDay(eventTime, -nDaysBefore);
+      if (!blEvent || eventTime < nextEvent) {
+        nextEvent = eventTime;
+        blEvent = true;
+      }
+    }
+  };
+
+  addEvent(m_expiryIndex.GetNextDate(lCurrDate), 0);
+  addEvent(m_expiryIndex.GetNextDate(lExpirySoonDate), getExpirySoonNumDays());
 
-  SearchResultPanel->Caption = nNumFound == 1 ? TRL("1 entry found.") :
-    TRLFormat("%1 entries found.", { IntToStr(nNumFound) });
+  if (!blEvent)
+    return;
+
+  // the timer measures elapsed time and does not follow changes of the
+  // system clock, so limit the interval to one day; if nothing has changed
+  // when it fires, it is simply rescheduled
+  const word64 MAX_INTERVAL = 24 * 60 * 60 * 1000;
+  word64 qInterval = 1000;
+  if (nextEvent > Now())
+    qInterval += MilliSecondsBetween(nextEvent, Now());
 
-  //if (DbView->Items->Count > 0) {
-  //  DbView->Items->Item[0]->Selected = true;
-  //}
+  ExpiryTimer->Interval = std::min(qInterval, MAX_INTERVAL);
+  ExpiryTimer->Enabled = true;
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswMngForm::ApplySearchResults(word32 lGeneration,
+  const DbSearchResults& results,
+  bool blFinished)
+{
+  if (lGeneration != m_lSearchGeneration || !IsDbOpen() ||
+      m_nSearchMode == SEARCH_MODE_OFF)
+    return;
+
+  for (const auto& result : results) {
+    result.first->UserFlags |= DB_FLAG_FOUND;
+    result.first->UserTag = result.second;
+  }
+
+  m_lNumSearchResults += results.size();
+
+  if (blFinished) {
+    m_pSearchCancelFlag.reset();
+    ResetListView(RELOAD_TAGS);
+    SearchResultPanel->Caption = m_lNumSearchResults == 1 ?
+      TRL("1 entry found.") : TRLFormat("%1 entries found.",
+      { UIntToStr(m_lNumSearchResults) });
+  }
+  else {
+    ResetListView();
+    SearchResultPanel->Caption = TRLFormat("Searching ... %1 entries found.",
+      { UIntToStr(m_lNumSearchResults) });
+  }
 }
 //---------------------------------------------------------------------------
 void __fastcall TPasswMngForm::SearchDbForKeyword(bool blAutotype)
@@ -1348,6 +1640,9 @@ void __fastcall TPasswMngForm::SearchDbForKeyword(bool blAutotype)
   if (!IsDbOpen() || m_blItemChanged)
     return;
 
+  if (!blAutotype)
+    CancelSearch();
+
   PasswDbEntry* pFound = nullptr;
   WString sWinTitle;
   int nNumFound = 0;
@@ -1358,25 +1653,25 @@ void __fastcall TPasswMngForm::SearchDbForKeyword(bool blAutotype)
     wchar_t wszWinTitle[BUFSIZE];
     if (GetWindowText(hWin, wszWinTitle, BUFSIZE) != 0) {
       sWinTitle = wszWinTitle;
-      CharLower(wszWinTitle);
-      for (auto& pEntry : *m_passwDb) {
-        if (!blAutotype)
+
+      // keyword index is rebuilt lazily after the database has been edited
+      if (!m_keywordIndex.IsValid() ||
+          m_keywordIndex.GetNumEntries() != m_passwDb->Size)
+        m_keywordIndex.Build(*m_passwDb);
+
+      std::vector<PasswDbEntry*> matches;
+      m_keywordIndex.FindMatches(wszWinTitle, matches);
+      nNumFound = matches.size();
+      if (!matches.empty())
+        pFound = matches.front();
+
+      if (!blAutotype) {
+        for (auto& pEntry : *m_passwDb)
           pEntry->UserFlags &= ~DB_FLAG_FOUND;
-        if (!pEntry->Strings[PasswDbEntry::KEYWORD].IsStrEmpty()) {
-          SecureWString sKeyword = pEntry->Strings[PasswDbEntry::KEYWORD];
-          CharLower(sKeyword.Data());
-          if (wcsstr(wszWinTitle, sKeyword) != nullptr) {
-            nNumFound++;
-            if (pFound == nullptr)
-              pFound = pEntry.get();
-
-            if (blAutotype)
-              break;
-
-            // add "found" flag for the found item
-            pEntry->UserFlags |= DB_FLAG_FOUND;
-          }
-        }
+
+        // add "found" flag for the found items
+        for (auto pEntry : matches)
+          pEntry->UserFlags |= DB_FLAG_FOUND;
       }
     }
   }
@@ -1449,7 +1744,7 @@ void __fastcall TPasswMngForm::AddModifyListViewEntry(TListItem* pItem,
   bool blShowPassw = MainMenu_View_ShowPasswInList->Checked;
   const int MAX_NOTES_LEN = 200;
 
-  for (int nI = 0, nColIdx = 0; nI < PasswDbEntry::NUM_FIELDS; nI++) {
+  for (int nI = 0, nColIdx = 0; nI < DBVIEW_NUM_COLUMNS; nI++) {
     if (m_nShowColMask & (1 << nI)) {
       if (pEntry != nullptr) {
         const wchar_t* pwszSrc = nullptr;
@@ -1505,6 +1800,16 @@ void __fastcall TPasswMngForm::AddModifyListViewEntry(TListItem* pItem,
               pEntry->GetPasswHistory().GetSize()));
             pwszSrc = sCustomStr.c_str();
             break;
+          case DBVIEW_COL_PASSWSTRENGTH:
+            // empty until evaluated by the background audit
+            if (const auto pInfo = m_strengthCache.Find(*pEntry)) {
+              sCustomStr = pInfo->CommonPassw ?
+                TRLFormat("%1 bits (common password)",
+                  { IntToStr(pInfo->EntropyBits) }) :
+                TRLFormat("%1 bits", { IntToStr(pInfo->EntropyBits) });
+            }
+            pwszSrc = sCustomStr.c_str();
+            break;
           default:
             if (nI < PasswDbEntry::NUM_STRING_FIELDS)
               pwszSrc = pEntry->Strings[nI].c_str();
@@ -1586,7 +1891,7 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
     }
 
     pCols->Clear();
-    for (int nI = 0, nJ = 0; nI < PasswDbEntry::NUM_FIELDS; nI++) {
+    for (int nI = 0, nJ = 0; nI < DBVIEW_NUM_COLUMNS; nI++) {
       if (m_nShowColMask & (1 << nI)) {
         TListColumn* pCol = pCols->Add();
         pCol->Caption = m_uiFieldNames[nI];
@@ -1604,49 +1909,32 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
 
     //const PasswDbList& db = m_passwDb->GetDatabase();
 
+    // the tag index is kept up to date incrementally; rebuild it only if it
+    // has missed any changes
+    if (m_tagIndex.GetNumEntries() != m_passwDb->Size)
+      m_tagIndex.Build(*m_passwDb);
+    if (m_expiryIndex.GetNumEntries() != m_passwDb->Size) {
+      m_expiryIndex.Build(*m_passwDb);
+      m_lExpiryFlagsCurrDate = m_lExpiryFlagsSoonDate = 0;
+    }
+
     if (nFlags & RELOAD_TAGS) {
-      std::map<SecureWString, word32> tags, searchResultTags;
-      word32 lNumUntagged = 0;
-      word32 lNumUntaggedSearch = 0;
+      // tag counts of the search results are obtained by intersecting the
+      // tag bitsets with the bitset of found entries
+      PasswDbTagIndex::Bitset searchResultBits;
       word32 lNumSearchResults = 0;
-      for (const auto& pEntry : *m_passwDb) {
-        if (pEntry->GetTagList().size() == 0)
-          lNumUntagged++;
-        else {
-          for (const auto& sTag : pEntry->GetTagList()) {
-            auto ret = tags.emplace(sTag, 0);
-            ret.first->second++;
-          }
-        }
-        if (m_nSearchMode != SEARCH_MODE_OFF &&
-            (pEntry->UserFlags & DB_FLAG_FOUND)) {
-          lNumSearchResults++;
-          if (pEntry->GetTagList().size() == 0)
-            lNumUntaggedSearch++;
-          else {
-            for (const auto& sTag : pEntry->GetTagList()) {
-              auto ret = searchResultTags.emplace(sTag, 0);
-              ret.first->second++;
-            }
+      if (m_nSearchMode != SEARCH_MODE_OFF) {
+        for (const auto& pEntry : *m_passwDb) {
+          if (pEntry->UserFlags & DB_FLAG_FOUND) {
+            PasswDbTagIndex::SetBit(searchResultBits,
+              m_tagIndex.GetSlot(*pEntry));
+            lNumSearchResults++;
           }
         }
       }
 
-      //m_globalTags = tags;
-      //m_searchResultTags = searchResultTags;
-
-      m_globalCaseiTags.clear();
-      for (const auto& kv : tags) {
-        SecureWString ciTag(kv.first);
-        CharLower(ciTag.Data());
-        m_globalCaseiTags.emplace(ciTag, kv.first);
-      }
-
       m_tags.clear();
 
-      const auto& src = (m_nSearchMode == SEARCH_MODE_OFF) ? tags :
-        searchResultTags;
-
       TagView->Tag = 1;
       TagView->Clear();
       TagView->Items->BeginUpdate();
@@ -1661,15 +1949,21 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
 
       std::set<SecureWString> newTagFilter;
 
-      for (const auto& kv : src) {
+      for (const auto& kv : m_tagIndex.GetTags()) {
         const auto& sTag = kv.first;
+        const word32 lCount = (m_nSearchMode == SEARCH_MODE_OFF) ?
+          m_tagIndex.GetTagCount(kv.second) :
+          PasswDbTagIndex::CountAnd(m_tagIndex.GetTagBits(kv.second),
+            searchResultBits);
+        if (lCount == 0)
+          continue;
 
-        m_tags.emplace_back(sTag, kv.second);
+        m_tags.emplace_back(sTag, lCount);
 
         auto pItem = TagView->Items->Add();
 
         pItem->Caption = WString(sTag.c_str()) + Format(" (%d)",
-          ARRAYOFCONST((kv.second)));
+          ARRAYOFCONST((lCount)));
         pItem->ImageIndex = TAGVIEW_IMAGE_INDEX_START;
         pItem->Data = &m_tags.back();
 
@@ -1682,11 +1976,12 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
       word32 lBaseNumUntagged;
       bool blShowUntagged;
       if (m_nSearchMode == SEARCH_MODE_OFF) {
-        lBaseNumUntagged = lNumUntagged;
+        lBaseNumUntagged = m_tagIndex.GetNumUntagged();
         blShowUntagged = lBaseNumUntagged && lBaseNumUntagged < m_passwDb->Size;
       }
       else {
-        lBaseNumUntagged = lNumUntaggedSearch;
+        lBaseNumUntagged = PasswDbTagIndex::CountAnd(
+          m_tagIndex.GetUntaggedBits(), searchResultBits);
         blShowUntagged = lBaseNumUntagged && lBaseNumUntagged < lNumSearchResults;
       }
       if (blShowUntagged) {
@@ -1710,7 +2005,7 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
       SetScrollRange(TagView->Handle, SB_HORZ, 0, 0, true);
 
       TagMenu->Items->Clear();
-      for (const auto& kv : tags) {
+      for (const auto& kv : m_tagIndex.GetTags()) {
         auto pItem = new TMenuItem(TagMenu);
         pItem->Caption = ReplaceStr(WString(kv.first.c_str()), "&", "&&");
         pItem->OnClick = OnTagMenuItemClick;
@@ -1719,9 +2014,14 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
     }
 
     int nIdx = 0, nPrevSelIdx = -1;
-    word32 lCurrDate, lExpirySoonDate;
 
-    getExpiryCheckDates(lCurrDate, lExpirySoonDate);
+    UpdateExpiryFlags();
+    ScheduleExpiryTimer();
+
+    // estimation settings may have been changed in the meantime
+    if (m_strengthCache.SetParams(g_config.UseAdvancedPasswEst,
+          getCommonPasswList()))
+      StartStrengthAudit();
 
     enum class FilterType {
       None,
@@ -1737,6 +2037,10 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
       filterType = FilterType::WeakPassw;
     std::map<SecureWString, SecureWString> userNamesMap;
 
+    PasswDbTagIndex::Bitset tagFilterBits;
+    if (!m_tagFilter.empty())
+      tagFilterBits = m_tagIndex.GetFilterBits(m_tagFilter);
+
     for (const auto& pEntry : *m_passwDb) {
       if (!pEntry->Strings[PasswDbEntry::USERNAME].IsStrEmpty()) {
         SecureWString sUserNameLC = pEntry->Strings[PasswDbEntry::USERNAME];
@@ -1744,52 +2048,22 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
         userNamesMap.emplace(sUserNameLC, pEntry->Strings[PasswDbEntry::USERNAME]);
       }
 
-      pEntry->UserFlags &= ~(DB_FLAG_EXPIRED | DB_FLAG_EXPIRES_SOON);
-      if (pEntry->PasswExpiryDate != 0) {
-        if (lCurrDate >= pEntry->PasswExpiryDate)
-          pEntry->UserFlags |= DB_FLAG_EXPIRED;
-        else if (lExpirySoonDate >= pEntry->PasswExpiryDate)
-          pEntry->UserFlags |= DB_FLAG_EXPIRES_SOON;
-      }
-
       if ((filterType == FilterType::Expired && !(pEntry->UserFlags & DB_FLAG_EXPIRED)) ||
           (filterType == FilterType::ExpireSoon && !(pEntry->UserFlags & DB_FLAG_EXPIRES_SOON)) ||
           (m_nSearchMode != SEARCH_MODE_OFF && !(pEntry->UserFlags & DB_FLAG_FOUND)))
         continue;
 
       if (filterType == FilterType::WeakPassw) {
-        auto sPassw = m_passwDb->GetDbEntryPassw(*pEntry);
-        if (!sPassw.IsStrEmpty()) {
-          int nEntropyBits;
-          if (g_config.UseAdvancedPasswEst)
-            nEntropyBits = FloorEntropyBits(ZxcvbnMatch(
-              WStringToUtf8_s(sPassw).c_str(), nullptr, nullptr));
-          else
-            nEntropyBits = PasswordGenerator::EstimatePasswSecurity(sPassw.c_str());
-          if (nEntropyBits >= WEAK_PASSW_THRESHOLD)
-            continue;
-        }
-        else
+        // passwords not evaluated by the background audit yet are
+        // evaluated immediately
+        const auto pInfo = m_strengthCache.Get(*m_passwDb, *pEntry);
+        if (pInfo == nullptr || pInfo->EntropyBits >= WEAK_PASSW_THRESHOLD)
           continue;
       }
 
-      if (!m_tagFilter.empty()) {
-        bool blMatch = false;
-        if (pEntry->GetTagList().size() == 0) {
-          if (m_tagFilter.count(SecureWString()) != 0)
-            blMatch = true;
-        }
-        else {
-          for (const auto& sFilter : m_tagFilter) {
-            if (pEntry->CheckTag(sFilter)) {
-              blMatch = true;
-              break;
-            }
-          }
-        }
-        if (!blMatch)
-          continue;
-      }
+      if (!m_tagFilter.empty() && !PasswDbTagIndex::TestBit(tagFilterBits,
+           m_tagIndex.GetSlot(*pEntry)))
+        continue;
 
       AddModifyListViewEntry(nullptr, pEntry.get());
       if (pPrevSelData == pEntry.get())
@@ -1868,6 +2142,7 @@ void __fastcall TPasswMngForm::ResetListView(int nFlags)
 void __fastcall TPasswMngForm::ClearListView(void)
 {
   m_pSelectedItem = nullptr;
+  m_strengthListItems.reset();
   DbView->Clear();
   ClearEditPanel();
 }
@@ -2166,8 +2441,9 @@ void __fastcall TPasswMngForm::AddModifyBtnClick(TObject *Sender)
       SecureWString sCiTag = sTag;
       CharLower(sCiTag.Data());
 
-      auto it = m_globalCaseiTags.find(sCiTag);
-      if (it != m_globalCaseiTags.end())
+      const auto& globalCaseiTags = m_tagIndex.GetCaseiTags();
+      auto it = globalCaseiTags.find(sCiTag);
+      if (it != globalCaseiTags.end())
         newTags.emplace(it->first, it->second);
       else
         newTags.emplace(sCiTag, sTag);
@@ -2187,6 +2463,7 @@ void __fastcall TPasswMngForm::AddModifyBtnClick(TObject *Sender)
   if (blPasswChanged) {
     m_passwDb->SetDbEntryPassw(*pEntry, sPassw);
     pEntry->AddCurrentPasswToHistory(sOldPassw);
+    StartStrengthAudit();
   }
 
   word32 lExpiryDate = 0;
@@ -2196,22 +2473,21 @@ void __fastcall TPasswMngForm::AddModifyBtnClick(TObject *Sender)
     lExpiryDate = pEntry->EncodeExpiryDate(wYear, wMonth, wDay);
   }
   pEntry->PasswExpiryDate = lExpiryDate;
-  pEntry->PasswExpiryDateString = pEntry->ExpiryDateToString(lExpiryDate);
 
   pEntry->UpdateModificationTime(blPasswChanged);
 
+  m_searchIndex.UpdateEntry(*pEntry);
+  m_tagIndex.UpdateEntry(*pEntry);
+  m_keywordIndex.Invalidate();
+
+  if (m_expiryIndex.UpdateEntry(*pEntry)) {
+    word32 lCurrDate, lExpirySoonDate;
+    getExpiryCheckDates(lCurrDate, lExpirySoonDate);
+    setExpiryFlags(*pEntry, lCurrDate, lExpirySoonDate);
+    ScheduleExpiryTimer();
+  }
+
   if (m_tags.empty() && pEntry->GetTagList().empty()) {
-    pEntry->UserFlags &= ~(DB_FLAG_EXPIRED | DB_FLAG_EXPIRES_SOON);
-    if (lExpiryDate != 0) {
-      word32 lCurrDate, lExpirySoonDate;
-      getExpiryCheckDates(lCurrDate, lExpirySoonDate);
-      if (pEntry->PasswExpiryDate != 0) {
-        if (lCurrDate >= pEntry->PasswExpiryDate)
-          pEntry->UserFlags |= DB_FLAG_EXPIRED;
-        else if (lExpirySoonDate >= pEntry->PasswExpiryDate)
-          pEntry->UserFlags |= DB_FLAG_EXPIRES_SOON;
-      }
-    }
     AddModifyListViewEntry(m_pSelectedItem, pEntry);
     if (blNewEntry) {
       AddModifyListViewEntry();
@@ -2368,12 +2644,20 @@ void __fastcall TPasswMngForm::DeleteBtnClick(TObject *Sender)
   if (MsgBox(sMsg, MB_ICONWARNING + MB_YESNO + MB_DEFBUTTON2) == IDNO)
     return;
 
+  // pending search results may refer to deleted entries
+  CancelSearch();
+
   for (int nI = 0; nI < DbView->Items->Count; nI++) {
     if (DbView->Items->Item[nI]->Selected) {
       PasswDbEntry* pEntry = reinterpret_cast<PasswDbEntry*>
         (DbView->Items->Item[nI]->Data);
-      if (pEntry != nullptr)
+      if (pEntry != nullptr) {
+        m_searchIndex.RemoveEntry(*pEntry);
+        m_tagIndex.RemoveEntry(*pEntry);
+        m_expiryIndex.RemoveEntry(*pEntry);
+        m_keywordIndex.Invalidate();
         m_passwDb->DeleteDbEntry(*pEntry);
+      }
     }
   }
 
@@ -2442,6 +2726,15 @@ void __fastcall TPasswMngForm::DbViewCompare(TObject *Sender,
       Compare = (pEntry1->GetPasswHistory().GetSize() -
         pEntry2->GetPasswHistory().GetSize()) * m_nSortOrderFactor;
       break;
+    case DBVIEW_COL_PASSWSTRENGTH:
+    {
+      // empty and not yet evaluated passwords are treated as weakest
+      const auto pInfo1 = m_strengthCache.Find(*pEntry1);
+      const auto pInfo2 = m_strengthCache.Find(*pEntry2);
+      Compare = ((pInfo1 ? pInfo1->EntropyBits + 1 : 0) -
+        (pInfo2 ? pInfo2->EntropyBits + 1 : 0)) * m_nSortOrderFactor;
+      break;
+    }
     default:
       if (m_nSortByIdx < PasswDbEntry::NUM_STRING_FIELDS)
         Compare = _wcsicmp(pEntry1->Strings[m_nSortByIdx].c_str(),
@@ -2735,7 +3028,15 @@ void __fastcall TPasswMngForm::MainMenu_Edit_DuplicateEntryClick(
         }
         else
           sNewTitle.AssignStr(sCopyStr.c_str());
-        m_passwDb->DuplicateDbEntry(*pOriginal, sNewTitle);
+        PasswDbEntry* pDuplicate =
+          m_passwDb->DuplicateDbEntry(*pOriginal, sNewTitle);
+        m_searchIndex.AddEntry(*pDuplicate);
+        m_tagIndex.AddEntry(*pDuplicate);
+        m_expiryIndex.AddEntry(*pDuplicate);
+        m_keywordIndex.Invalidate();
+        // same expiry date as the original
+        pDuplicate->UserFlags |= pOriginal->UserFlags &
+          (DB_FLAG_EXPIRED | DB_FLAG_EXPIRES_SOON);
       }
     }
   }
@@ -2765,9 +3066,14 @@ void __fastcall TPasswMngForm::MainMenu_File_DbSettingsClick(
   s.DefaultExpiryDays = m_passwDb->DefaultPasswExpiryDays;
   s.DefaultMaxPasswHistorySize = m_passwDb->DefaultMaxPasswHistorySize;
   s.CipherType = m_passwDb->CipherType;
-  s.NumKdfRounds = m_passwDb->KdfIterations;
+  PasswDbKdfParam kdf = m_passwDb->KdfParam;
+  s.NumKdfRounds = kdf.Iterations;
+  s.KdfType = kdf.Type;
+  s.KdfMemoryCost = kdf.MemoryCost;
+  s.KdfParallelism = kdf.Parallelism;
   s.Compressed = m_passwDb->Compressed;
   s.CompressionLevel = m_passwDb->CompressionLevel;
+  s.CompressionAlgo = m_passwDb->CompressionAlgo;
 
   PasswDbSettingsDlg->SetSettings(s, m_passwDb->HasRecoveryKey);
   if (PasswDbSettingsDlg->ShowModal() == mrOk &&
@@ -2776,9 +3082,10 @@ void __fastcall TPasswMngForm::MainMenu_File_DbSettingsClick(
       m_passwDb->DefaultPasswExpiryDays != s.DefaultExpiryDays ||
       m_passwDb->DefaultMaxPasswHistorySize != s.DefaultMaxPasswHistorySize ||
       m_passwDb->CipherType != s.CipherType ||
-      m_passwDb->KdfIterations != s.NumKdfRounds ||
+      m_passwDb->KdfParam != kdf ||
       m_passwDb->Compressed != s.Compressed ||
-      m_passwDb->CompressionLevel != s.CompressionLevel))
+      m_passwDb->CompressionLevel != s.CompressionLevel ||
+      m_passwDb->CompressionAlgo != s.CompressionAlgo))
     SetDbChanged();
 }
 //---------------------------------------------------------------------------
@@ -2901,6 +3208,7 @@ void __fastcall TPasswMngForm::SearchBtnClick(TObject *Sender)
 
   WString sText = SearchBox->Text;
   if (sText.IsEmpty() && m_nSearchMode != SEARCH_MODE_OFF) {
+    CancelSearch();
     m_nSearchMode = SEARCH_MODE_OFF;
     ResetListView(RELOAD_TAGS);
     DbView->Font->Color = m_defaultListColor;
@@ -3386,8 +3694,13 @@ void __fastcall TPasswMngForm::MainMenu_View_SortTagsOrderClick(TObject *Sender)
 //---------------------------------------------------------------------------
 bool __fastcall TPasswMngForm::ApplyDbSettings(const PasswDbSettings& settings)
 {
-  if (!m_passwDb->HasRecoveryKey &&
-      settings.NumKdfRounds != m_passwDb->KdfIterations) {
+  PasswDbKdfParam kdf;
+  kdf.Type = settings.KdfType;
+  kdf.Iterations = settings.NumKdfRounds;
+  kdf.MemoryCost = settings.KdfMemoryCost;
+  kdf.Parallelism = settings.KdfParallelism;
+
+  if (!m_passwDb->HasRecoveryKey && kdf != m_passwDb->KdfParam) {
     auto key = RequestPasswAndCheck(TRL("Enter master password again"),
       TRL("Master password is invalid."), m_passwDb->CheckMasterKey);
 
@@ -3396,16 +3709,15 @@ bool __fastcall TPasswMngForm::ApplyDbSettings(const PasswDbSettings& settings)
 
     //std::atomic<bool> cancelFlag(false);
     TaskCancelToken cancelToken;
-    word32 lKdfIterations = settings.NumKdfRounds;
 
     // no need to create a thread-safe RNG instance if database doesn't
     // use a recovery key
     //RandomPool randPool(RandomPool::GetInstance());
 
-    auto pTask = TTask::Create([this,&key,&cancelToken,lKdfIterations]() {
+    auto pTask = TTask::Create([this,&key,&cancelToken,&kdf]() {
       m_passwDb->ChangeMasterKey(
         key,
-        lKdfIterations,
+        &kdf,
         cancelToken.Get().get());
     });
 
@@ -3418,7 +3730,7 @@ bool __fastcall TPasswMngForm::ApplyDbSettings(const PasswDbSettings& settings)
       if (nTimeout >= 1000 && !ProgressForm->Visible) {
         ProgressForm->ExecuteModal(
           PasswDbSettingsDlg,
-          TRL("Changing number of KDF iterations"),
+          TRL("Changing key derivation parameters"),
           TRL("Computing derived key ..."),
           cancelToken.Get(),
           [&pTask](unsigned int timeout)
@@ -3445,11 +3757,18 @@ bool __fastcall TPasswMngForm::ApplyDbSettings(const PasswDbSettings& settings)
     m_passwDb->CipherType = settings.CipherType;
   m_passwDb->Compressed = settings.Compressed;
   m_passwDb->CompressionLevel = settings.CompressionLevel;
+  m_passwDb->CompressionAlgo = settings.CompressionAlgo;
   //m_passwDb->KdfIterations = settings.NumKdfRounds;
 
   return true;
 }
 //---------------------------------------------------------------------------
+std::vector<PasswDbCompressionBenchmark> __fastcall
+  TPasswMngForm::BenchmarkDbCompression(void)
+{
+  return m_passwDb->BenchmarkCompression();
+}
+//---------------------------------------------------------------------------
 void __fastcall TPasswMngForm::EditKeyValBtnClick(TObject *Sender)
 {
   if (!m_passwDb->IsOpen() || m_pSelectedItem == nullptr)
@@ -3633,7 +3952,52 @@ void __fastcall TPasswMngForm::MainMenu_File_PropertiesClick(TObject *Sender)
       nExpiredEntries));
 
     PasswMngDbPropDlg->SetProperty(DbProperty::NumTags, IntToStr(
-      static_cast<int>(m_globalCaseiTags.size())));
+      static_cast<int>(m_tagIndex.GetCaseiTags().size())));
+
+    // the audit compares the keyed password hashes of the entries and looks
+    // up the passwords in the list of common passwords (if enabled)
+    PasswDbAuditResult audit;
+    Screen->Cursor = crHourGlass;
+    try {
+      PasswDbAudit dbAudit(*m_passwDb);
+      dbAudit.SetBlocklist(getCommonPasswList());
+      audit = dbAudit.Run();
+    }
+    __finally {
+      Screen->Cursor = crDefault;
+    }
+
+    PasswMngDbPropDlg->SetProperty(DbProperty::NumReusedPassw,
+      (audit.NumReusedEntries == 0) ? WString("0") :
+      TRLFormat("%1 (%2 different passwords)",
+        { UIntToStr(audit.NumReusedEntries),
+          UIntToStr(static_cast<word32>(audit.ReusedGroups.size())) }));
+
+    PasswMngDbPropDlg->SetProperty(DbProperty::NumHistoryReusedPassw,
+      UIntToStr(static_cast<word32>(audit.HistoryReused.size())));
+
+    if (g_config.TestCommonPassw)
+      PasswMngDbPropDlg->SetProperty(DbProperty::NumCommonPassw,
+        UIntToStr(static_cast<word32>(audit.Blocklisted.size())));
+
+    // strength estimates are taken from the cache, which may still be
+    // filled by the background audit
+    word32 lNumWeak = 0, lNumPending = 0;
+    for (const auto& pEntry : *m_passwDb) {
+      if (pEntry->IsPasswEmpty())
+        continue;
+      if (const auto pInfo = m_strengthCache.Find(*pEntry)) {
+        if (pInfo->EntropyBits < WEAK_PASSW_THRESHOLD)
+          lNumWeak++;
+      }
+      else
+        lNumPending++;
+    }
+
+    PasswMngDbPropDlg->SetProperty(DbProperty::NumWeakPassw,
+      (lNumPending == 0) ? UIntToStr(lNumWeak) :
+      TRLFormat("%1 (%2 not yet evaluated)",
+        { UIntToStr(lNumWeak), UIntToStr(lNumPending) }));
   }
   catch (Exception& e)
   {
@@ -3728,6 +4092,10 @@ void __fastcall TPasswMngForm::SetRecoveryKeyDependencies(void)
   PasswDbSettingsDlg->EncryptionAlgoList->Enabled = !blVal;
   PasswDbSettingsDlg->NumKdfRoundsBox->Enabled = !blVal;
   PasswDbSettingsDlg->CalcRoundsBtn->Enabled = !blVal;
+  PasswDbSettingsDlg->KdfTargetTimeBox->Enabled = !blVal;
+  PasswDbSettingsDlg->KdfTargetTimeSpinBtn->Enabled = !blVal;
+  PasswDbSettingsDlg->KdfTypeList->Enabled = !blVal;
+  PasswDbSettingsDlg->KdfTypeListChange(this);
 }
 //---------------------------------------------------------------------------
 void __fastcall TPasswMngForm::SearchMenu_SelectFieldsClick(TObject *Sender)
@@ -3939,6 +4307,8 @@ bool __fastcall TPasswMngForm::SaveDbOnShutdown(void)
 void __fastcall TPasswMngForm::OnEndSession(TWMEndSession& msg)
 {
   if (msg.EndSession) {
+    CancelSearch();
+    CancelStrengthAudit();
     m_passwDb.reset();
   }
   else {
@@ -4051,7 +4421,7 @@ void __fastcall TPasswMngForm::NotesBoxEnter(TObject *Sender)
     else if (m_pSelectedItem->Data && NotesBox->Tag == NOTES_TAG_HIDDEN) {
       ControlTagOverrider ovr(NotesBox, NOTES_TAG_CHANGING);
       auto pDbEntry = reinterpret_cast<PasswDbEntry*>(m_pSelectedItem->Data);
-      SetEditBoxTextBuf(NotesBox, pDbEntry->Strings[PasswDbEntry::NOTES]);
+      SetEditBoxTextBuf(NotesBox, pDbEntry->Strings[PasswDbEntry::NOTES].c_str());
     }
   }
 }
@@ -4083,7 +4453,7 @@ void __fastcall TPasswMngForm::ToggleNotesBtnClick(TObject *Sender)
       else if (m_pSelectedItem->Data) {
         auto pDbEntry = reinterpret_cast<PasswDbEntry*>(m_pSelectedItem->Data);
         ControlTagOverrider ovr(NotesBox, NOTES_TAG_CHANGING);
-        SetEditBoxTextBuf(NotesBox, pDbEntry->Strings[PasswDbEntry::NOTES]);
+        SetEditBoxTextBuf(NotesBox, pDbEntry->Strings[PasswDbEntry::NOTES].c_str());
       }
     }
   }
@@ -4096,4 +4466,38 @@ void __fastcall TPasswMngForm::NotesBoxChange(TObject *Sender)
   }
 }
 //---------------------------------------------------------------------------
+void __fastcall TPasswMngForm::ExpiryTimerTimer(TObject *Sender)
+{
+  ExpiryTimer->Enabled = false;
+
+  if (!IsDbOpen())
+    return;
+
+  std::vector<PasswDbEntry*> changedEntries;
+  word32 lNumExpired = UpdateExpiryFlags(&changedEntries);
 
+  if (!changedEntries.empty()) {
+    if (MainMenu_View_Filter_Expired->Checked ||
+        MainMenu_View_Filter_ExpireSoon->Checked)
+      ResetListView();
+    else {
+      std::set<PasswDbEntry*> changedSet(changedEntries.begin(),
+        changedEntries.end());
+      for (int nI = 0; nI < DbView->Items->Count; nI++) {
+        TListItem* pItem = DbView->Items->Item[nI];
+        PasswDbEntry* pEntry = reinterpret_cast<PasswDbEntry*>(pItem->Data);
+        if (pEntry != nullptr && changedSet.count(pEntry) != 0)
+          AddModifyListViewEntry(pItem, pEntry);
+      }
+    }
+
+    if (lNumExpired != 0 && g_config.Database.WarnExpiredEntries)
+      MainForm->ShowTrayInfo(lNumExpired == 1 ?
+        TRL("1 database entry has expired.") :
+        TRLFormat("%1 database entries have expired.",
+          { UIntToStr(lNumExpired) }), bfWarning);
+  }
+
+  ScheduleExpiryTimer();
+}
+//---------------------------------------------------------------------------
@@ -42,6 +42,7 @@
 #include <map>
 #include <list>
 #include <optional>
+#include <unordered_map>
 //---------------------------------------------------------------------------
 #include <ComCtrls.hpp>
 #include <Buttons.hpp>
@@ -53,8 +54,23 @@
 #include <Vcl.ImgList.hpp>
 #include <Vcl.ValEdit.hpp>
 #include "PasswDatabase.h"
+#include "PasswDbSearchIndex.h"
+#include "PasswDbTagIndex.h"
+#include "PasswDbExpiryIndex.h"
+#include "PasswDbKeywordIndex.h"
+#include "PasswDbAudit.h"
+#include "PasswDbStrengthCache.h"
 #include "PasswMngDbSettings.h"
 
+// columns of the database list view: fields of the database entries,
+// followed by columns derived from the entries
+const int
+  DBVIEW_COL_PASSWSTRENGTH = PasswDbEntry::NUM_FIELDS,
+  DBVIEW_NUM_COLUMNS       = PasswDbEntry::NUM_FIELDS + 1;
+
+// search results (entry and score) passed from the background search task
+typedef std::vector<std::pair<PasswDbEntry*,int>> DbSearchResults;
+
 class TSelectItemThread : public TThread
 {
 public:
@@ -243,6 +259,7 @@ __published:	// IDE-managed Components
   TMenuItem *MainMenu_File_ClearRecentFiles;
   TMenuItem *MainMenu_File_N6;
   TSpeedButton *ToggleNotesBtn;
+  TTimer *ExpiryTimer;
   void __fastcall MainMenu_File_NewClick(TObject *Sender);
   void __fastcall DbViewSelectItem(TObject *Sender,
     TListItem *Item, bool Selected);
@@ -347,10 +364,24 @@ __published:	// IDE-managed Components
   void __fastcall NotesBoxExit(TObject *Sender);
   void __fastcall ToggleNotesBtnClick(TObject *Sender);
   void __fastcall NotesBoxChange(TObject *Sender);
+  void __fastcall ExpiryTimerTimer(TObject *Sender);
 
 
 private:	// User declarations
   std::shared_ptr<PasswDatabase> m_passwDb;
+  PasswDbSearchIndex m_searchIndex;
+  PasswDbTagIndex m_tagIndex;
+  PasswDbExpiryIndex m_expiryIndex;
+  PasswDbKeywordIndex m_keywordIndex;
+  PasswDbStrengthCache m_strengthCache;
+  std::shared_ptr<std::atomic<bool>> m_pStrengthCancelFlag;
+  std::optional<std::unordered_multimap<PasswHashKey,TListItem*,
+    PasswHashKeyHasher>> m_strengthListItems;
+  word32 m_lExpiryFlagsCurrDate;
+  word32 m_lExpiryFlagsSoonDate;
+  std::shared_ptr<std::atomic<bool>> m_pSearchCancelFlag;
+  word32 m_lSearchGeneration;
+  word32 m_lNumSearchResults;
   std::unique_ptr<TSelectItemThread> m_dbViewSelItemThread;
   std::unique_ptr<TSelectItemThread> m_tagViewSelItemThread;
   WString m_sDbFileName;
@@ -375,10 +406,9 @@ private:	// User declarations
   int m_nSearchFlags;
   TColor m_defaultListColor;
   std::vector<int> m_listColWidths;
-  WString m_uiFieldNames[PasswDbEntry::NUM_FIELDS];
+  WString m_uiFieldNames[DBVIEW_NUM_COLUMNS];
   std::map<std::wstring, std::wstring> m_keyValNames;
   std::list<std::pair<SecureWString,word32>> m_tags;
-  std::map<SecureWString,SecureWString> m_globalCaseiTags;
   std::set<SecureWString> m_tagFilter;
   std::optional<PasswDbEntry::KeyValueList> m_tempKeyVal;
   std::optional<PasswDbEntry::PasswHistory> m_tempPasswHistory;
@@ -408,6 +438,14 @@ private:	// User declarations
   void __fastcall SetDbChanged(bool blChanged = true, bool blEntryChanged = false);
   void __fastcall SearchDatabase(WString sStr, int nFlags,
     bool blCaseSensitive, bool blFuzzy);
+  void __fastcall CancelSearch(void);
+  word32 __fastcall UpdateExpiryFlags(
+    std::vector<PasswDbEntry*>* pChangedEntries = nullptr);
+  void __fastcall ScheduleExpiryTimer(void);
+  void __fastcall StartStrengthAudit(void);
+  void __fastcall CancelStrengthAudit(void);
+  void __fastcall ApplyStrengthResults(const PasswDbStrengthCache::Job& job,
+    word32 lStart, word32 lEnd);
   const wchar_t* __fastcall DbKeyValNameToKey(const wchar_t* pwszName);
   void __fastcall MoveDbEntries(int nDir);
   void __fastcall OnTagMenuItemClick(TObject* Sender);
@@ -422,6 +460,8 @@ private:	// User declarations
   void __fastcall SetPasswQualityBarWidth(void);
   void __fastcall EstimatePasswQuality(const wchar_t* pwszPassw = nullptr);
   void __fastcall ApplyDbViewItemSelection(TListItem* pItem = nullptr);
+  void __fastcall ApplySearchResults(word32 lGeneration,
+    const DbSearchResults& results, bool blFinished);
   void __fastcall ApplyTagViewItemSelection(void);
   void __fastcall SetListViewSortFlag(void);
   void __fastcall OnQueryEndSession(TWMQueryEndSession& msg);
@@ -446,6 +486,8 @@ public:		// User declarations
   void __fastcall NotifyUserAction(void);
   void __fastcall SaveConfig(void);
   bool __fastcall ApplyDbSettings(const PasswDbSettings& settings);
+  std::vector<PasswDbCompressionBenchmark> __fastcall
+    BenchmarkDbCompression(void);
   SecureWString __fastcall BuildTranslKeyValString(
     const PasswDbEntry::KeyValueList& keyValList);
   void __fastcall OnEndSession(TWMEndSession& msg);
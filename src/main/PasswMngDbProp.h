@@ -40,7 +40,11 @@ enum class DbProperty : int {
   RecoveryKeySet,
   NumEntries,
   NumExpiredEntries,
-  NumTags
+  NumTags,
+  NumReusedPassw,
+  NumHistoryReusedPassw,
+  NumCommonPassw,
+  NumWeakPassw
 };
 
 //---------------------------------------------------------------------------
@@ -29,7 +29,7 @@
 #include "PasswManager.h"
 #include "FastPRNG.h"
 #include "CryptUtil.h"
-#include "hrtimer.h"
+#include "Argon2.h"
 #include "PasswDatabase.h"
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
@@ -48,6 +48,21 @@ const int CIPHER_KEY_SIZES[NUM_CIPHERS] =
   256, 256
 };
 
+const int NUM_KDFS = 2;
+const wchar_t* KDF_NAMES[NUM_KDFS] =
+{
+  L"PBKDF2-HMAC-SHA256",
+  L"Argon2id"
+};
+
+// order of entries in CompressionAlgoList
+const int NUM_COMPRESSION_ALGOS = 2;
+const int COMPRESSION_ALGOS[NUM_COMPRESSION_ALGOS] =
+{
+  PasswDatabase::COMPRESSION_DEFLATE,
+  PasswDatabase::COMPRESSION_LZO
+};
+
 const WString CONFIG_ID = "PasswMngDbSettings";
 
 //---------------------------------------------------------------------------
@@ -63,7 +78,14 @@ __fastcall TPasswDbSettingsDlg::TPasswDbSettingsDlg(TComponent* Owner)
     EncryptionAlgoList->Items->Add(sCipher);
   }
 
+  for (int i = 0; i < NUM_KDFS; i++)
+    KdfTypeList->Items->Add(KDF_NAMES[i]);
+
+  CompressionAlgoList->Items->Add(TRL("Deflate (high compression)"));
+  CompressionAlgoList->Items->Add(TRL("LZO (fast)"));
+
   PasswHistorySpinBtn->Max = PasswDatabase::MAX_PASSW_HISTORY_SIZE;
+  KdfMemorySpinBtn->Max = PasswDatabase::ARGON2_MAX_MEMORY_COST / 1024;
 
   if (g_pLangSupp) {
     TRLCaption(this);
@@ -74,10 +96,16 @@ __fastcall TPasswDbSettingsDlg::TPasswDbSettingsDlg(TComponent* Owner)
     TRLCaption(PasswFormatSeqLbl);
     TRLCaption(EncryptionAlgoLbl);
     TRLCaption(NumKdfRoundsLbl);
+    TRLCaption(KdfTargetTimeLbl);
+    TRLCaption(KdfTypeLbl);
+    TRLCaption(KdfMemoryLbl);
+    TRLCaption(KdfParallelismLbl);
     TRLCaption(DefaultExpiryLbl);
     TRLCaption(PasswHistoryLbl);
     TRLCaption(EnableCompressionCheck);
     TRLCaption(CompressionLevelLbl);
+    TRLCaption(CompressionAlgoLbl);
+    TRLCaption(CompressionBenchmarkBtn);
 
     TRLHint(PasswGenTestBtn);
     TRLHint(CalcRoundsBtn);
@@ -93,12 +121,16 @@ void __fastcall TPasswDbSettingsDlg::LoadConfig(void)
 {
   Height = g_pIni->ReadInteger(CONFIG_ID, "WindowHeight", Height);
   Width = g_pIni->ReadInteger(CONFIG_ID, "WindowWidth", Width);
+  KdfTargetTimeSpinBtn->Position = g_pIni->ReadInteger(CONFIG_ID,
+    "KdfTargetTime", KdfTargetTimeSpinBtn->Position);
 }
 //---------------------------------------------------------------------------
 void __fastcall TPasswDbSettingsDlg::SaveConfig(void)
 {
   g_pIni->WriteInteger(CONFIG_ID, "WindowHeight", Height);
   g_pIni->WriteInteger(CONFIG_ID, "WindowWidth", Width);
+  g_pIni->WriteInteger(CONFIG_ID, "KdfTargetTime",
+    KdfTargetTimeSpinBtn->Position);
 }
 //---------------------------------------------------------------------------
 PasswDbSettings __fastcall TPasswDbSettingsDlg::GetSettings(void)
@@ -110,8 +142,15 @@ PasswDbSettings __fastcall TPasswDbSettingsDlg::GetSettings(void)
   s.DefaultMaxPasswHistorySize = PasswHistorySpinBtn->Position;
   s.CipherType = EncryptionAlgoList->ItemIndex;
   s.NumKdfRounds = StrToUInt(NumKdfRoundsBox->Text);
+  s.KdfType = KdfTypeList->ItemIndex;
+  if (s.KdfType == PasswDatabase::KDF_ARGON2ID) {
+    s.KdfMemoryCost = KdfMemorySpinBtn->Position * 1024;
+    s.KdfParallelism = KdfParallelismSpinBtn->Position;
+  }
   s.Compressed = EnableCompressionCheck->Checked;
   s.CompressionLevel = s.Compressed ? CompressionLevelBar->Position : 0;
+  s.CompressionAlgo = COMPRESSION_ALGOS[std::max(0,
+    CompressionAlgoList->ItemIndex)];
   return s;
 }
 //---------------------------------------------------------------------------
@@ -126,8 +165,28 @@ void __fastcall TPasswDbSettingsDlg::SetSettings(const PasswDbSettings& s,
   EncryptionAlgoList->Enabled = !blHasRecoveryPassw;
   NumKdfRoundsBox->Text = IntToStr(static_cast<__int64>(s.NumKdfRounds));
   NumKdfRoundsBox->Enabled = !blHasRecoveryPassw;
+  KdfTypeList->ItemIndex = s.KdfType;
+  KdfTypeList->Enabled = !blHasRecoveryPassw;
+  if (s.KdfType == PasswDatabase::KDF_ARGON2ID) {
+    KdfMemorySpinBtn->Position = s.KdfMemoryCost / 1024;
+    KdfParallelismSpinBtn->Position = s.KdfParallelism;
+  }
+  else {
+    PasswDbKdfParam kdf = PasswDatabase::GetDefaultKdfParam(
+      PasswDatabase::KDF_ARGON2ID);
+    KdfMemorySpinBtn->Position = kdf.MemoryCost / 1024;
+    KdfParallelismSpinBtn->Position = kdf.Parallelism;
+  }
+  KdfTypeListChange(this);
   EnableCompressionCheck->Checked = s.Compressed;
   CompressionLevelBar->Position = s.Compressed ? s.CompressionLevel : 6;
+  CompressionAlgoList->ItemIndex = 0;
+  for (int i = 0; i < NUM_COMPRESSION_ALGOS; i++) {
+    if (COMPRESSION_ALGOS[i] == s.CompressionAlgo) {
+      CompressionAlgoList->ItemIndex = i;
+      break;
+    }
+  }
   EnableCompressionCheckClick(this);
 }
 //---------------------------------------------------------------------------
@@ -150,6 +209,17 @@ void __fastcall TPasswDbSettingsDlg::OKBtnClick(TObject *Sender)
     MsgBox(TRL("Invalid number of key derivation rounds."), MB_ICONERROR);
     return;
   }
+  if (KdfTypeList->ItemIndex == PasswDatabase::KDF_ARGON2ID) {
+    PasswDbKdfParam kdf;
+    kdf.Type = PasswDatabase::KDF_ARGON2ID;
+    kdf.Iterations = lKdfRounds;
+    kdf.MemoryCost = KdfMemorySpinBtn->Position * 1024;
+    kdf.Parallelism = KdfParallelismSpinBtn->Position;
+    if (!PasswDatabase::IsValidKdfParam(kdf)) {
+      MsgBox(TRL("Invalid Argon2 parameters."), MB_ICONERROR);
+      return;
+    }
+  }
   if (PasswMngForm->ApplyDbSettings(GetSettings()))
     ModalResult = mrOk;
 }
@@ -159,24 +229,13 @@ void __fastcall TPasswDbSettingsDlg::CalcRoundsBtnClick(TObject *Sender)
   Screen->Cursor = crHourGlass;
 
   try {
-    word8 key[32], salt[32], result[32];
-    g_fastRandGen.GetData(key, sizeof(key));
-    g_fastRandGen.GetData(salt, sizeof(salt));
-
-    const int ROUGH_EST_ROUNDS = 10000, TEST_FACTOR = 2;
-
-    Stopwatch clock;
-    pbkdf2_256bit(key, sizeof(key), salt, sizeof(salt), result, ROUGH_EST_ROUNDS);
-    word32 lRoughEstimate = TEST_FACTOR * lround(
-      ROUGH_EST_ROUNDS / clock.ElapsedSeconds());
-
-    clock.Reset();
-    pbkdf2_256bit(key, sizeof(key), salt, sizeof(salt), result, lRoughEstimate);
-
-    word32 lRoundsFor1s = std::max<word32>(1,
-      lround(lRoughEstimate / clock.ElapsedSeconds()));
-
-    NumKdfRoundsBox->Text = IntToStr(static_cast<__int64>(lRoundsFor1s));
+    word32 lRounds;
+    if (KdfTypeList->ItemIndex == PasswDatabase::KDF_ARGON2ID)
+      lRounds = argon2id_calibrate(KdfTargetTimeSpinBtn->Position,
+        KdfMemorySpinBtn->Position * 1024, KdfParallelismSpinBtn->Position);
+    else
+      lRounds = pbkdf2_calibrate(KdfTargetTimeSpinBtn->Position);
+    NumKdfRoundsBox->Text = IntToStr(static_cast<__int64>(lRounds));
   }
   __finally {
     Screen->Cursor = crDefault;
@@ -224,8 +283,73 @@ void __fastcall TPasswDbSettingsDlg::EnableCompressionCheckClick(TObject *Sender
 
 {
   bool blChecked = EnableCompressionCheck->Checked;
-  CompressionLevelBar->Enabled = blChecked;
-  CompressionLevelLbl->Enabled = blChecked;
+  CompressionAlgoLbl->Enabled = blChecked;
+  CompressionAlgoList->Enabled = blChecked;
+  CompressionAlgoListChange(this);
 }
 //---------------------------------------------------------------------------
+void __fastcall TPasswDbSettingsDlg::CompressionAlgoListChange(TObject *Sender)
+{
+  // compression level only applies to Deflate
+  bool blEnabled = EnableCompressionCheck->Checked &&
+    COMPRESSION_ALGOS[std::max(0, CompressionAlgoList->ItemIndex)] ==
+    PasswDatabase::COMPRESSION_DEFLATE;
+  CompressionLevelBar->Enabled = blEnabled;
+  CompressionLevelLbl->Enabled = blEnabled;
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswDbSettingsDlg::CompressionBenchmarkBtnClick(
+  TObject *Sender)
+{
+  std::vector<PasswDbCompressionBenchmark> results;
+
+  Screen->Cursor = crHourGlass;
 
+  try {
+    results = PasswMngForm->BenchmarkDbCompression();
+  }
+  __finally {
+    Screen->Cursor = crDefault;
+  }
+
+  if (results.empty())
+    return;
+
+  WString sMsg = TRLFormat("Size of serialized database entries: %1 bytes.",
+    { IntToStr(static_cast<__int64>(results.front().UncompressedSize)) }) +
+    WString("\n");
+
+  for (const auto& result : results) {
+    WString sAlgo = (result.Algo == PasswDatabase::COMPRESSION_LZO) ?
+      WString("LZO") : TRLFormat("Deflate (level %1)",
+        { IntToStr(result.Level) });
+    double dRatio = (result.UncompressedSize != 0) ? 100.0 *
+      result.CompressedSize / result.UncompressedSize : 100.0;
+    sMsg += "\n" + TRLFormat("%1: %2%% of original size,\n"
+      "compression %3 MB/s, decompression %4 MB/s",
+      { sAlgo,
+        FormatFloat("0.0", dRatio),
+        FormatFloat("0.0", result.CompressionSpeed),
+        FormatFloat("0.0", result.DecompressionSpeed) }) + "\n";
+  }
+
+  MsgBox(sMsg, MB_ICONINFORMATION);
+}
+//---------------------------------------------------------------------------
+void __fastcall TPasswDbSettingsDlg::KdfTypeListChange(TObject *Sender)
+{
+  bool blArgon2 = KdfTypeList->ItemIndex == PasswDatabase::KDF_ARGON2ID;
+  bool blEnabled = blArgon2 && KdfTypeList->Enabled;
+  KdfMemoryLbl->Enabled = blEnabled;
+  KdfMemoryBox->Enabled = blEnabled;
+  KdfMemorySpinBtn->Enabled = blEnabled;
+  KdfParallelismLbl->Enabled = blEnabled;
+  KdfParallelismBox->Enabled = blEnabled;
+  KdfParallelismSpinBtn->Enabled = blEnabled;
+
+  // number of rounds has a different meaning for each KDF
+  if (Sender == KdfTypeList)
+    NumKdfRoundsBox->Text = IntToStr(static_cast<__int64>(
+      PasswDatabase::GetDefaultKdfParam(KdfTypeList->ItemIndex).Iterations));
+}
+//---------------------------------------------------------------------------
@@ -38,8 +38,12 @@ struct PasswDbSettings {
   word32 DefaultMaxPasswHistorySize = 0;
   word32 CipherType = 0;
   word32 NumKdfRounds = 0;
+  int KdfType = 0;
+  word32 KdfMemoryCost = 0;
+  word32 KdfParallelism = 0;
   bool Compressed;
   int CompressionLevel;
+  int CompressionAlgo;
 };
 
 class TPasswDbSettingsDlg : public TForm
@@ -72,6 +76,20 @@ __published:	// IDE-managed Components
     TLabel *PasswHistoryLbl;
     TEdit *PasswHistoryBox;
     TUpDown *PasswHistorySpinBtn;
+  TLabel *KdfTargetTimeLbl;
+  TEdit *KdfTargetTimeBox;
+  TUpDown *KdfTargetTimeSpinBtn;
+  TLabel *KdfTypeLbl;
+  TComboBox *KdfTypeList;
+  TLabel *KdfMemoryLbl;
+  TEdit *KdfMemoryBox;
+  TUpDown *KdfMemorySpinBtn;
+  TLabel *KdfParallelismLbl;
+  TEdit *KdfParallelismBox;
+  TUpDown *KdfParallelismSpinBtn;
+  TLabel *CompressionAlgoLbl;
+  TComboBox *CompressionAlgoList;
+  TButton *CompressionBenchmarkBtn;
   void __fastcall FormShow(TObject *Sender);
   void __fastcall OKBtnClick(TObject *Sender);
   void __fastcall CalcRoundsBtnClick(TObject *Sender);
@@ -79,6 +97,9 @@ __published:	// IDE-managed Components
   void __fastcall PasswGenTestBtnClick(TObject *Sender);
   void __fastcall FormClose(TObject *Sender, TCloseAction &Action);
     void __fastcall EnableCompressionCheckClick(TObject *Sender);
+  void __fastcall KdfTypeListChange(TObject *Sender);
+  void __fastcall CompressionAlgoListChange(TObject *Sender);
+  void __fastcall CompressionBenchmarkBtnClick(TObject *Sender);
 private:	// User declarations
   void __fastcall LoadConfig(void);
 public:		// User declarations
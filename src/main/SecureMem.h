@@ -146,7 +146,7 @@ public:
   }
 
   // move constructor
-  SecureMem(SecureMem&& src)
+  SecureMem(SecureMem&& src) noexcept
     : m_pData(src.m_pData), m_lSize(src.m_lSize), m_lClearMark(src.m_lClearMark)
   {
     src.m_pData = nullptr;
@@ -210,7 +210,7 @@ public:
   }
 
   // swap content with that of another instance
-  void Swap(SecureMem& other)
+  void Swap(SecureMem& other) noexcept
   {
     std::swap(m_pData, other.m_pData);
     std::swap(m_lSize, other.m_lSize);
@@ -580,7 +580,7 @@ public:
     return *this;
   }
 
-  SecureMem& operator= (SecureMem&& src)
+  SecureMem& operator= (SecureMem&& src) noexcept
   {
     if (this != &src) {
       Swap(src);
@@ -21,6 +21,7 @@
 #include <vcl.h>
 #include <vector>
 #include <array>
+#include <unordered_map>
 #include <StrUtils.hpp>
 #pragma hdrstop
 
@@ -29,19 +30,30 @@
 #include "RandomPool.h"
 #include "sha1.h"
 #include "CryptUtil.h"
+#include "Argon2.h"
+#include "Parallel.h"
 #include "Main.h"
 #include "StringFileStreamW.h"
 #include "Language.h"
 #include "sha256.h"
 #include "sha512.h"
 #include "Util.h"
+#include "hrtimer.h"
+#include "ParallelDeflate.h"
+#ifdef _WIN64
+#include "../crypto/blake2/blake2.h"
+#else
+#include "../crypto/blake2/ref/blake2.h"
+#endif
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
 
 #define TEST_DECRYPTION
 
 static const word8
-  PASSW_DB_MAGIC[4] = { 'P', 'W', 'd', 'b' };
+  PASSW_DB_MAGIC[4] = { 'P', 'W', 'd', 'b' },
+  JOURNAL_MAGIC[4] = { 'P', 'W', 'j', 'r' },
+  JOURNAL_TRAILER_MAGIC[4] = { 'P', 'W', 'j', 't' };
 
 static const word32
   FH_FLAG_RECOVERY_KEY            = 1, // file header flags
@@ -52,7 +64,21 @@ static const word32
   FLAG_DEFAULT_PASSW_HISTORY_SIZE = 8,
 
   MAX_FILE_SIZE = 104857600,
-  DEFAULT_BUF_SIZE = 65536;
+  DEFAULT_BUF_SIZE = 65536,
+  FILE_PREFIX_LENGTH = 256, // covers recovery key block, IV and inner header
+
+  // the journal is compacted (i.e., the file is rewritten completely) if
+  // one of these limits is exceeded
+  JOURNAL_MAX_RECORDS = 64,
+  JOURNAL_MIN_SIZE_LIMIT = 65536, // max. size is max(limit, base size/4)
+  JOURNAL_MAX_AGE = 3600000,      // ms since last compaction
+  JOURNAL_RECORD_NUM_BASE = 0x80000000, // for distinguishing record and frame MACs
+  JOURNAL_TRAILER_NUM_BASE = 0xc0000000, // ... and trailer MACs
+
+  JOURNAL_SEGMENT_COPY = 0,  // range of entries from previous state
+  JOURNAL_SEGMENT_ENTRY = 1, // new or modified entry
+
+  SETTINGS_HASH_LENGTH = 32;
 
 static const char
   PARAMSTR_DEFAULT_USER_NAME[] = "DefUserName",
@@ -70,6 +96,12 @@ struct FileHeader {
   word32 KdfIterations;
 };
 
+// KDF parameters following the file header if KdfType == KDF_ARGON2ID
+struct KdfArgon2Header {
+  word32 MemoryCost;
+  word32 Parallelism;
+};
+
 struct PasswDbHeader {
   word8 Magic[4];
   word16 HeaderSize;
@@ -89,6 +121,41 @@ struct PasswHistoryHeader {
   word8 HistorySize;
   word8 MaxHistorySize;
 };
+
+// entry of the frame index following the field names (format version >= 1.6);
+// each frame contains a group of entries which is compressed, encrypted and
+// authenticated independently, so frames can be processed in parallel
+struct PasswDbFrameInfo {
+  word32 NumOfEntries;
+  word32 UncompressedSize;
+  word32 DataSize;      // size of (compressed) data
+  word32 EncryptedSize; // size of data aligned to cipher block size
+  word8 IV[16];
+  word8 Mac[32];        // HMAC-SHA256 of frame number and encrypted data
+};
+
+// header of a change journal record appended to the file (format version
+// >= 1.6); the encrypted data describe the new list of entries as a sequence
+// of segments referring either to entries of the previous state or to new/
+// modified entries
+struct JournalRecordHeader {
+  word8 Magic[4];
+  word32 DataSize;      // size of encrypted data
+  word8 IV[16];
+  word8 Mac[32];        // HMAC-SHA256 of record number, MAC of the previous
+                        // record (main HMAC for the first record), IV and data
+};
+
+// trailer following the base file and each journal record (format version
+// >= 1.6); when a record is appended, the previous trailer is wiped after
+// the new one has been written, so the file state is determined by the last
+// valid trailer, and journal records cannot be removed without this being
+// detected
+struct JournalTrailer {
+  word8 Magic[4];
+  word32 NumRecords;
+  word8 Mac[32];        // HMAC-SHA256 of record count and MAC of last record
+};
 #pragma pack()
 
 using namespace EncryptionAlgorithm;
@@ -99,6 +166,41 @@ inline void CheckKeyEmpty(const SecureMem<word8>& key)
     throw EPasswDbError("Specified \"key\" parameter is empty");
 }
 
+// computes keyed hash of the settings stored in the file header and main data
+// block; journal records can only be appended if the settings are unchanged
+// -> key for hashing
+// -> key length
+// -> file header
+// -> KDF parameters
+// -> inner header (entry count and sizes are ignored)
+// -> serialized global settings and field names
+// -> size of serialized data
+// <- hash (SETTINGS_HASH_LENGTH bytes)
+static SecureMem<word8> HashDbSettings(const word8* pKey,
+  word32 lKeyLen,
+  const FileHeader& fh,
+  const PasswDbKdfParam& kdf,
+  PasswDbHeader header,
+  const word8* pParams,
+  word32 lParamsLen)
+{
+  header.NumOfEntries = 0;
+  header.UncompressedSize = header.CompressedSize = 0;
+
+  blake2b_state state;
+  blake2b_init_key(&state, SETTINGS_HASH_LENGTH, pKey, lKeyLen);
+  blake2b_update(&state, &fh, sizeof(fh));
+  blake2b_update(&state, &kdf, sizeof(kdf));
+  blake2b_update(&state, &header, sizeof(header));
+  blake2b_update(&state, pParams, lParamsLen);
+
+  SecureMem<word8> hash(SETTINGS_HASH_LENGTH);
+  blake2b_final(&state, hash, SETTINGS_HASH_LENGTH);
+  memzero(&state, sizeof(state));
+  memzero(&header, sizeof(header));
+  return hash;
+}
+
 //---------------------------------------------------------------------------
 const char* PasswDbEntry::GetFieldName(FieldType type)
 {
@@ -164,6 +266,8 @@ SecureWString PasswDbEntry::ExpiryDateToString(word32 lDate)
 //---------------------------------------------------------------------------
 const SecureWString* PasswDbEntry::GetKeyValue(const wchar_t* pwszKey) const
 {
+  MaterializeKeyValueList();
+
   for (auto it = m_keyValueList.begin(); it != m_keyValueList.end(); it++)
   {
     if (_wcsicmp(it->first.c_str(), pwszKey) == 0) {
@@ -179,6 +283,8 @@ void PasswDbEntry::SetKeyValue(const wchar_t* pwszKey, const wchar_t* pwszValue)
   if (*pwszKey == '\0' || *pwszValue == '\0')
     return;
 
+  MaterializeKeyValueList();
+
   for (auto it = m_keyValueList.begin(); it != m_keyValueList.end(); it++)
   {
     if (_wcsicmp(it->first.c_str(), pwszKey) == 0) {
@@ -193,6 +299,9 @@ void PasswDbEntry::SetKeyValue(const wchar_t* pwszKey, const wchar_t* pwszValue)
 //---------------------------------------------------------------------------
 SecureWString PasswDbEntry::GetKeyValueListAsString(wchar_t sep) const
 {
+  if (!m_sKeyValueListSrc.IsEmpty())
+    return ConvertListSrc(m_sKeyValueListSrc, sep);
+
   if (m_keyValueList.empty())
     return SecureWString();
 
@@ -281,17 +390,42 @@ void PasswDbEntry::ParseKeyValueList(const SecureWString& sList)
 //---------------------------------------------------------------------------
 bool PasswDbEntry::CheckTag(const SecureWString& sTag) const
 {
+  MaterializeTagList();
   return m_tags.count(sTag) != 0;
 }
 //---------------------------------------------------------------------------
+void PasswDbEntry::ForEachTag(
+  const std::function<void(const wchar_t*, word32)>& func) const
+{
+  if (!m_sTagListSrc.IsEmpty()) {
+    // canonical list: non-empty tags separated by single '\n' characters
+    const wchar_t* p = m_sTagListSrc.c_str();
+    while (*p != '\0') {
+      const word32 lLen = wcscspn(p, L"\n");
+      func(p, lLen);
+      p += lLen;
+      if (*p != '\0')
+        p++;
+    }
+    return;
+  }
+
+  for (const auto& sTag : m_tags)
+    func(sTag.c_str(), sTag.StrLen());
+}
+//---------------------------------------------------------------------------
 bool PasswDbEntry::AddTag(const SecureWString& sTag)
 {
+  MaterializeTagList();
   auto ret = m_tags.insert(sTag);
   return ret.second;
 }
 //---------------------------------------------------------------------------
 SecureWString PasswDbEntry::GetTagsAsString(wchar_t sep) const
 {
+  if (!m_sTagListSrc.IsEmpty())
+    return ConvertListSrc(m_sTagListSrc, sep);
+
   if (m_tags.empty())
     return SecureWString();
 
@@ -351,14 +485,161 @@ void PasswDbEntry::ParseTagList(const SecureWString& sList)
   }*/
 }
 //---------------------------------------------------------------------------
-void PasswDbEntry::PasswHistory::AddEntry(const PasswHistoryEntry& entry,
+void PasswDbEntry::SetKeyValueListSrc(const SecureWString& sList)
+{
+  m_sKeyValueListSrc.Clear();
+  m_keyValueList.clear();
+
+  // a canonical list consists of non-empty "key=value" items separated by
+  // single '\n' characters
+  const wchar_t* p = sList.c_str();
+  bool blCanonical = *p != '\0';
+  while (blCanonical && *p != '\0') {
+    word32 lLen = wcscspn(p, L"\n");
+    const wchar_t* pEq = wmemchr(p, '=', lLen);
+    blCanonical = pEq != nullptr && pEq != p && pEq != p + lLen - 1;
+    p += lLen;
+    if (*p != '\0')
+      blCanonical = blCanonical && *++p != '\0';
+  }
+
+  if (blCanonical)
+    m_sKeyValueListSrc = sList;
+  else
+    ParseKeyValueList(sList);
+
+  UpdateKeyValueString();
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::SetTagListSrc(const SecureWString& sList)
+{
+  m_sTagListSrc.Clear();
+  m_tags.clear();
+
+  // a canonical list consists of non-empty tags separated by single '\n'
+  // characters, sorted in strictly ascending order as defined by the
+  // comparison operator of SecureWString (length first, then contents)
+  const wchar_t* p = sList.c_str();
+  const wchar_t* pPrev = nullptr;
+  word32 lPrevLen = 0;
+  bool blCanonical = *p != '\0';
+  while (blCanonical && *p != '\0') {
+    word32 lLen = wcscspn(p, L"\n");
+    blCanonical = lLen != 0 && (pPrev == nullptr || lPrevLen < lLen ||
+      (lPrevLen == lLen &&
+       memcmp(pPrev, p, lLen * sizeof(wchar_t)) < 0));
+    pPrev = p;
+    lPrevLen = lLen;
+    p += lLen;
+    if (*p != '\0')
+      blCanonical = blCanonical && *++p != '\0';
+  }
+
+  if (blCanonical)
+    m_sTagListSrc = sList;
+  else
+    ParseTagList(sList);
+
+  UpdateTagsString();
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::MaterializeKeyValueList(void) const
+{
+  if (!m_sKeyValueListSrc.IsEmpty()) {
+    SecureWString sList = m_sKeyValueListSrc;
+    m_sKeyValueListSrc.Clear();
+    const_cast<PasswDbEntry*>(this)->ParseKeyValueList(sList);
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::MaterializeTagList(void) const
+{
+  if (!m_sTagListSrc.IsEmpty()) {
+    SecureWString sList = m_sTagListSrc;
+    m_sTagListSrc.Clear();
+    const_cast<PasswDbEntry*>(this)->ParseTagList(sList);
+  }
+}
+//---------------------------------------------------------------------------
+SecureWString PasswDbEntry::ConvertListSrc(const PasswDbString& sSrc,
+  wchar_t sep)
+{
+  word32 lLen = sSrc.StrLen();
+  SecureWString sDest(sSrc.c_str(), lLen + 1);
+  if (sep != '\n') {
+    for (word32 lI = 0; lI < lLen; lI++) {
+      if (sDest[lI] == '\n')
+        sDest[lI] = sep;
+    }
+  }
+  return sDest;
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::RelocateStrings(void)
+{
+  for (auto& s : Strings)
+    s.Relocate();
+  m_sKeyValueListSrc.Relocate();
+  m_sTagListSrc.Relocate();
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::PasswHistory::AddEntry(PasswHistoryEntry entry,
   bool blToFront)
 {
-  if (m_blActive && !entry.second.IsStrEmpty()) {
-    m_history.insert(blToFront ? m_history.begin() : m_history.end(), entry);
-    if (m_history.size() > m_lMaxSize)
-      m_history.erase(m_history.begin() + m_lMaxSize, m_history.end());
+  if (!m_blActive || entry.second.IsStrEmpty())
+    return;
+
+  if (m_lSize == m_buf.size()) {
+    if (m_lSize < m_lMaxSize)
+      Reallocate(std::min(std::max(2 * m_lSize, 4u), m_lMaxSize));
+    else if (!blToFront)
+      return;
+  }
+
+  const word32 lCapacity = m_buf.size();
+  word32 lPos;
+  if (blToFront) {
+    // the slot preceding the head is either unused or holds the oldest
+    // entry if the history is full
+    lPos = m_lHead = (m_lHead + lCapacity - 1) % lCapacity;
+    if (m_lSize < lCapacity)
+      m_lSize++;
   }
+  else
+    lPos = (m_lHead + m_lSize++) % lCapacity;
+
+  PasswHistoryEntry& slot = m_buf[lPos];
+  slot.second.Clear();
+  slot.first = entry.first;
+  slot.second = std::move(entry.second);
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::PasswHistory::SetMaxSize(word32 lMaxSize)
+{
+  lMaxSize = std::max(1u, lMaxSize);
+  if (lMaxSize == m_lMaxSize)
+    return;
+
+  m_lMaxSize = lMaxSize;
+
+  // a larger buffer is allocated when needed
+  if (m_buf.size() > m_lMaxSize)
+    Reallocate(m_lMaxSize);
+}
+//---------------------------------------------------------------------------
+void PasswDbEntry::PasswHistory::Reallocate(word32 lCapacity)
+{
+  // the old buffer wipes the passwords of the dropped entries when
+  // destroyed
+  std::vector<PasswHistoryEntry> newBuf(lCapacity);
+  const word32 lNewSize = std::min(m_lSize, lCapacity);
+  const word32 lOldCapacity = m_buf.size();
+  for (word32 lI = 0; lI < lNewSize; lI++)
+    newBuf[lI] = std::move(m_buf[(m_lHead + lI) % lOldCapacity]);
+
+  m_buf.swap(newBuf);
+  m_lHead = 0;
+  m_lSize = lNewSize;
 }
 //---------------------------------------------------------------------------
 
@@ -367,10 +648,16 @@ PasswDatabase::PasswDatabase()
   : m_pSecMem(nullptr), m_blPlaintextPassw(false),
     m_lDbEntryId(0), m_lCryptBufPos(0), m_nLastVersion(0),
     m_dbOpenState(DbOpenState::Closed),
-    m_bCipherType(CIPHER_AES256), m_lKdfIterations(KEY_HASH_ITERATIONS),
+    m_bCipherType(CIPHER_AES256), m_bKdfType(KDF_PBKDF2_SHA256),
+    m_lKdfIterations(KEY_HASH_ITERATIONS), m_lKdfMemoryCost(0),
+    m_lKdfParallelism(0),
     m_lDefaultPasswExpiryDays(0), m_lDefaultMaxPasswHistorySize(0),
     m_blRecoveryKey(false), m_blCompressed(false),
-    m_nCompressionLevel(0)
+    m_nCompressionLevel(0), m_nCompressionAlgo(COMPRESSION_DEFLATE),
+    m_pFileKey(nullptr), m_blJournalValid(false),
+    m_qSavedFileSize(0), m_lBaseSize(0), m_lJournalSize(0),
+    m_lNumJournalRecords(0), m_qLastCompactionTime(0),
+    m_blJournalIncomplete(false)
 {
 }
 //---------------------------------------------------------------------------
@@ -389,7 +676,10 @@ void PasswDatabase::Close(void)
   }
 
   m_bCipherType = CIPHER_AES256;
+  m_bKdfType = KDF_PBKDF2_SHA256;
   m_lKdfIterations = KEY_HASH_ITERATIONS;
+  m_lKdfMemoryCost = 0;
+  m_lKdfParallelism = 0;
   m_lDefaultPasswExpiryDays = 0;
   m_cryptBuf.Clear();
 
@@ -397,6 +687,7 @@ void PasswDatabase::Close(void)
   //  delete pEntry;
 
   m_db.clear();
+  m_stringArena.Clear();
   m_pFile.reset();
   m_lDbEntryId = 0;
   m_lCryptBufPos = 0;
@@ -405,6 +696,17 @@ void PasswDatabase::Close(void)
   m_blRecoveryKey = false;
   m_blCompressed = false;
   m_nCompressionLevel = 0;
+  m_nCompressionAlgo = COMPRESSION_DEFLATE;
+  m_blJournalValid = false;
+  m_sSavedFileName = WString();
+  m_qSavedFileSize = 0;
+  m_lBaseSize = 0;
+  m_lJournalSize = 0;
+  m_lNumJournalRecords = 0;
+  m_savedEntries.clear();
+  m_journalMac.Clear();
+  m_blJournalIncomplete = false;
+  m_savedSettingsHash.Clear();
 }
 //---------------------------------------------------------------------------
 void PasswDatabase::Initialize(const SecureMem<word8>& key)
@@ -415,6 +717,8 @@ void PasswDatabase::Initialize(const SecureMem<word8>& key)
   // - database master key (32 bytes)
   // - database salt (32 bytes)
   // - database recovery key block (128 bytes), if recovery key is set
+  // - key of the database file saved/opened last (32 bytes), needed for
+  //   appending journal records
 
   m_pSecMem = reinterpret_cast<word8*>(
     VirtualAlloc(nullptr, SECMEM_SIZE, MEM_COMMIT, PAGE_READWRITE));
@@ -449,14 +753,196 @@ void PasswDatabase::Initialize(const SecureMem<word8>& key)
   if (m_blRecoveryKey)
     memcpy(m_pDbKey, key, key.Size());
   else
-    pbkdf2_256bit(key, key.Size(), m_pDbSalt, DB_SALT_LENGTH, m_pDbKey, m_lKdfIterations);
+    DeriveKey(key, m_pDbSalt, m_pDbKey, GetKdfParam());
 
   m_pDbRecoveryKeyBlock = pMemOffset;
   pMemOffset += DB_RECOVERY_KEY_BLOCK_LENGTH;
 
+  m_pFileKey = pMemOffset;
+  pMemOffset += DB_KEY_LENGTH;
+
   randPool.Flush();
 }
 //---------------------------------------------------------------------------
+void PasswDatabase::DeriveKey(const SecureMem<word8>& key,
+  const word8* pSalt,
+  word8* pDerivedKey,
+  const PasswDbKdfParam& kdf,
+  std::atomic<bool>* pCancelFlag)
+{
+  switch (kdf.Type) {
+  case KDF_PBKDF2_SHA256:
+    pbkdf2_256bit(key, key.Size(), pSalt, DB_SALT_LENGTH, pDerivedKey,
+      kdf.Iterations, pCancelFlag);
+    break;
+  case KDF_ARGON2ID:
+    argon2id(key, key.Size(), pSalt, DB_SALT_LENGTH, pDerivedKey,
+      DB_KEY_LENGTH, kdf.Iterations, kdf.MemoryCost, kdf.Parallelism,
+      pCancelFlag);
+    break;
+  default:
+    throw EPasswDbError("Key derivation function not supported");
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::DeriveRecoverySlotKeys(const SecureMem<word8>& key,
+  const word8* pRecoveryKeyBlock,
+  word8* pDerivedKeys,
+  const PasswDbKdfParam& kdf)
+{
+  const word32 lSlotSize = DB_SALT_LENGTH + DB_KEY_LENGTH;
+  if (kdf.Type == KDF_PBKDF2_SHA256 && pbkdf2_multi_is_parallel(2)) {
+    // multi-buffer PBKDF2 derives both keys in parallel SIMD lanes
+    Pbkdf2Params params[2];
+    for (int i = 0; i < 2; i++) {
+      params[i].Passw = key;
+      params[i].PasswLen = key.Size();
+      params[i].Salt = pRecoveryKeyBlock + i * lSlotSize;
+      params[i].SaltLen = DB_SALT_LENGTH;
+      params[i].DerivedKey = pDerivedKeys + i * DB_KEY_LENGTH;
+    }
+    pbkdf2_256bit_multi(params, 2, kdf.Iterations);
+  }
+  else {
+    // otherwise, derive the keys on two threads
+    ParallelFor(2, [&](word32 i) {
+      DeriveKey(key, pRecoveryKeyBlock + i * lSlotSize,
+        pDerivedKeys + i * DB_KEY_LENGTH, kdf);
+    }, 2);
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::ComputeFrameMac(const word8* pKey,
+  word32 lFrameNum,
+  const word8* pData,
+  word32 lDataLen,
+  word8* pMac,
+  const word8* pAddData,
+  word32 lAddDataLen)
+{
+  // include frame number to prevent frames from being swapped
+  SecureMem<sha256_context> hashCtx(1);
+  sha256_init(hashCtx);
+  sha256_hmac_starts(hashCtx, pKey, DB_KEY_LENGTH, 0);
+  sha256_hmac_update(hashCtx, reinterpret_cast<const word8*>(&lFrameNum), 4);
+  if (pAddData != nullptr)
+    sha256_hmac_update(hashCtx, pAddData, lAddDataLen);
+  sha256_hmac_update(hashCtx, pData, lDataLen);
+  sha256_hmac_finish(hashCtx, pMac);
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::ComputeJournalTrailerMac(const word8* pKey,
+  word32 lNumRecords,
+  const SecureMem<word8>& chainMac,
+  word8* pMac)
+{
+  ComputeFrameMac(pKey, JOURNAL_TRAILER_NUM_BASE + lNumRecords, chainMac,
+    chainMac.Size(), pMac);
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<DataCompressor> PasswDatabase::CreateCompressor(int nAlgo,
+  int nLevel)
+{
+  if (nAlgo == COMPRESSION_LZO)
+    return std::unique_ptr<DataCompressor>(new LzoCompress);
+  return std::unique_ptr<DataCompressor>(new Deflate(nLevel));
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<DataCompressor> PasswDatabase::CreateDecompressor(int nAlgo)
+{
+  if (nAlgo == COMPRESSION_LZO)
+    return std::unique_ptr<DataCompressor>(new LzoDecompress);
+  return std::unique_ptr<DataCompressor>(new Inflate);
+}
+//---------------------------------------------------------------------------
+word32 PasswDatabase::CompressBlock(int nAlgo,
+  int nLevel,
+  const word8* pSrc,
+  word32 lSrcSize,
+  SecureMem<word8>& dest,
+  word32 lReserve)
+{
+  SecureMem<word8> workBuf(DEFAULT_BUF_SIZE);
+  auto pCompr = CreateCompressor(nAlgo, nLevel);
+  word32 lToCompress = lSrcSize, lBufPos = 0;
+  bool blFinished;
+  dest.New(DEFAULT_BUF_SIZE);
+  do {
+    word32 lChunkSize;
+    blFinished = pCompr->Process(
+      pSrc,
+      lToCompress,
+      workBuf,
+      workBuf.Size(),
+      true,
+      lChunkSize);
+    if (lChunkSize) {
+      dest.BufferedGrow(lBufPos + lChunkSize + lReserve);
+      dest.Copy(lBufPos, workBuf, lChunkSize);
+      lBufPos += lChunkSize;
+    }
+    lToCompress = 0;
+  } while (!blFinished);
+  return lBufPos;
+}
+//---------------------------------------------------------------------------
+bool PasswDatabase::DecompressBlock(int nAlgo,
+  const word8* pSrc,
+  word32 lSrcSize,
+  SecureMem<word8>& dest,
+  word32 lDestSize)
+{
+  // reserve one extra byte to detect excess data
+  dest.New(lDestSize + 1);
+  try {
+    auto pDecompr = CreateDecompressor(nAlgo);
+    word32 lAvailOut;
+    return pDecompr->Process(pSrc, lSrcSize, dest, dest.Size(), true,
+        lAvailOut) && lAvailOut == lDestSize;
+  }
+  catch (CompressorError&) {
+    return false;
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::HashDbEntry(const word8* pData,
+  word32 lDataLen,
+  word8* pHash) const
+{
+  blake2b(pHash, ENTRY_HASH_LENGTH, pData, lDataLen, m_pMemSalt,
+    SECMEM_SALT_LENGTH);
+}
+//---------------------------------------------------------------------------
+PasswDbKdfParam PasswDatabase::GetDefaultKdfParam(int nType)
+{
+  PasswDbKdfParam kdf;
+  kdf.Type = nType;
+  if (nType == KDF_ARGON2ID) {
+    kdf.Iterations = ARGON2_DEFAULT_TIME_COST;
+    kdf.MemoryCost = ARGON2_DEFAULT_MEMORY_COST;
+    kdf.Parallelism = ARGON2_DEFAULT_PARALLELISM;
+  }
+  else
+    kdf.Iterations = KEY_HASH_ITERATIONS;
+  return kdf;
+}
+//---------------------------------------------------------------------------
+bool PasswDatabase::IsValidKdfParam(const PasswDbKdfParam& kdf)
+{
+  switch (kdf.Type) {
+  case KDF_PBKDF2_SHA256:
+    return kdf.Iterations != 0;
+  case KDF_ARGON2ID:
+    return kdf.Iterations >= ARGON2_MIN_TIME_COST &&
+      kdf.Parallelism >= ARGON2_MIN_PARALLELISM &&
+      kdf.Parallelism <= ARGON2_MAX_PARALLELISM &&
+      kdf.MemoryCost >= 2 * ARGON2_SYNC_POINTS * kdf.Parallelism &&
+      kdf.MemoryCost <= ARGON2_MAX_MEMORY_COST;
+  default:
+    return false;
+  }
+}
+//---------------------------------------------------------------------------
 void PasswDatabase::CheckDbNotOpen(void)
 {
   switch (m_dbOpenState) {
@@ -537,168 +1023,311 @@ void PasswDatabase::Open(const SecureMem<word8>& key,
   if (fh.HashType > HASH_SHA512)
     throw EPasswDbInvalidFormat("Hash algorithm not supported");
 
-  if (fh.KdfType > KDF_PBKDF2_SHA256)
+  if (fh.KdfType > KDF_ARGON2ID)
     throw EPasswDbInvalidFormat("Key derivation function not supported");
 
   if (fh.KdfIterations == 0)
     throw EPasswDbInvalidFormat("Invalid number of KDF iterations");
 
+  PasswDbKdfParam kdf;
+  kdf.Type = fh.KdfType;
+  kdf.Iterations = fh.KdfIterations;
+
+  if (fh.KdfType == KDF_ARGON2ID) {
+    if (fh.HeaderSize < sizeof(fh) + sizeof(KdfArgon2Header))
+      throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+    KdfArgon2Header kh;
+    pFile->Read(&kh, static_cast<int>(sizeof(kh)));
+    kdf.MemoryCost = kh.MemoryCost;
+    kdf.Parallelism = kh.Parallelism;
+  }
+
+  if (!IsValidKdfParam(kdf))
+    throw EPasswDbInvalidFormat("Invalid KDF parameters");
+
   m_bCipherType = fh.CipherType;
-  m_lKdfIterations = fh.KdfIterations;
+  m_bKdfType = kdf.Type;
+  m_lKdfIterations = kdf.Iterations;
+  m_lKdfMemoryCost = kdf.MemoryCost;
+  m_lKdfParallelism = kdf.Parallelism;
   m_blRecoveryKey = fh.Version >= 0x103 && fh.Flags & FH_FLAG_RECOVERY_KEY;
 
-  word32 lFileSize = pFile->Size - fh.HeaderSize;
-  m_cryptBuf.New(std::max(1024u, lFileSize));
+  const word32 lFileSize = pFile->Size - fh.HeaderSize;
 
-  SecureMem<word8> masterKey;
-  word32 lBufPos, lCryptParamLen, lHmacLen;
-  PasswDbHeader header;
+  // read plaintext crypto parameters (salt or recovery key block, IV) and
+  // encrypted inner header; the file is read only once
+  SecureMem<word8> prefix(std::min(lFileSize, FILE_PREFIX_LENGTH));
+  pFile->Seek(fh.HeaderSize, soFromBeginning);
+  pFile->Read(prefix, static_cast<int>(prefix.Size()));
 
-  for (int nKeyNum = 0; nKeyNum < 2; nKeyNum++) {
-    // read entire file contents without header
-    pFile->Seek(fh.HeaderSize, soFromBeginning);
-    pFile->Read(m_cryptBuf, static_cast<int>(lFileSize));
+  // if a recovery key is set, the password may match either of the two
+  // key slots, so derive both keys concurrently
+  const int nNumKeys = m_blRecoveryKey ? 2 : 1;
+  SecureMem<word8> derivedKeys(nNumKeys * DB_KEY_LENGTH);
+  word32 lBufPos;
 
-    SecureMem<word8> derivedKey(DB_KEY_LENGTH);
+  if (m_blRecoveryKey) {
+    if (prefix.Size() < DB_RECOVERY_KEY_BLOCK_LENGTH)
+      throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+    DeriveRecoverySlotKeys(key, prefix, derivedKeys, kdf);
+    lBufPos = DB_RECOVERY_KEY_BLOCK_LENGTH;
+  }
+  else {
+    DeriveKey(key, prefix, derivedKeys, kdf);
+    lBufPos = DB_SALT_LENGTH;
+  }
 
-    if (m_blRecoveryKey) {
-      lBufPos = (DB_SALT_LENGTH + DB_KEY_LENGTH) * nKeyNum;
-      pbkdf2_256bit(key, key.Size(),
-        &m_cryptBuf[lBufPos], DB_SALT_LENGTH, derivedKey, fh.KdfIterations);
+  // find the keys that decrypt the inner header correctly before
+  // decrypting the rest of the file; with a recovery key, the magic may
+  // also match with the wrong slot by chance, so all matching slots are
+  // tried until the HMAC is valid
+  SecureMem<word8> keySrc(DB_KEY_LENGTH);
+  std::unique_ptr<SymmetricCipher> cipher;
+  SecureMem<word8> headerBuf;
+  PasswDbHeader header;
+  std::vector<int> keyCandidates;
 
+  auto decryptHeader = [&](int nKeyNum) {
+    if (m_blRecoveryKey) {
       // decrypt master key
-      auto cipher = CreateCipher(fh.CipherType, derivedKey,
+      word32 lSlotPos = (DB_SALT_LENGTH + DB_KEY_LENGTH) * nKeyNum;
+      auto slotCipher = CreateCipher(fh.CipherType,
+        &derivedKeys[DB_KEY_LENGTH * nKeyNum],
         EncryptionAlgorithm::Mode::DECRYPT);
-      cipher->SetIV(&m_cryptBuf[lBufPos]);
-      masterKey.New(DB_KEY_LENGTH);
-      cipher->Decrypt(
-        &m_cryptBuf[lBufPos + DB_SALT_LENGTH], masterKey, DB_KEY_LENGTH);
-
-      lBufPos = DB_RECOVERY_KEY_BLOCK_LENGTH;
-    }
-    else {
-      pbkdf2_256bit(key, key.Size(), m_cryptBuf, DB_SALT_LENGTH, derivedKey,
-        fh.KdfIterations);
-      lBufPos = DB_SALT_LENGTH;
+      slotCipher->SetIV(&prefix[lSlotPos]);
+      slotCipher->Decrypt(
+        &prefix[lSlotPos + DB_SALT_LENGTH], keySrc, DB_KEY_LENGTH);
     }
+    else
+      memcpy(keySrc, derivedKeys, DB_KEY_LENGTH);
 
     // do key setup
-    const auto& keySrc = m_blRecoveryKey ? masterKey : derivedKey;
-    auto cipher = CreateCipher(fh.CipherType, keySrc,
+    cipher = CreateCipher(fh.CipherType, keySrc,
       EncryptionAlgorithm::Mode::DECRYPT);
 
-    cipher->SetIV(&m_cryptBuf[lBufPos]);
-    lBufPos += cipher->GetIVSize();
-    lCryptParamLen = lBufPos;
+    word32 lIVLen = cipher->GetIVSize();
+    word32 lAlignedHeaderSize =
+      alignToBlockSize(sizeof(header), cipher->GetBlockSize());
+    if (lBufPos + lIVLen + lAlignedHeaderSize > prefix.Size())
+      throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
 
-    word32 lHmacLen = fh.HashType == HASH_SHA256 ? SHA256_HMAC_LENGTH :
-      SHA512_HMAC_LENGTH;
-    SecureMem<word8> hmac(lHmacLen);
-    if (fh.Version >= 0x101)
-      memcpy(hmac, &m_cryptBuf[lFileSize - lHmacLen], lHmacLen);
+    cipher->SetIV(&prefix[lBufPos]);
 
     // decrypt first N blocks
-    //word32 lBlockLen = cipher->GetBlockSize();
-    word32 lAlignedHeaderSize =
-      alignToBlockSize(sizeof(header), cipher->GetBlockSize());
+    headerBuf.New(lAlignedHeaderSize);
+    cipher->Decrypt(&prefix[lBufPos + lIVLen], headerBuf, lAlignedHeaderSize);
 
-    cipher->Decrypt(&m_cryptBuf[lBufPos], &m_cryptBuf[lBufPos], lAlignedHeaderSize);
+    return memcmp(headerBuf, PASSW_DB_MAGIC, sizeof(PASSW_DB_MAGIC)) == 0;
+  };
 
-    memcpy(&header, &m_cryptBuf[lBufPos], sizeof(header));
+  for (int nKeyNum = 0; nKeyNum < nNumKeys; nKeyNum++) {
+    if (decryptHeader(nKeyNum))
+      keyCandidates.push_back(nKeyNum);
+  }
 
-    if (memcmp(header.Magic, PASSW_DB_MAGIC, sizeof(PASSW_DB_MAGIC)) != 0) {
-      if (m_blRecoveryKey && nKeyNum == 0)
-        continue;
-      else
-        throw EPasswDbInvalidKey(TRL("Database not encrypted, or invalid key"));
-    }
+  if (keyCandidates.empty())
+    throw EPasswDbInvalidKey(TRL("Database not encrypted, or invalid key"));
+
+  word32 lCryptParamLen, lHmacLen, lPlainLen, lMacLen, lDataSize;
+  bool blFramed, blCompressed, blInflateFinished, blInflateError;
+  SecureMem<word8> hmac, chunkBuf, dataBuf;
+
+  for (std::size_t nCand = 0; ; nCand++) {
+    try {
+      decryptHeader(keyCandidates[nCand]);
+      memcpy(&header, headerBuf, sizeof(header));
+
+      lCryptParamLen = lBufPos + cipher->GetIVSize();
+
+      lHmacLen = fh.HashType == HASH_SHA256 ? SHA256_HMAC_LENGTH :
+        SHA512_HMAC_LENGTH;
+      if (lFileSize < lCryptParamLen + headerBuf.Size() + lHmacLen)
+        throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+
+      // since version 1.6, entries are stored in separate frames following
+      // the main data block and its HMAC
+      blFramed = fh.Version >= 0x106;
+
+      // plaintext data stream: inner header + data (+ HMAC in versions < 1.1);
+      // HMAC covers everything except the HMAC itself
+      if (blFramed) {
+        if (header.HeaderSize < sizeof(header) ||
+            header.UncompressedSize > lFileSize)
+          throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+        lPlainLen = header.HeaderSize + header.UncompressedSize;
+        if (cipher->AlignToBlockSize())
+          lPlainLen = alignToBlockSize(lPlainLen, cipher->GetBlockSize());
+        if (lPlainLen < headerBuf.Size() ||
+            lPlainLen > lFileSize - lCryptParamLen - lHmacLen)
+          throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+        lMacLen = lPlainLen;
+      }
+      else {
+        lPlainLen = (fh.Version >= 0x101) ?
+          lFileSize - lCryptParamLen - lHmacLen : lFileSize - lCryptParamLen;
+        lMacLen = lFileSize - lCryptParamLen - lHmacLen;
+      }
 
-    lBufPos += lAlignedHeaderSize;
+      // LZO is only supported for compressing entry frames
+      if (fh.Version >= 0x104 && (header.CompressionAlgo > COMPRESSION_LZO ||
+          (!blFramed && header.CompressionAlgo == COMPRESSION_LZO)))
+        throw EPasswDbError("Compression algorithm not supported");
+
+      // in the framed format, only the entry frames are compressed
+      blCompressed = fh.Version >= 0x104 && !blFramed &&
+        header.CompressionAlgo != 0;
+
+      SecureMem<word8> checkHmac(lHmacLen);
+      hmac.New(lHmacLen);
+      if (fh.Version >= 0x101) {
+        __int64 qHmacPos = blFramed ?
+          static_cast<__int64>(fh.HeaderSize) + lCryptParamLen + lPlainLen :
+          pFile->Size - lHmacLen;
+        pFile->Seek(qHmacPos, soFromBeginning);
+        pFile->Read(hmac, static_cast<int>(lHmacLen));
+      }
 
-    // decrypt rest
-    if (fh.Version >= 0x101) {
-      int nRest = lFileSize - lBufPos - lHmacLen;
-      if (nRest > 0)
-        cipher->Decrypt(&m_cryptBuf[lBufPos], &m_cryptBuf[lBufPos], nRest);
-    }
-    else {
-      if (lFileSize > lBufPos)
-        cipher->Decrypt(&m_cryptBuf[lBufPos], &m_cryptBuf[lBufPos],
-          lFileSize - lBufPos);
-      memcpy(hmac, &m_cryptBuf[lFileSize - lHmacLen], lHmacLen);
-    }
+      SecureMem<sha256_context> sha256Ctx;
+      SecureMem<sha512_context> sha512Ctx;
+      if (fh.HashType == HASH_SHA256) {
+        sha256Ctx.New(1);
+        sha256_init(sha256Ctx);
+        sha256_hmac_starts(sha256Ctx, keySrc, DB_KEY_LENGTH, 0);
+      }
+      else {
+        sha512Ctx.New(1);
+        sha512_init(sha512Ctx);
+        sha512_hmac_starts(sha512Ctx, keySrc, DB_KEY_LENGTH, 0);
+      }
 
-    // calculate and check HMAC
-    SecureMem<word8> checkHmac(lHmacLen);
-    checkHmac.Zeroize();
-    if (fh.HashType == HASH_SHA256) {
-      lHmacLen = SHA256_HMAC_LENGTH;
-      SecureMem<sha256_context> hashCtx(1);
-      sha256_init(hashCtx);
-      sha256_hmac_starts(hashCtx, keySrc, DB_KEY_LENGTH, 0);
-      if (lFileSize > lCryptParamLen + SHA256_HMAC_LENGTH)
-        sha256_hmac_update(hashCtx,
-          &m_cryptBuf[lCryptParamLen],
-          lFileSize - lCryptParamLen - lHmacLen);
-      sha256_hmac_finish(hashCtx, checkHmac);
-    }
-    else {
-      lHmacLen = SHA512_HMAC_LENGTH;
-      SecureMem<sha512_context> hashCtx(1);
-      sha512_init(hashCtx);
-      sha512_hmac_starts(hashCtx, keySrc, DB_KEY_LENGTH, 0);
-      if (lFileSize > lCryptParamLen + SHA512_HMAC_LENGTH)
-        sha512_hmac_update(hashCtx,
-          &m_cryptBuf[lCryptParamLen],
-          lFileSize - lCryptParamLen - lHmacLen);
-      sha512_hmac_finish(hashCtx, checkHmac);
-    }
+      // uncompressed data are decrypted in place, compressed data are
+      // inflated directly from the decrypted chunks
+      std::unique_ptr<Inflate> pDecompr;
+      lDataSize = 0;
+      blInflateFinished = blInflateError = false;
+
+      if (blCompressed) {
+        // the inner header has not been authenticated yet, so limit the
+        // size of the output buffer in the same way as for entry frames
+        if (header.UncompressedSize > MAX_FILE_SIZE)
+          throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+        chunkBuf.New(DEFAULT_BUF_SIZE);
+        dataBuf.New(std::max(1u, header.UncompressedSize));
+        pDecompr.reset(new Inflate);
+        m_cryptBuf.Clear();
+      }
+      else
+        m_cryptBuf.New(std::max(1024u, lPlainLen));
+
+      // process plaintext chunk: update HMAC, then store or decompress
+      auto processChunk = [&](const word8* pChunk, word32 lPos, word32 lLen) {
+        if (lPos < lMacLen) {
+          word32 lToMac = std::min(lLen, lMacLen - lPos);
+          if (fh.HashType == HASH_SHA256)
+            sha256_hmac_update(sha256Ctx, pChunk, lToMac);
+          else
+            sha512_hmac_update(sha512Ctx, pChunk, lToMac);
+        }
+        if (fh.Version < 0x101 && lPos + lLen > lMacLen) {
+          // HMAC is part of the encrypted data stream
+          word32 lHmacStart = std::max(lPos, lMacLen);
+          hmac.Copy(lHmacStart - lMacLen, pChunk + (lHmacStart - lPos),
+            lPos + lLen - lHmacStart);
+        }
+        if (!blCompressed) {
+          if (pChunk != &m_cryptBuf[lPos])
+            m_cryptBuf.Copy(lPos, pChunk, lLen);
+          return;
+        }
+        word32 lComprStart = header.HeaderSize,
+               lComprEnd = std::min(lPlainLen,
+                 header.HeaderSize + header.CompressedSize);
+        word32 lStart = std::max(lPos, lComprStart),
+               lEnd = std::min(lPos + lLen, lComprEnd);
+        if (lStart < lEnd && !blInflateFinished && !blInflateError) {
+          // errors are reported after the HMAC has been checked
+          try {
+            word32 lAvailOut;
+            blInflateFinished = pDecompr->Process(
+              pChunk + (lStart - lPos),
+              lEnd - lStart,
+              dataBuf,
+              dataBuf.Size(),
+              true,
+              lAvailOut);
+            lDataSize += lAvailOut;
+          }
+          catch (CompressorError&) {
+            blInflateError = true;
+          }
+        }
+      };
+
+      const word32 lAlignedHeaderSize = headerBuf.Size();
+      processChunk(headerBuf, 0, lAlignedHeaderSize);
+
+      // decrypt and authenticate the rest of the file chunk by chunk
+      pFile->Seek(static_cast<__int64>(
+        fh.HeaderSize + lCryptParamLen + lAlignedHeaderSize), soFromBeginning);
+
+      for (word32 lPos = lAlignedHeaderSize; lPos < lPlainLen; ) {
+        word32 lChunkSize = std::min<word32>(DEFAULT_BUF_SIZE, lPlainLen - lPos);
+        word8* pChunk = blCompressed ? chunkBuf.Data() : &m_cryptBuf[lPos];
+        if (pFile->Read(pChunk, static_cast<int>(lChunkSize)) !=
+            static_cast<int>(lChunkSize))
+          throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+        cipher->Decrypt(pChunk, pChunk, lChunkSize);
+        processChunk(pChunk, lPos, lChunkSize);
+        lPos += lChunkSize;
+      }
 
-    if (checkHmac != hmac) {
-      if (m_blRecoveryKey && nKeyNum == 0)
-        continue;
+      // check HMAC
+      if (fh.HashType == HASH_SHA256)
+        sha256_hmac_finish(sha256Ctx, checkHmac);
       else
+        sha512_hmac_finish(sha512Ctx, checkHmac);
+
+      if (checkHmac != hmac)
         throw EPasswDbInvalidKey(TRL("File contents modified, or invalid key"));
-    }
 
-    break;
+      break;
+    }
+    catch (EPasswDbError&) {
+      // the error is reported if it occurred with the last matching key
+      if (nCand + 1 == keyCandidates.size())
+        throw;
+    }
   }
 
-  // data stream begins after inner header
-  m_lCryptBufPos = lCryptParamLen + header.HeaderSize;
+  headerBuf.Clear();
+
+  SecureMem<word8> masterKey;
+  if (m_blRecoveryKey)
+    masterKey = keySrc;
 
   // initialize crypto engine
   Initialize(m_blRecoveryKey ? masterKey : key);
 
   if (m_blRecoveryKey)
-    memcpy(m_pDbRecoveryKeyBlock, m_cryptBuf, DB_RECOVERY_KEY_BLOCK_LENGTH);
-
-  if (fh.Version >= 0x104 && header.CompressionAlgo != 0) {
-    if (header.CompressionAlgo > COMPRESSION_DEFLATE)
-      throw EPasswDbError("Compression algorithm not supported");
-
-    SecureMem<word8> dataBuf(header.UncompressedSize);
-    Inflate decompr;
-    word32 lDataSize;
-    bool blFinished = decompr.Process(
-      m_cryptBuf + m_lCryptBufPos,
-      header.CompressedSize,
-      dataBuf,
-      dataBuf.Size(),
-      true,
-      lDataSize);
+    memcpy(m_pDbRecoveryKeyBlock, prefix, DB_RECOVERY_KEY_BLOCK_LENGTH);
 
-    if (!blFinished || lDataSize != header.UncompressedSize)
+  if (blCompressed) {
+    if (!blInflateFinished || lDataSize != header.UncompressedSize)
       throw EPasswDbError("Error while decompressing data");
 
     m_cryptBuf.Swap(dataBuf);
     m_lCryptBufPos = 0;
     m_blCompressed = true;
     m_nCompressionLevel = header.CompressionLevel;
+    m_nCompressionAlgo = COMPRESSION_DEFLATE;
   }
   else {
-    m_blCompressed = false;
-    m_nCompressionLevel = 0;
+    // data stream begins after inner header
+    m_lCryptBufPos = header.HeaderSize;
+    m_blCompressed = blFramed && header.CompressionAlgo != 0;
+    m_nCompressionLevel = m_blCompressed ? header.CompressionLevel : 0;
+    m_nCompressionAlgo = m_blCompressed ? header.CompressionAlgo :
+      COMPRESSION_DEFLATE;
   }
 
   // read global database settings
@@ -769,80 +1398,213 @@ void PasswDatabase::Open(const SecureMem<word8>& key,
     throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
 
   // now read the fields...
-  // max. number is NumOfFields + "end of entry" mark
-  //int nMaxNumFields = header.NumOfFields + 1;
-  for (word32 i = 0; i < header.NumOfEntries; i++) {
-    PasswDbEntry* pEntry = AddDbEntry();
-    for (word32 j = 0; j <= header.NumOfFields; j++) {
-      int nFieldIndex = ReadFieldIndex();
-      if (nFieldIndex == PasswDbEntry::END)
+  // entries are hashed for detecting modifications when saving
+  auto readEntries = [&](word32 lNumEntries) {
+    for (word32 i = 0; i < lNumEntries; i++) {
+      word32 lStart = m_lCryptBufPos;
+      PasswDbEntry* pEntry = AddDbEntry();
+      ReadDbEntry(*pEntry, idxConv);
+      if (blFramed) {
+        SavedEntryState state;
+        state.Id = pEntry->m_lId;
+        HashDbEntry(&m_cryptBuf[lStart], m_lCryptBufPos - lStart, state.Hash);
+        m_savedEntries.push_back(state);
+      }
+    }
+  };
+
+  if (blFramed) {
+    m_savedSettingsHash = HashDbSettings(m_pMemSalt, SECMEM_SALT_LENGTH, fh, kdf,
+      header, &m_cryptBuf[header.HeaderSize], m_lCryptBufPos - header.HeaderSize);
+
+    // read frame index
+    const word32 lNumFrames = ReadType<word32>();
+    if (lNumFrames > header.NumOfEntries)
+      throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+
+    const word32 lBlockSize = cipher->AlignToBlockSize() ?
+      cipher->GetBlockSize() : 1;
+    std::vector<PasswDbFrameInfo> frames(lNumFrames);
+    word64 qNumEntries = 0, qFramesSize = 0;
+
+    for (auto& frame : frames) {
+      frame = ReadType<PasswDbFrameInfo>();
+      if (frame.NumOfEntries == 0 || frame.UncompressedSize == 0 ||
+          frame.UncompressedSize > MAX_FILE_SIZE ||
+          frame.DataSize == 0 || frame.DataSize > frame.EncryptedSize ||
+          frame.EncryptedSize != alignToBlockSize(frame.DataSize, lBlockSize) ||
+          (!m_blCompressed && frame.DataSize != frame.UncompressedSize))
+        throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+      qNumEntries += frame.NumOfEntries;
+      qFramesSize += frame.EncryptedSize;
+    }
+
+    // frames may be followed by journal records
+    if (qNumEntries != header.NumOfEntries ||
+        qFramesSize > lFileSize - lCryptParamLen - lPlainLen - lHmacLen)
+      throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+
+    // frames are read sequentially...
+    std::vector<SecureMem<word8>> frameBufs(lNumFrames);
+    pFile->Seek(static_cast<__int64>(
+      fh.HeaderSize + lCryptParamLen + lPlainLen + lHmacLen), soFromBeginning);
+
+    for (word32 i = 0; i < lNumFrames; i++) {
+      const word32 lSize = frames[i].EncryptedSize;
+      frameBufs[i].New(lSize);
+      if (pFile->Read(frameBufs[i], static_cast<int>(lSize)) !=
+          static_cast<int>(lSize))
+        throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+    }
+
+    // ...then authenticated, decrypted and decompressed in parallel;
+    // errors are reported by the calling thread
+    enum { FRAME_OK, FRAME_INVALID_MAC, FRAME_DECOMPRESSION_ERROR };
+    std::vector<int> frameStatus(lNumFrames, FRAME_OK);
+
+    ParallelFor(lNumFrames, [&](word32 i) {
+      const auto& frame = frames[i];
+      auto& buf = frameBufs[i];
+
+      word8 mac[SHA256_HMAC_LENGTH];
+      ComputeFrameMac(keySrc, i, buf, frame.EncryptedSize, mac);
+      bool blValidMac = memcmp(mac, frame.Mac, sizeof(mac)) == 0;
+      memzero(mac, sizeof(mac));
+      if (!blValidMac) {
+        frameStatus[i] = FRAME_INVALID_MAC;
+        return;
+      }
+
+      auto frameCipher = CreateCipher(fh.CipherType, keySrc,
+        EncryptionAlgorithm::Mode::DECRYPT);
+      frameCipher->SetIV(frame.IV);
+      frameCipher->Decrypt(buf, buf, frame.EncryptedSize);
+
+      if (m_blCompressed) {
+        SecureMem<word8> dataBuf;
+        if (!DecompressBlock(m_nCompressionAlgo, buf, frame.DataSize, dataBuf,
+              frame.UncompressedSize)) {
+          frameStatus[i] = FRAME_DECOMPRESSION_ERROR;
+          return;
+        }
+        buf.Swap(dataBuf);
+      }
+
+      buf.Shrink(frame.UncompressedSize);
+    });
+
+    for (int nStatus : frameStatus) {
+      if (nStatus == FRAME_INVALID_MAC)
+        throw EPasswDbInvalidKey(TRL("File contents modified, or invalid key"));
+      if (nStatus == FRAME_DECOMPRESSION_ERROR)
+        throw EPasswDbError("Error while decompressing data");
+    }
+
+    // parse entries frame by frame
+    for (word32 i = 0; i < lNumFrames; i++) {
+      m_cryptBuf.Swap(frameBufs[i]);
+      frameBufs[i].Clear();
+      m_lCryptBufPos = 0;
+      readEntries(frames[i].NumOfEntries);
+      if (m_lCryptBufPos != m_cryptBuf.Size())
+        throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+    }
+
+    // replay change journal: the base and each record are followed by a
+    // trailer; records are chained via their MACs, so a valid trailer
+    // authenticates all records preceding it. Records are staged until such
+    // a trailer has been read, and reading stops at the first incomplete or
+    // invalid record. Only the last trailer written is valid (the previous
+    // ones are wiped), but a save may have been interrupted before the new
+    // trailer was written completely; in this case, the file is opened in
+    // the state of the last valid trailer.
+    const __int64 qBaseSize = pFile->Position;
+    __int64 qPos = qBaseSize, qValidEnd = 0;
+    SecureMem<word8> chainMac = hmac, validChainMac;
+    std::vector<SecureMem<word8>> stagedRecords;
+    word32 lNumRecords = 0;
+
+    for ( ; ; ) {
+      JournalTrailer jt;
+      if (pFile->Size - qPos < static_cast<__int64>(sizeof(jt)))
         break;
-      if (nFieldIndex < static_cast<int>(idxConv.size()) &&
-           idxConv[nFieldIndex] >= 0) {
-        SecureWString sField;
-        int nIdx = idxConv[nFieldIndex];
-        switch (nIdx) {
-        case PasswDbEntry::KEYVALUELIST:
-          sField = ReadString();
-          pEntry->ParseKeyValueList(sField);
-          pEntry->UpdateKeyValueString();
-          break;
-        case PasswDbEntry::TAGS:
-          sField = ReadString();
-          pEntry->ParseTagList(sField);
-          pEntry->UpdateTagsString();
-          break;
-        case PasswDbEntry::CREATIONTIME:
-          pEntry->CreationTime = ReadField<FILETIME>();
-          pEntry->CreationTimeString =
-            pEntry->TimeStampToString(pEntry->CreationTime);
-          break;
-        case PasswDbEntry::MODIFICATIONTIME:
-          pEntry->ModificationTime = ReadField<FILETIME>();
-          pEntry->ModificationTimeString =
-            pEntry->TimeStampToString(pEntry->ModificationTime);
-          break;
-        case PasswDbEntry::PASSWCHANGETIME:
-          pEntry->PasswChangeTime = ReadField<FILETIME>();
-          pEntry->PasswChangeTimeString =
-            pEntry->TimeStampToString(pEntry->PasswChangeTime);
-          break;
-        case PasswDbEntry::PASSWEXPIRYDATE:
-          pEntry->PasswExpiryDate = ReadField<word32>();
-          pEntry->PasswExpiryDateString =
-            pEntry->ExpiryDateToString(pEntry->PasswExpiryDate);
-          if (pEntry->PasswExpiryDateString.IsStrEmpty())
-            pEntry->PasswExpiryDate = 0;
-          break;
-        case PasswDbEntry::PASSWHISTORY:
-          {
-            PasswHistoryHeader pwh = ReadType<PasswHistoryHeader>();
-            auto& history = pEntry->GetPasswHistory();
-            history.SetActive(pwh.Flags & 1);
-            history.SetMaxSize(pwh.MaxHistorySize);
-            for (word32 h = 0; h < pwh.HistorySize; h++) {
-              FILETIME ft = ReadType<FILETIME>();
-              sField = ReadString();
-              history.AddEntry({ ft, sField }, false);
-            }
-          }
-          break;
-        default:
-          sField = ReadString();
-          if (nIdx == PasswDbEntry::PASSWORD)
-            SetDbEntryPassw(*pEntry, sField);
-          else
-            pEntry->Strings[nIdx] = sField;
+      pFile->Read(&jt, static_cast<int>(sizeof(jt)));
+      qPos += sizeof(jt);
+
+      word8 mac[SHA256_HMAC_LENGTH];
+      ComputeJournalTrailerMac(keySrc, lNumRecords, chainMac, mac);
+      bool blValidTrailer =
+        memcmp(jt.Magic, JOURNAL_TRAILER_MAGIC, sizeof(JOURNAL_TRAILER_MAGIC)) == 0 &&
+        jt.NumRecords == lNumRecords &&
+        memcmp(mac, jt.Mac, sizeof(mac)) == 0;
+      memzero(mac, sizeof(mac));
+
+      if (blValidTrailer) {
+        for (auto& record : stagedRecords) {
+          m_cryptBuf.Swap(record);
+          record.Clear();
+          m_lCryptBufPos = 0;
+          ApplyJournalRecord();
         }
+        stagedRecords.clear();
+        m_lNumJournalRecords = lNumRecords;
+        qValidEnd = qPos;
+        validChainMac = chainMac;
       }
-      else
-        SkipField();
+
+      JournalRecordHeader rh;
+      if (pFile->Size - qPos < static_cast<__int64>(sizeof(rh)))
+        break;
+      pFile->Read(&rh, static_cast<int>(sizeof(rh)));
+      if (memcmp(rh.Magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+          rh.DataSize == 0 || rh.DataSize % lBlockSize != 0 ||
+          rh.DataSize > pFile->Size - qPos - sizeof(rh))
+        break;
+
+      SecureMem<word8> recordBuf(rh.DataSize);
+      pFile->Read(recordBuf, static_cast<int>(rh.DataSize));
+
+      SecureMem<word8> macData(chainMac.Size() + sizeof(rh.IV));
+      macData.Copy(0, chainMac, chainMac.Size());
+      macData.Copy(chainMac.Size(), rh.IV, sizeof(rh.IV));
+      ComputeFrameMac(keySrc, JOURNAL_RECORD_NUM_BASE + lNumRecords,
+        recordBuf, rh.DataSize, mac, macData, macData.Size());
+      bool blValidMac = memcmp(mac, rh.Mac, sizeof(mac)) == 0;
+      memzero(mac, sizeof(mac));
+      if (!blValidMac)
+        break;
+
+      auto recordCipher = CreateCipher(fh.CipherType, keySrc,
+        EncryptionAlgorithm::Mode::DECRYPT);
+      recordCipher->SetIV(rh.IV);
+      recordCipher->Decrypt(recordBuf, recordBuf, rh.DataSize);
+
+      stagedRecords.push_back(std::move(recordBuf));
+      chainMac.Assign(rh.Mac, sizeof(rh.Mac));
+      lNumRecords++;
+      qPos += sizeof(rh) + rh.DataSize;
     }
-#ifdef _DEBUG
-    if (pEntry->Strings[PasswDbEntry::TITLE].IsEmpty() && pEntry->IsPasswEmpty())
-      ShowMessage("Entry with empty title and password detected!");
-#endif
+
+    // without any valid trailer, records have been removed from the journal
+    if (qValidEnd == 0)
+      throw EPasswDbInvalidKey(TRL("File contents modified, or invalid key"));
+
+    // data following the last valid trailer are ignored and will be
+    // overwritten when the file is saved the next time
+    m_blJournalIncomplete = qValidEnd < pFile->Size;
+
+    // subsequent changes can be appended to this file
+    m_blJournalValid = true;
+    m_sSavedFileName = sFileName;
+    m_qSavedFileSize = qValidEnd;
+    m_lBaseSize = static_cast<word32>(qBaseSize);
+    m_lJournalSize = static_cast<word32>(qValidEnd - qBaseSize);
+    m_qLastCompactionTime = GetTickCount64();
+    m_journalMac = validChainMac;
+    memcpy(m_pFileKey, keySrc, DB_KEY_LENGTH);
   }
+  else
+    readEntries(header.NumOfEntries);
 
   m_cryptBuf.Clear();
   memzero(&header, sizeof(header));
@@ -913,25 +1675,104 @@ void PasswDatabase::WriteString(const SecureWString& sStr, int nIndex)
     WriteFieldBuf(nullptr, 0);
 }
 //---------------------------------------------------------------------------
+void PasswDatabase::WriteString(const wchar_t* pwszStr, int nIndex)
+{
+  if (*pwszStr != '\0') {
+    SecureAnsiString asUtf8 = WStringToUtf8_s(pwszStr);
+    WriteString(asUtf8.c_str(), asUtf8.StrLen(), nIndex);
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::CompactStringArena(void)
+{
+  if (!m_stringArena.NeedsCompaction())
+    return;
+
+  m_stringArena.BeginCompaction();
+  for (auto& pEntry : m_db)
+    pEntry->RelocateStrings();
+  m_stringArena.EndCompaction();
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::WriteDbEntry(const PasswDbEntry& entry,
+  const wchar_t* pwszPassw)
+{
+  const word8 bEndOfEntry = PasswDbEntry::END;
+
+  for (int nI = 0; nI < PasswDbEntry::NUM_STRING_FIELDS; nI++) {
+    //SecureWString sField;
+    switch (nI) {
+    case PasswDbEntry::PASSWORD:
+      WriteString(pwszPassw, nI);
+      break;
+    case PasswDbEntry::KEYVALUELIST:
+      WriteString(entry.GetKeyValueListAsString(), nI);
+      break;
+    case PasswDbEntry::TAGS:
+      WriteString(entry.GetTagsAsString(), nI);
+      break;
+    default:
+      WriteString(entry.Strings[nI].c_str(), nI);
+    }
+  }
+
+  WriteField(entry.CreationTime, PasswDbEntry::CREATIONTIME);
+  WriteField(entry.ModificationTime, PasswDbEntry::MODIFICATIONTIME);
+  if (entry.PasswChangeTime.dwLowDateTime != 0 ||
+      entry.PasswChangeTime.dwHighDateTime != 0)
+    WriteField(entry.PasswChangeTime, PasswDbEntry::PASSWCHANGETIME);
+
+  const auto& passwHistory = entry.GetPasswHistory();
+  if (!passwHistory.IsEmpty()) {
+    PasswHistoryHeader pwh;
+    pwh.BlockSize = sizeof(PasswHistoryHeader);
+    pwh.Flags = passwHistory.GetActive() ? 1 : 0;
+    pwh.HistorySize = std::min<word32>(MAX_PASSW_HISTORY_SIZE,
+      passwHistory.GetSize());
+    pwh.MaxHistorySize = std::min<word32>(MAX_PASSW_HISTORY_SIZE,
+      passwHistory.GetMaxSize());
+    const auto endIt = passwHistory.begin() + pwh.HistorySize;
+    for (auto it = passwHistory.begin(); it != endIt; it++) {
+      pwh.BlockSize += sizeof(it->first) + 4 + it->second.StrLen();
+    }
+    const word8 bIndex = PasswDbEntry::PASSWHISTORY;
+    WriteType(bIndex);
+    WriteType(pwh);
+    for (auto it = passwHistory.begin(); it != endIt; it++) {
+      WriteType(it->first);
+      WriteString(it->second);
+    }
+  }
+
+  if (entry.PasswExpiryDate != 0)
+    WriteField(entry.PasswExpiryDate, PasswDbEntry::PASSWEXPIRYDATE);
+
+  Write(&bEndOfEntry, 1);
+}
+//---------------------------------------------------------------------------
 void PasswDatabase::SaveToFile(const WString& sFileName)
 {
   CheckDbOpen();
 
   if (m_bCipherType > CIPHER_CHACHA20)
     throw EPasswDbError("Invalid cipher");
-  if (m_lKdfIterations == 0)
-    throw EPasswDbError("Invalid number of KDF iterations");
+  if (!IsValidKdfParam(GetKdfParam()))
+    throw EPasswDbError("Invalid KDF parameters");
+
+  CompactStringArena();
 
   FileHeader fh;
   memcpy(fh.Magic, PASSW_DB_MAGIC, sizeof(PASSW_DB_MAGIC));
   fh.HeaderSize = sizeof(FileHeader);
+  if (m_bKdfType == KDF_ARGON2ID)
+    fh.HeaderSize += sizeof(KdfArgon2Header);
   fh.Version = VERSION;
   fh.Flags = 0;
   if (m_blRecoveryKey)
     fh.Flags |= FH_FLAG_RECOVERY_KEY;
   fh.CipherType = m_bCipherType;
   fh.HashType = HASH_SHA512;
-  fh.KdfType = KDF_PBKDF2_SHA256;
+  fh.KdfType = m_bKdfType;
   fh.KdfIterations = m_lKdfIterations;
 
   auto cipher = CreateCipher(m_bCipherType, m_pDbKey,
@@ -952,7 +1793,9 @@ void PasswDatabase::SaveToFile(const WString& sFileName)
   header.NumOfEntries = m_db.size();
 
   if (m_blCompressed) {
-    header.CompressionAlgo = COMPRESSION_DEFLATE;
+    if (m_nCompressionAlgo != COMPRESSION_LZO)
+      m_nCompressionAlgo = COMPRESSION_DEFLATE;
+    header.CompressionAlgo = m_nCompressionAlgo;
     header.CompressionLevel = m_nCompressionLevel =
       m_nCompressionLevel <= 0 ? MZ_DEFAULT_LEVEL :
         std::min<int>(MZ_BEST_COMPRESSION, m_nCompressionLevel);
@@ -1017,96 +1860,159 @@ void PasswDatabase::SaveToFile(const WString& sFileName)
       static_cast<PasswDbEntry::FieldType>(nI)));
   }
 
-  const word8 bEndOfEntry = PasswDbEntry::END;
+  // serialize entries into a separate buffer and group them into frames
+  const word32 lMainSize = m_lCryptBufPos;
+  SecureMem<word8> mainBuf;
+  mainBuf.Swap(m_cryptBuf);
+  m_cryptBuf.New(DEFAULT_BUF_SIZE);
+  m_lCryptBufPos = 0;
 
-  for (auto& pEntry : m_db)
+  std::vector<PasswDbFrameInfo> frames;
+  std::vector<word32> frameOffsets;
+  word32 lFrameStart = 0, lFrameEntries = 0;
+
+  auto addFrame = [&]() {
+    PasswDbFrameInfo frame;
+    memzero(&frame, sizeof(frame));
+    frame.NumOfEntries = lFrameEntries;
+    frame.UncompressedSize = m_lCryptBufPos - lFrameStart;
+    frames.push_back(frame);
+    frameOffsets.push_back(lFrameStart);
+    lFrameStart = m_lCryptBufPos;
+    lFrameEntries = 0;
+  };
+
+  // entry states for detecting modifications since the last save
+  std::vector<SavedEntryState> entryStates;
+  std::vector<word32> entryOffsets;
+  entryStates.reserve(m_db.size());
+  entryOffsets.reserve(m_db.size() + 1);
+
+  ForEachDbEntryPassw([&](PasswDbEntry& entry, const wchar_t* pwszPassw)
   {
-    for (int nI = 0; nI < PasswDbEntry::NUM_STRING_FIELDS; nI++) {
-      //SecureWString sField;
-      switch (nI) {
-      case PasswDbEntry::PASSWORD:
-        WriteString(GetDbEntryPassw(*pEntry), nI);
-        break;
-      case PasswDbEntry::KEYVALUELIST:
-        WriteString(pEntry->GetKeyValueListAsString(), nI);
-        break;
-      case PasswDbEntry::TAGS:
-        WriteString(pEntry->GetTagsAsString(), nI);
-        break;
-      default:
-        WriteString(pEntry->Strings[nI], nI);
-      }
+    const word32 lEntryStart = m_lCryptBufPos;
+    WriteDbEntry(entry, pwszPassw);
+
+    SavedEntryState state;
+    state.Id = entry.m_lId;
+    HashDbEntry(m_cryptBuf + lEntryStart, m_lCryptBufPos - lEntryStart,
+      state.Hash);
+    entryStates.push_back(state);
+    entryOffsets.push_back(lEntryStart);
+
+    lFrameEntries++;
+    if (m_lCryptBufPos - lFrameStart >= FRAME_TARGET_SIZE)
+      addFrame();
+  }, true);
+
+  if (lFrameEntries != 0)
+    addFrame();
+
+  entryOffsets.push_back(m_lCryptBufPos);
+
+  SecureMem<word8> settingsHash = HashDbSettings(m_pMemSalt, SECMEM_SALT_LENGTH,
+    fh, GetKdfParam(), header, mainBuf + sizeof(header),
+    lMainSize - sizeof(header));
+
+  // small modifications are appended to the file as journal record, so the
+  // whole file doesn't need to be rewritten
+  if (AppendJournalRecord(sFileName, settingsHash, entryStates, entryOffsets)) {
+    m_cryptBuf.Clear();
+    memzero(&header, sizeof(header));
+    m_nLastVersion = VERSION;
+    return;
+  }
+
+  m_blJournalValid = false;
+
+  const word32 lNumFrames = frames.size();
+  const word32 lBlockSize = cipher->AlignToBlockSize() ?
+    cipher->GetBlockSize() : 1;
+
+  // the random pool is not thread-safe, so obtain IVs and padding bytes
+  // in advance
+  SecureMem<word8> framePadding(lNumFrames * lBlockSize);
+  for (auto& frame : frames)
+    RandomPool::GetInstance().GetData(frame.IV, sizeof(frame.IV));
+  if (!framePadding.IsEmpty())
+    RandomPool::GetInstance().GetData(framePadding, framePadding.Size());
+
+  // if there are fewer frames than worker threads, Deflate frames are split
+  // into blocks which are compressed in parallel and joined into a single
+  // Deflate stream per frame (pigz-style)
+  std::vector<std::unique_ptr<ParallelDeflate>> frameDeflate(lNumFrames);
+
+  if (m_blCompressed && header.CompressionAlgo == COMPRESSION_DEFLATE) {
+    const word32 lNumThreads = GetNumWorkerThreads();
+    const word32 lPartsPerFrame = (lNumThreads + lNumFrames - 1) / lNumFrames;
+    std::vector<std::pair<word32, word32>> blocks;
+
+    for (word32 i = 0; i < lNumFrames; i++) {
+      const word32 lSize = frames[i].UncompressedSize;
+      frameDeflate[i].reset(new ParallelDeflate(m_cryptBuf + frameOffsets[i],
+        lSize, header.CompressionLevel,
+        ParallelDeflate::GetBlockSize(lSize, lPartsPerFrame)));
+      for (word32 j = 0; j < frameDeflate[i]->GetNumBlocks(); j++)
+        blocks.emplace_back(i, j);
     }
 
-    WriteField(pEntry->CreationTime, PasswDbEntry::CREATIONTIME);
-    WriteField(pEntry->ModificationTime, PasswDbEntry::MODIFICATIONTIME);
-    if (pEntry->PasswChangeTime.dwLowDateTime != 0 ||
-        pEntry->PasswChangeTime.dwHighDateTime != 0)
-      WriteField(pEntry->PasswChangeTime, PasswDbEntry::PASSWCHANGETIME);
-
-    const auto& passwHistory = pEntry->GetPasswHistory();
-    if (!passwHistory.IsEmpty()) {
-      PasswHistoryHeader pwh;
-      pwh.BlockSize = sizeof(PasswHistoryHeader);
-      pwh.Flags = passwHistory.GetActive() ? 1 : 0;
-      pwh.HistorySize = std::min<word32>(MAX_PASSW_HISTORY_SIZE,
-        passwHistory.GetSize());
-      pwh.MaxHistorySize = std::min<word32>(MAX_PASSW_HISTORY_SIZE,
-        passwHistory.GetMaxSize());
-      const auto endIt = passwHistory.begin() + pwh.HistorySize;
-      for (auto it = passwHistory.begin(); it != endIt; it++) {
-        pwh.BlockSize += sizeof(it->first) + 4 + it->second.StrLen();
-      }
-      const word8 bIndex = PasswDbEntry::PASSWHISTORY;
-      WriteType(bIndex);
-      WriteType(pwh);
-      for (auto it = passwHistory.begin(); it != endIt; it++) {
-        WriteType(it->first);
-        WriteString(it->second);
-      }
+    ParallelFor(blocks.size(), [&](word32 i) {
+      frameDeflate[blocks[i].first]->CompressBlock(blocks[i].second);
+    });
+  }
+
+  // compress, encrypt and authenticate frames in parallel
+  std::vector<SecureMem<word8>> frameBufs(lNumFrames);
+
+  ParallelFor(lNumFrames, [&](word32 i) {
+    auto& frame = frames[i];
+    auto& buf = frameBufs[i];
+    const word8* pSrc = m_cryptBuf + frameOffsets[i];
+
+    if (frameDeflate[i]) {
+      frame.DataSize = frameDeflate[i]->Finish(buf, lBlockSize);
+      frameDeflate[i].reset();
+    }
+    else if (m_blCompressed)
+      frame.DataSize = CompressBlock(header.CompressionAlgo,
+        header.CompressionLevel, pSrc, frame.UncompressedSize, buf, lBlockSize);
+    else {
+      buf.New(frame.UncompressedSize + lBlockSize);
+      buf.Copy(0, pSrc, frame.UncompressedSize);
+      frame.DataSize = frame.UncompressedSize;
     }
 
-    if (pEntry->PasswExpiryDate != 0)
-      WriteField(pEntry->PasswExpiryDate, PasswDbEntry::PASSWEXPIRYDATE);
+    frame.EncryptedSize = alignToBlockSize(frame.DataSize, lBlockSize);
+    if (frame.EncryptedSize > frame.DataSize)
+      buf.Copy(frame.DataSize, &framePadding[i * lBlockSize],
+        frame.EncryptedSize - frame.DataSize);
 
-    Write(&bEndOfEntry, 1);
-  }
+    auto frameCipher = CreateCipher(m_bCipherType, m_pDbKey,
+      EncryptionAlgorithm::Mode::ENCRYPT);
+    frameCipher->SetIV(frame.IV);
+    frameCipher->Encrypt(buf, buf, frame.EncryptedSize);
+    buf.SetClearMark(0);
 
-  header.UncompressedSize = header.CompressedSize = m_lCryptBufPos - sizeof(header);
+    ComputeFrameMac(m_pDbKey, i, buf, frame.EncryptedSize, frame.Mac);
+  });
 
-  if (m_blCompressed) {
-    word32 lToCompress = header.UncompressedSize;
-    SecureMem<word8> workBuf(DEFAULT_BUF_SIZE),
-      comprBuf(alignToBlockSize(std::max(DEFAULT_BUF_SIZE, lToCompress), 16));
-
-    Deflate compr(header.CompressionLevel);
-    bool blFinished;
-    word32 lComprBufPos = sizeof(header);
-
-    do {
-      word32 lChunkSize;
-      blFinished = compr.Process(
-        m_cryptBuf + sizeof(header),
-        lToCompress,
-        workBuf,
-        workBuf.Size(),
-        true,
-        lChunkSize);
-      if (lChunkSize) {
-        comprBuf.BufferedGrow(lComprBufPos + lChunkSize);
-        //if (lComprBufPos + lChunkSize > comprBuf.Size())
-        //  comprBuf.GrowBy(comprBuf.Size());
-        //memcpy(comprBuf + lComprBufPos, workBuf, lChunkSize);
-        comprBuf.Copy(lComprBufPos, workBuf, lChunkSize);
-        lComprBufPos += lChunkSize;
-      }
-      lToCompress = 0;
-    } while (!blFinished);
+  word32 lFramesSize = 0;
+  for (const auto& frame : frames)
+    lFramesSize += frame.EncryptedSize;
 
-    m_cryptBuf.Swap(comprBuf);
-    m_lCryptBufPos = lComprBufPos;
-    header.CompressedSize = lComprBufPos;
-  }
+  // main data block: inner header, global settings, field names, frame index
+  m_cryptBuf.Swap(mainBuf);
+  mainBuf.Clear();
+  m_lCryptBufPos = lMainSize;
+
+  WriteType(lNumFrames);
+  for (const auto& frame : frames)
+    WriteType(frame);
+
+  if (m_lCryptBufPos + lFramesSize > MAX_FILE_SIZE - 1024)
+    throw EPasswDbError("Database size exceeds file size limit");
+
+  header.UncompressedSize = header.CompressedSize = m_lCryptBufPos - sizeof(header);
 
   memcpy(m_cryptBuf, &header, sizeof(header));
   memzero(&header, sizeof(header));
@@ -1131,6 +2037,8 @@ void PasswDatabase::SaveToFile(const WString& sFileName)
   // buffer contents are encrypted now, so there's no need to zeroize it anymore
   m_cryptBuf.SetClearMark(0);
 
+  SecureMem<word8> hmac(SHA512_HMAC_LENGTH);
+
   // now open file and write data
   m_pFile.reset();
   m_pFile.reset(new TFileStream(sFileName, fmCreate | fmShareDenyWrite));
@@ -1139,6 +2047,14 @@ void PasswDatabase::SaveToFile(const WString& sFileName)
     // file header
     m_pFile->Write(&fh, static_cast<int>(sizeof(fh)));
 
+    // additional KDF parameters
+    if (m_bKdfType == KDF_ARGON2ID) {
+      KdfArgon2Header kh;
+      kh.MemoryCost = m_lKdfMemoryCost;
+      kh.Parallelism = m_lKdfParallelism;
+      m_pFile->Write(&kh, static_cast<int>(sizeof(kh)));
+    }
+
     // recovery key block or salt
     if (m_blRecoveryKey)
       m_pFile->Write(m_pDbRecoveryKeyBlock, DB_RECOVERY_KEY_BLOCK_LENGTH);
@@ -1163,10 +2079,24 @@ void PasswDatabase::SaveToFile(const WString& sFileName)
     }
   #endif
 
-    SecureMem<word8> hmac(SHA512_HMAC_LENGTH);
     sha512_hmac_finish(hashCtx, hmac);
 
     m_pFile->Write(hmac, static_cast<int>(hmac.Size()));
+
+    // encrypted entry frames
+    for (word32 i = 0; i < lNumFrames; i++)
+      m_pFile->Write(frameBufs[i], static_cast<int>(frames[i].EncryptedSize));
+
+    m_lBaseSize = static_cast<word32>(m_pFile->Size);
+
+    // trailer of the (still empty) change journal
+    JournalTrailer jt;
+    memcpy(jt.Magic, JOURNAL_TRAILER_MAGIC, sizeof(JOURNAL_TRAILER_MAGIC));
+    jt.NumRecords = 0;
+    ComputeJournalTrailerMac(m_pDbKey, 0, hmac, jt.Mac);
+    m_pFile->Write(&jt, static_cast<int>(sizeof(jt)));
+
+    m_qSavedFileSize = m_pFile->Size;
   }
   __finally {
     m_cryptBuf.Clear();
@@ -1176,6 +2106,238 @@ void PasswDatabase::SaveToFile(const WString& sFileName)
   m_pFile.reset(new TFileStream(sFileName, fmOpenRead | fmShareDenyWrite));
 
   m_nLastVersion = VERSION;
+
+  // file has been rewritten completely (compacted), subsequent changes can be
+  // appended as journal records
+  m_blJournalValid = true;
+  m_sSavedFileName = sFileName;
+  m_lJournalSize = sizeof(JournalTrailer);
+  m_lNumJournalRecords = 0;
+  m_qLastCompactionTime = GetTickCount64();
+  m_journalMac = hmac;
+  m_blJournalIncomplete = false;
+  m_savedSettingsHash = settingsHash;
+  m_savedEntries.swap(entryStates);
+  memcpy(m_pFileKey, m_pDbKey, DB_KEY_LENGTH);
+}
+//---------------------------------------------------------------------------
+bool PasswDatabase::AppendJournalRecord(const WString& sFileName,
+  const word8* pSettingsHash,
+  const std::vector<SavedEntryState>& entryStates,
+  const std::vector<word32>& entryOffsets)
+{
+  if (!m_blJournalValid || !SameFileName(sFileName, m_sSavedFileName) ||
+      m_lNumJournalRecords >= JOURNAL_MAX_RECORDS ||
+      GetTickCount64() - m_qLastCompactionTime >= JOURNAL_MAX_AGE ||
+      memcmp(pSettingsHash, m_savedSettingsHash, SETTINGS_HASH_LENGTH) != 0)
+    return false;
+
+  // file must not have been modified or replaced in the meantime
+  WIN32_FILE_ATTRIBUTE_DATA fileInfo;
+  if (!GetFileAttributesEx(sFileName.c_str(), GetFileExInfoStandard, &fileInfo) ||
+      ((static_cast<word64>(fileInfo.nFileSizeHigh) << 32) |
+        fileInfo.nFileSizeLow) != m_qSavedFileSize)
+    return false;
+
+  // positions of entries in the file
+  std::unordered_map<word32, word32> savedPos;
+  savedPos.reserve(m_savedEntries.size());
+  for (word32 i = 0; i < m_savedEntries.size(); i++)
+    savedPos.emplace(m_savedEntries[i].Id, i);
+
+  // returns position of unchanged entry in the file, -1 if entry is new or
+  // has been modified
+  auto getSavedPos = [&](word32 lIndex) {
+    auto it = savedPos.find(entryStates[lIndex].Id);
+    if (it == savedPos.end() || memcmp(m_savedEntries[it->second].Hash,
+          entryStates[lIndex].Hash, ENTRY_HASH_LENGTH) != 0)
+      return -1;
+    return static_cast<int>(it->second);
+  };
+
+  // describe new list of entries as sequence of segments
+  SecureMem<word8> entryBuf;
+  entryBuf.Swap(m_cryptBuf);
+  m_cryptBuf.New(DEFAULT_BUF_SIZE);
+  m_lCryptBufPos = 0;
+
+  const word8 bNumOfFields = PasswDbEntry::NUM_FIELDS;
+  const word32 lNumEntries = entryStates.size();
+  word32 lNumSegments = 0, lNumModified = 0;
+  WriteType(bNumOfFields);
+  WriteType(lNumEntries);
+  const word32 lNumSegmentsPos = m_lCryptBufPos;
+  WriteType(lNumSegments);
+
+  for (word32 i = 0; i < lNumEntries; lNumSegments++) {
+    int nPos = getSavedPos(i);
+    if (nPos >= 0) {
+      word32 lCount = 1;
+      while (i + lCount < lNumEntries &&
+             getSavedPos(i + lCount) == nPos + static_cast<int>(lCount))
+        lCount++;
+      const word8 bType = JOURNAL_SEGMENT_COPY;
+      WriteType(bType);
+      WriteType(static_cast<word32>(nPos));
+      WriteType(lCount);
+      i += lCount;
+    }
+    else {
+      const word8 bType = JOURNAL_SEGMENT_ENTRY;
+      WriteType(bType);
+      Write(entryBuf + entryOffsets[i], entryOffsets[i + 1] - entryOffsets[i]);
+      lNumModified++;
+      i++;
+    }
+  }
+
+  memcpy(&m_cryptBuf[lNumSegmentsPos], &lNumSegments, 4);
+
+  // nothing to do if all entries are unchanged
+  if (lNumModified == 0 && lNumSegments <= 1 &&
+      lNumEntries == m_savedEntries.size()) {
+    if (!m_pFile)
+      m_pFile.reset(new TFileStream(sFileName, fmOpenRead | fmShareDenyWrite));
+    return true;
+  }
+
+  const auto cipher = CreateCipher(m_bCipherType, m_pFileKey,
+    EncryptionAlgorithm::Mode::ENCRYPT);
+
+  word32 lAlignedSize = m_lCryptBufPos;
+  if (cipher->AlignToBlockSize())
+    lAlignedSize = alignToBlockSize(lAlignedSize, cipher->GetBlockSize());
+
+  // compact journal if it gets too large
+  if (m_lJournalSize + sizeof(JournalRecordHeader) + lAlignedSize +
+      sizeof(JournalTrailer) >
+      std::max(JOURNAL_MIN_SIZE_LIMIT, m_lBaseSize / 4)) {
+    m_cryptBuf.Swap(entryBuf);
+    return false;
+  }
+
+  RandomPool& randPool = RandomPool::GetInstance();
+
+  if (lAlignedSize > m_lCryptBufPos) {
+    m_cryptBuf.Grow(lAlignedSize);
+    randPool.GetData(m_cryptBuf + m_lCryptBufPos, lAlignedSize - m_lCryptBufPos);
+  }
+
+  JournalRecordHeader rh;
+  memcpy(rh.Magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+  rh.DataSize = lAlignedSize;
+  randPool.GetData(rh.IV, sizeof(rh.IV));
+
+  cipher->SetIV(rh.IV);
+  cipher->Encrypt(m_cryptBuf, m_cryptBuf, lAlignedSize);
+  m_cryptBuf.SetClearMark(0);
+
+  // chain record to the previous one (or the base file) and bind it to its
+  // position within the journal
+  SecureMem<word8> macData(m_journalMac.Size() + sizeof(rh.IV));
+  macData.Copy(0, m_journalMac, m_journalMac.Size());
+  macData.Copy(m_journalMac.Size(), rh.IV, sizeof(rh.IV));
+  ComputeFrameMac(m_pFileKey, JOURNAL_RECORD_NUM_BASE + m_lNumJournalRecords,
+    m_cryptBuf, lAlignedSize, rh.Mac, macData, macData.Size());
+
+  SecureMem<word8> newJournalMac(rh.Mac, sizeof(rh.Mac));
+  JournalTrailer jt;
+  memcpy(jt.Magic, JOURNAL_TRAILER_MAGIC, sizeof(JOURNAL_TRAILER_MAGIC));
+  jt.NumRecords = m_lNumJournalRecords + 1;
+  ComputeJournalTrailerMac(m_pFileKey, jt.NumRecords, newJournalMac, jt.Mac);
+
+  m_pFile.reset();
+
+  try {
+    auto pFile = std::make_unique<TFileStream>(sFileName,
+      fmOpenReadWrite | fmShareDenyWrite);
+    pFile->Seek(static_cast<__int64>(m_qSavedFileSize), soFromBeginning);
+    pFile->Write(&rh, static_cast<int>(sizeof(rh)));
+    pFile->Write(m_cryptBuf, static_cast<int>(lAlignedSize));
+    pFile->Write(&jt, static_cast<int>(sizeof(jt)));
+
+    // the new trailer has to be on disk before the previous one is wiped;
+    // if the operation is interrupted before, the file is opened in its
+    // previous state
+    FlushFileBuffers(reinterpret_cast<HANDLE>(pFile->Handle));
+    const JournalTrailer wiped = {};
+    pFile->Seek(static_cast<__int64>(m_qSavedFileSize - sizeof(jt)),
+      soFromBeginning);
+    pFile->Write(&wiped, static_cast<int>(sizeof(wiped)));
+  }
+  __finally {
+    m_cryptBuf.Clear();
+  }
+
+  m_pFile.reset(new TFileStream(sFileName, fmOpenRead | fmShareDenyWrite));
+
+  const word32 lRecordSize = sizeof(rh) + lAlignedSize + sizeof(jt);
+  m_qSavedFileSize += lRecordSize;
+  m_lJournalSize += lRecordSize;
+  m_lNumJournalRecords++;
+  m_journalMac = newJournalMac;
+  m_savedEntries = entryStates;
+
+  return true;
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::ApplyJournalRecord(void)
+{
+  const word8 bNumOfFields = ReadType<word8>();
+  const word32 lNumEntries = ReadType<word32>();
+  const word32 lNumSegments = ReadType<word32>();
+
+  // each segment and each new entry occupies at least one byte
+  if (lNumEntries > m_db.size() + m_cryptBuf.Size() ||
+      lNumSegments > m_cryptBuf.Size())
+    throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+
+  // entries are stored in the field order of the current version
+  std::vector<int> idxConv(bNumOfFields);
+  for (int nI = 0; nI < bNumOfFields; nI++)
+    idxConv[nI] = (nI < PasswDbEntry::NUM_FIELDS) ? nI : -1;
+
+  PasswDbList prevDb;
+  std::vector<SavedEntryState> prevStates;
+  prevDb.swap(m_db);
+  prevStates.swap(m_savedEntries);
+  m_db.reserve(lNumEntries);
+  m_savedEntries.reserve(lNumEntries);
+
+  for (word32 i = 0; i < lNumSegments; i++) {
+    word8 bType = ReadType<word8>();
+    if (bType == JOURNAL_SEGMENT_COPY) {
+      word32 lStart = ReadType<word32>();
+      word32 lCount = ReadType<word32>();
+      if (lStart > prevDb.size() || lCount > prevDb.size() - lStart)
+        throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+      for (word32 j = lStart; j < lStart + lCount; j++) {
+        // each entry must not be referenced more than once
+        if (!prevDb[j])
+          throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+        m_db.push_back(std::move(prevDb[j]));
+        m_savedEntries.push_back(prevStates[j]);
+      }
+    }
+    else if (bType == JOURNAL_SEGMENT_ENTRY) {
+      word32 lStart = m_lCryptBufPos;
+      PasswDbEntry* pEntry = AddDbEntry();
+      ReadDbEntry(*pEntry, idxConv);
+      SavedEntryState state;
+      state.Id = pEntry->m_lId;
+      HashDbEntry(&m_cryptBuf[lStart], m_lCryptBufPos - lStart, state.Hash);
+      m_savedEntries.push_back(state);
+    }
+    else
+      throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+  }
+
+  if (m_db.size() != lNumEntries)
+    throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
+
+  word32 lIndex = 0;
+  for (auto& pEntry : m_db)
+    pEntry->m_lIndex = lIndex++;
 }
 //---------------------------------------------------------------------------
 word32 PasswDatabase::ReadFieldSize(void)
@@ -1224,10 +2386,77 @@ void PasswDatabase::SkipField(void)
     throw EPasswDbInvalidFormat(E_INVALID_FORMAT);
 }
 //---------------------------------------------------------------------------
+void PasswDatabase::ReadDbEntry(PasswDbEntry& entry,
+  const std::vector<int>& idxConv)
+{
+  // max. number is NumOfFields + "end of entry" mark
+  for (word32 j = 0; j <= idxConv.size(); j++) {
+    int nFieldIndex = ReadFieldIndex();
+    if (nFieldIndex == PasswDbEntry::END)
+      break;
+    if (nFieldIndex < static_cast<int>(idxConv.size()) &&
+         idxConv[nFieldIndex] >= 0) {
+      SecureWString sField;
+      int nIdx = idxConv[nFieldIndex];
+      switch (nIdx) {
+      case PasswDbEntry::KEYVALUELIST:
+        entry.SetKeyValueListSrc(ReadString());
+        break;
+      case PasswDbEntry::TAGS:
+        entry.SetTagListSrc(ReadString());
+        break;
+      case PasswDbEntry::CREATIONTIME:
+        entry.CreationTime = ReadField<FILETIME>();
+        break;
+      case PasswDbEntry::MODIFICATIONTIME:
+        entry.ModificationTime = ReadField<FILETIME>();
+        break;
+      case PasswDbEntry::PASSWCHANGETIME:
+        entry.PasswChangeTime = ReadField<FILETIME>();
+        break;
+      case PasswDbEntry::PASSWEXPIRYDATE:
+        {
+          entry.PasswExpiryDate = ReadField<word32>();
+          int nYear, nMonth, nDay;
+          if (!entry.DecodeExpiryDate(entry.PasswExpiryDate, nYear, nMonth,
+               nDay))
+            entry.PasswExpiryDate = 0;
+        }
+        break;
+      case PasswDbEntry::PASSWHISTORY:
+        {
+          PasswHistoryHeader pwh = ReadType<PasswHistoryHeader>();
+          auto& history = entry.GetPasswHistory();
+          history.SetActive(pwh.Flags & 1);
+          history.SetMaxSize(pwh.MaxHistorySize);
+          for (word32 h = 0; h < pwh.HistorySize; h++) {
+            FILETIME ft = ReadType<FILETIME>();
+            sField = ReadString();
+            history.AddEntry({ ft, std::move(sField) }, false);
+          }
+        }
+        break;
+      default:
+        sField = ReadString();
+        if (nIdx == PasswDbEntry::PASSWORD)
+          SetDbEntryPassw(entry, sField);
+        else
+          entry.Strings[nIdx] = sField;
+      }
+    }
+    else
+      SkipField();
+  }
+#ifdef _DEBUG
+  if (entry.Strings[PasswDbEntry::TITLE].IsEmpty() && entry.IsPasswEmpty())
+    ShowMessage("Entry with empty title and password detected!");
+#endif
+}
+//---------------------------------------------------------------------------
 PasswDbEntry* PasswDatabase::AddDbEntry(void)
 {
   m_db.emplace_back(new PasswDbEntry(m_lDbEntryId++, m_db.size(),
-    false, 1, false));
+    false, 1, false, m_stringArena));
   return m_db.back().get();
 }
 //---------------------------------------------------------------------------
@@ -1235,7 +2464,7 @@ PasswDbEntry* PasswDatabase::NewDbEntry(void)
 {
   m_db.emplace_back(new PasswDbEntry(m_lDbEntryId++, m_db.size(),
     true, m_lDefaultMaxPasswHistorySize,
-    m_lDefaultMaxPasswHistorySize > 0));
+    m_lDefaultMaxPasswHistorySize > 0, m_stringArena));
   m_db.back()->Strings[PasswDbEntry::USERNAME] = m_sDefaultUserName;
   return m_db.back().get();
 }
@@ -1244,7 +2473,7 @@ PasswDbEntry* PasswDatabase::DuplicateDbEntry(const PasswDbEntry& original,
   const SecureWString& sTitle)
 {
   PasswDbEntry* pDuplicate = new PasswDbEntry(m_lDbEntryId++, m_db.size(),
-    true, 1, false);
+    true, 1, false, m_stringArena);
   m_db.emplace_back(pDuplicate);
 
   pDuplicate->Strings[PasswDbEntry::TITLE] = sTitle;
@@ -1262,7 +2491,6 @@ PasswDbEntry* PasswDatabase::DuplicateDbEntry(const PasswDbEntry& original,
   pDuplicate->SetTagList(original.GetTagList());
   pDuplicate->GetPasswHistory() = original.GetPasswHistory();
   pDuplicate->PasswExpiryDate = original.PasswExpiryDate;
-  pDuplicate->PasswExpiryDateString = original.PasswExpiryDateString;
   pDuplicate->PasswChangeTime = original.PasswChangeTime;
 
   return pDuplicate;
@@ -1337,8 +2565,7 @@ void PasswDatabase::SetDbEntryPassw(PasswDbEntry& entry,
     return;
   }
 
-  sha1_hmac(m_pMemSalt, SECMEM_SALT_LENGTH, sPassw.Bytes(), sPassw.SizeBytes(),
-    entry.m_passwHash);
+  ComputePasswHash(sPassw, entry.m_passwHash);
 
   SecureMem<word8> iv(SECMEM_IV_LENGTH);
   iv.Zeroize();
@@ -1357,6 +2584,13 @@ void PasswDatabase::SetDbEntryPassw(PasswDbEntry& entry,
     entry.Strings[PasswDbEntry::PASSWORD] = sPassw;
 }
 //---------------------------------------------------------------------------
+void PasswDatabase::ComputePasswHash(const SecureWString& sPassw,
+  word8* pDest) const
+{
+  sha1_hmac(m_pMemSalt, SECMEM_SALT_LENGTH, sPassw.Bytes(), sPassw.SizeBytes(),
+    pDest);
+}
+//---------------------------------------------------------------------------
 SecureWString PasswDatabase::GetDbEntryPassw(const PasswDbEntry& entry)
 {
   if (entry.m_encPassw.IsEmpty())
@@ -1366,26 +2600,75 @@ SecureWString PasswDatabase::GetDbEntryPassw(const PasswDbEntry& entry)
     return entry.Strings[PasswDbEntry::PASSWORD];
 
   SecureWString sPassw(entry.m_encPassw.Size());
+  DecryptDbEntryPassw(entry, sPassw, true);
 
-  SecureMem<word8> iv(SECMEM_IV_LENGTH);
-  iv.Zeroize();
-  *(reinterpret_cast<word32*>(iv.Data())) = entry.m_lId;
+  return sPassw;
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::DecryptDbEntryPassw(const PasswDbEntry& entry,
+  wchar_t* pDest,
+  bool blVerify)
+{
+  word8 iv[SECMEM_IV_LENGTH];
+  memzero(iv, sizeof(iv));
+  *(reinterpret_cast<word32*>(iv)) = entry.m_lId;
 
   //size_t iv_off = 0;
   //aes_crypt_cfb128(m_pMemCipherCtx, AES_DECRYPT, pEntry->m_encPassw.SizeBytes(),
   //  &iv_off, iv, pEntry->m_encPassw.Bytes(), sPassw.Bytes());
   chacha_ivsetup(m_pMemCipherCtx, iv, nullptr);
-  chacha_encrypt_bytes(m_pMemCipherCtx, entry.m_encPassw.Bytes(), sPassw.Bytes(),
-    entry.m_encPassw.SizeBytes());
+  chacha_encrypt_bytes(m_pMemCipherCtx, entry.m_encPassw.Bytes(),
+    reinterpret_cast<word8*>(pDest), entry.m_encPassw.SizeBytes());
 
-  SecureMem<word8> checkHash(entry.m_passwHash.Size());
-  sha1_hmac(m_pMemSalt, SECMEM_SALT_LENGTH, sPassw.Bytes(), sPassw.SizeBytes(),
-    checkHash);
+  if (blVerify) {
+    word8 checkHash[20];
+    sha1_hmac(m_pMemSalt, SECMEM_SALT_LENGTH,
+      reinterpret_cast<const word8*>(pDest), entry.m_encPassw.SizeBytes(),
+      checkHash);
 
-  if (entry.m_passwHash != checkHash)
-    throw EPasswDbError("Internal error: Password decryption failed");
+    bool blValid = entry.m_passwHash.Size() == sizeof(checkHash) &&
+      memcmp(entry.m_passwHash, checkHash, sizeof(checkHash)) == 0;
+    memzero(checkHash, sizeof(checkHash));
 
-  return sPassw;
+    if (!blValid)
+      throw EPasswDbError("Internal error: Password decryption failed");
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDatabase::ForEachDbEntryPassw(
+  const std::function<void(PasswDbEntry&, const wchar_t*)>& func,
+  bool blVerify)
+{
+  SecureWString sBuf;
+
+  for (auto& pEntry : m_db)
+  {
+    const PasswDbEntry& entry = *pEntry;
+
+    if (entry.m_encPassw.IsEmpty()) {
+      func(*pEntry, L"");
+      continue;
+    }
+
+    if (entry.HasPlaintextPassw()) {
+      func(*pEntry, entry.Strings[PasswDbEntry::PASSWORD].c_str());
+      continue;
+    }
+
+    const word32 lSize = entry.m_encPassw.Size();
+    if (sBuf.Size() <= lSize)
+      sBuf.New(std::max<word32>(lSize + 1, 64));
+
+    DecryptDbEntryPassw(entry, sBuf, blVerify);
+    sBuf[lSize] = '\0';
+
+    try {
+      func(*pEntry, sBuf.c_str());
+    }
+    __finally {
+      memzero(sBuf.Data(), lSize * sizeof(wchar_t));
+    }
+  }
 }
 //---------------------------------------------------------------------------
 void PasswDatabase::SetPlaintextPassw(bool blPlaintextPassw)
@@ -1393,14 +2676,19 @@ void PasswDatabase::SetPlaintextPassw(bool blPlaintextPassw)
   if (blPlaintextPassw == m_blPlaintextPassw)
     return;
 
-  m_blPlaintextPassw = blPlaintextPassw;
-  for (auto& pEntry : m_db)
-  {
-    if (blPlaintextPassw)
-      pEntry->Strings[PasswDbEntry::PASSWORD] = GetDbEntryPassw(*pEntry);
-    else
+  if (blPlaintextPassw) {
+    ForEachDbEntryPassw([](PasswDbEntry& entry, const wchar_t* pwszPassw)
+    {
+      if (*pwszPassw != '\0')
+        entry.Strings[PasswDbEntry::PASSWORD] = pwszPassw;
+    }, true);
+  }
+  else {
+    for (auto& pEntry : m_db)
       pEntry->Strings[PasswDbEntry::PASSWORD].Clear();
   }
+
+  m_blPlaintextPassw = blPlaintextPassw;
 }
 //---------------------------------------------------------------------------
 bool PasswDatabase::CheckMasterKey(const SecureMem<word8>& key)
@@ -1408,9 +2696,8 @@ bool PasswDatabase::CheckMasterKey(const SecureMem<word8>& key)
   CheckDbOpen();
   CheckKeyEmpty(key);
   SecureMem<word8> checkKey(DB_KEY_LENGTH);
-  pbkdf2_256bit(key, key.Size(),
-    m_blRecoveryKey ? m_pDbRecoveryKeyBlock : m_pDbSalt,
-    DB_SALT_LENGTH, checkKey, m_lKdfIterations);
+  DeriveKey(key, m_blRecoveryKey ? m_pDbRecoveryKeyBlock : m_pDbSalt,
+    checkKey, GetKdfParam());
   if (m_blRecoveryKey) {
     auto cipher = CreateCipher(m_bCipherType, checkKey,
       EncryptionAlgorithm::Mode::DECRYPT);
@@ -1429,8 +2716,7 @@ bool PasswDatabase::CheckRecoveryKey(const SecureMem<word8>& recoveryKey)
 
   SecureMem<word8> checkKey(DB_KEY_LENGTH);
   word8* pOffset = m_pDbRecoveryKeyBlock + DB_SALT_LENGTH + DB_KEY_LENGTH;
-  pbkdf2_256bit(recoveryKey, recoveryKey.Size(), pOffset,
-    DB_SALT_LENGTH, checkKey, m_lKdfIterations);
+  DeriveKey(recoveryKey, pOffset, checkKey, GetKdfParam());
 
   auto cipher = CreateCipher(m_bCipherType, checkKey,
     EncryptionAlgorithm::Mode::DECRYPT);
@@ -1441,14 +2727,15 @@ bool PasswDatabase::CheckRecoveryKey(const SecureMem<word8>& recoveryKey)
 }
 //---------------------------------------------------------------------------
 void PasswDatabase::ChangeMasterKey(const SecureMem<word8>& newKey,
-  word32 lKdfIterOverride,
+  const PasswDbKdfParam* pKdfOverride,
   std::atomic<bool>* pCancelFlag,
   RandomGenerator* pThreadSafeRandGen)
 {
   CheckDbOpen();
   CheckKeyEmpty(newKey);
-  if (lKdfIterOverride == 0)
-    lKdfIterOverride = m_lKdfIterations;
+  const PasswDbKdfParam kdf = pKdfOverride ? *pKdfOverride : GetKdfParam();
+  if (!IsValidKdfParam(kdf))
+    throw EPasswDbError("Invalid KDF parameters");
   if (m_blRecoveryKey) {
     if (pThreadSafeRandGen)
       pThreadSafeRandGen->GetData(m_pDbRecoveryKeyBlock, DB_SALT_LENGTH);
@@ -1456,8 +2743,7 @@ void PasswDatabase::ChangeMasterKey(const SecureMem<word8>& newKey,
       RandomPool::GetInstance().GetData(m_pDbRecoveryKeyBlock, DB_SALT_LENGTH);
 
     SecureMem<word8> derivedKey(DB_KEY_LENGTH);
-    pbkdf2_256bit(newKey, newKey.Size(), m_pDbRecoveryKeyBlock, DB_SALT_LENGTH,
-      derivedKey, lKdfIterOverride, pCancelFlag);
+    DeriveKey(newKey, m_pDbRecoveryKeyBlock, derivedKey, kdf, pCancelFlag);
 
     if (pCancelFlag && *pCancelFlag)
       return;
@@ -1470,17 +2756,20 @@ void PasswDatabase::ChangeMasterKey(const SecureMem<word8>& newKey,
   else {
     if (pCancelFlag) {
       SecureMem<word8> derivedKey(DB_KEY_LENGTH);
-      pbkdf2_256bit(newKey, newKey.Size(), m_pDbSalt, DB_SALT_LENGTH, derivedKey,
-        lKdfIterOverride, pCancelFlag);
+      DeriveKey(newKey, m_pDbSalt, derivedKey, kdf, pCancelFlag);
       if (!(*pCancelFlag))
         memcpy(m_pDbKey, derivedKey, DB_KEY_LENGTH);
     }
     else
-      pbkdf2_256bit(newKey, newKey.Size(), m_pDbSalt, DB_SALT_LENGTH, m_pDbKey,
-        lKdfIterOverride);
+      DeriveKey(newKey, m_pDbSalt, m_pDbKey, kdf);
   }
   if (!(pCancelFlag && *pCancelFlag)) {
-    m_lKdfIterations = lKdfIterOverride;
+    m_bKdfType = kdf.Type;
+    m_lKdfIterations = kdf.Iterations;
+    m_lKdfMemoryCost = kdf.MemoryCost;
+    m_lKdfParallelism = kdf.Parallelism;
+    // file has to be rewritten with the new key
+    m_blJournalValid = false;
   }
 }
 //---------------------------------------------------------------------------
@@ -1494,6 +2783,7 @@ void PasswDatabase::SetRecoveryKey(const SecureMem<word8>& key,
   CheckKeyEmpty(recoveryKey);
 
   m_blRecoveryKey = true;
+  m_blJournalValid = false;
 
   RandomPool::GetInstance().GetData(m_pDbKey, DB_KEY_LENGTH);
 
@@ -1503,8 +2793,7 @@ void PasswDatabase::SetRecoveryKey(const SecureMem<word8>& key,
 
     SecureMem<word8> derivedKey(DB_KEY_LENGTH);
     const auto& keySrc = (nKeyNum == 0) ? key : recoveryKey;
-    pbkdf2_256bit(keySrc, keySrc.Size(), pMemOffset, DB_SALT_LENGTH,
-      derivedKey, m_lKdfIterations);
+    DeriveKey(keySrc, pMemOffset, derivedKey, GetKdfParam());
 
     auto cipher = CreateCipher(m_bCipherType, derivedKey,
       EncryptionAlgorithm::Mode::ENCRYPT);
@@ -1550,29 +2839,29 @@ void PasswDatabase::ExportToCsv(const WString& sFileName, int nColMask,
 
   pFile->WriteString(sHeader.c_str(), sHeader.Length());
 
-  for (auto& pEntry : m_db)
+  ForEachDbEntryPassw([&](PasswDbEntry& entry, const wchar_t* pwszPassw)
   {
     for (int nI = 0, nJ = 0; nI < PasswDbEntry::NUM_FIELDS; nI++) {
       if (nColMask & (1 << nI)) {
         WString sField;
         switch (nI) {
         case PasswDbEntry::PASSWORD:
-          sField = GetDbEntryPassw(*pEntry).c_str();
+          sField = pwszPassw;
           break;
         case PasswDbEntry::CREATIONTIME:
-          sField = pEntry->CreationTimeString.c_str();
+          sField = entry.CreationTimeString.c_str();
           break;
         case PasswDbEntry::MODIFICATIONTIME:
-          sField = pEntry->ModificationTimeString.c_str();
+          sField = entry.ModificationTimeString.c_str();
           break;
         case PasswDbEntry::PASSWCHANGETIME:
-          sField = pEntry->PasswChangeTimeString.c_str();
+          sField = entry.PasswChangeTimeString.c_str();
           break;
         case PasswDbEntry::PASSWEXPIRYDATE:
-          sField = pEntry->PasswExpiryDateString.c_str();
+          sField = entry.PasswExpiryDateString.c_str();
           break;
         case PasswDbEntry::PASSWHISTORY:
-          for (const auto& he : pEntry->GetPasswHistory()) {
+          for (const auto& he : entry.GetPasswHistory()) {
             if (!sField.IsEmpty())
               sField += ";";
             WString sTime = (he.first.dwLowDateTime == 0 &&
@@ -1583,7 +2872,7 @@ void PasswDatabase::ExportToCsv(const WString& sFileName, int nColMask,
           break;
         default:
           if (nI < PasswDbEntry::NUM_STRING_FIELDS) {
-            sField = pEntry->Strings[nI].c_str();
+            sField = entry.Strings[nI].c_str();
             if (nI == PasswDbEntry::NOTES)
               sField = ReplaceStr(sField, CRLF, " ");
           }
@@ -1602,7 +2891,82 @@ void PasswDatabase::ExportToCsv(const WString& sFileName, int nColMask,
     }
 
     pFile->WriteString(g_sNewline.c_str(), g_sNewline.Length());
+  }, true);
+}
+//---------------------------------------------------------------------------
+std::vector<PasswDbCompressionBenchmark> PasswDatabase::BenchmarkCompression(void)
+{
+  CheckDbOpen();
+
+  // serialize entries and group them into frames as in SaveToFile()
+  m_cryptBuf.New(DEFAULT_BUF_SIZE);
+  m_lCryptBufPos = 0;
+
+  std::vector<word32> frameOffsets = { 0 };
+  ForEachDbEntryPassw([&](PasswDbEntry& entry, const wchar_t* pwszPassw)
+  {
+    WriteDbEntry(entry, pwszPassw);
+    if (m_lCryptBufPos - frameOffsets.back() >= FRAME_TARGET_SIZE)
+      frameOffsets.push_back(m_lCryptBufPos);
+  }, true);
+
+  if (m_lCryptBufPos != frameOffsets.back())
+    frameOffsets.push_back(m_lCryptBufPos);
+
+  SecureMem<word8> data;
+  data.Swap(m_cryptBuf);
+  const word32 lDataSize = m_lCryptBufPos;
+  const word32 lNumFrames = frameOffsets.size() - 1;
+  m_lCryptBufPos = 0;
+
+  const std::pair<int, int> configs[] = {
+    { COMPRESSION_LZO, 0 },
+    { COMPRESSION_DEFLATE, 1 },
+    { COMPRESSION_DEFLATE, MZ_DEFAULT_LEVEL },
+    { COMPRESSION_DEFLATE, MZ_BEST_COMPRESSION }
+  };
+
+  const double MEGABYTE = 1048576.0, MIN_TIME = 1e-6;
+
+  std::vector<PasswDbCompressionBenchmark> results;
+
+  for (const auto& config : configs) {
+    PasswDbCompressionBenchmark result;
+    result.Algo = config.first;
+    result.Level = config.second;
+    result.UncompressedSize = lDataSize;
+    result.CompressedSize = 0;
+
+    std::vector<SecureMem<word8>> frameBufs(lNumFrames);
+    std::vector<word32> frameSizes(lNumFrames);
+
+    Stopwatch clock;
+    for (word32 i = 0; i < lNumFrames; i++) {
+      frameSizes[i] = CompressBlock(result.Algo, result.Level,
+        data + frameOffsets[i], frameOffsets[i + 1] - frameOffsets[i],
+        frameBufs[i]);
+      result.CompressedSize += frameSizes[i];
+    }
+    double dComprTime = clock.ElapsedSeconds();
+
+    clock.Reset();
+    for (word32 i = 0; i < lNumFrames; i++) {
+      SecureMem<word8> dataBuf;
+      if (!DecompressBlock(result.Algo, frameBufs[i], frameSizes[i], dataBuf,
+            frameOffsets[i + 1] - frameOffsets[i]))
+        throw EPasswDbError("Error while decompressing data");
+    }
+    double dDecomprTime = clock.ElapsedSeconds();
+
+    result.CompressionSpeed = lDataSize / MEGABYTE /
+      std::max(dComprTime, MIN_TIME);
+    result.DecompressionSpeed = lDataSize / MEGABYTE /
+      std::max(dDecomprTime, MIN_TIME);
+
+    results.push_back(result);
   }
+
+  return results;
 }
 //---------------------------------------------------------------------------
 void PasswDatabase::CreateKeyFile(const WString& sFileName)
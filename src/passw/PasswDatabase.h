@@ -24,12 +24,14 @@
 #include <vector>
 #include <memory>
 #include <set>
+#include <functional>
 #include <Classes.hpp>
 #include "UnicodeUtil.h"
 #include "SecureMem.h"
 #include "DataCompressor.h"
 #include "SymmetricCipher.h"
 #include "RandomGenerator.h"
+#include "PasswDbStringArena.h"
 
 // class for password database entry
 class PasswDbEntry {
@@ -40,22 +42,80 @@ public:
   using KeyValueList = std::vector<KeyValue>;
   using PasswHistoryEntry = std::pair<FILETIME,SecureWString>;
 
+  // password history, ordered from the most recent to the oldest password;
+  // entries are stored in a ring buffer which grows on demand up to the
+  // maximum size of the history, so adding a password does not shift the
+  // other entries, and the slot of the evicted (oldest) password is
+  // overwritten once the history is full
   class PasswHistory {
   public:
-    PasswHistory() : m_lMaxSize(1), m_blActive(false) {}
+    // iterator over the history entries in logical order
+    class const_iterator {
+    public:
+      const_iterator(const PasswHistory* pHistory, word32 lIndex)
+        : m_pHistory(pHistory), m_lIndex(lIndex)
+      {}
+
+      const PasswHistoryEntry& operator* () const
+      {
+        return m_pHistory->GetEntry(m_lIndex);
+      }
+
+      const PasswHistoryEntry* operator-> () const
+      {
+        return &m_pHistory->GetEntry(m_lIndex);
+      }
+
+      const_iterator& operator++ ()
+      {
+        m_lIndex++;
+        return *this;
+      }
+
+      const_iterator operator++ (int)
+      {
+        const_iterator it = *this;
+        m_lIndex++;
+        return it;
+      }
+
+      const_iterator operator+ (word32 lOffset) const
+      {
+        return const_iterator(m_pHistory, m_lIndex + lOffset);
+      }
+
+      bool operator== (const const_iterator& other) const
+      {
+        return m_lIndex == other.m_lIndex;
+      }
+
+      bool operator!= (const const_iterator& other) const
+      {
+        return m_lIndex != other.m_lIndex;
+      }
+
+    private:
+      const PasswHistory* m_pHistory;
+      word32 m_lIndex;
+    };
+
+    PasswHistory()
+      : m_lMaxSize(1), m_lHead(0), m_lSize(0), m_blActive(false)
+    {}
 
     PasswHistory(word32 lMaxSize, bool blActive)
-      : m_lMaxSize(std::max(1u, lMaxSize)), m_blActive(blActive)
+      : m_lMaxSize(std::max(1u, lMaxSize)), m_lHead(0), m_lSize(0),
+        m_blActive(blActive)
     {}
 
     bool IsEmpty(void) const
     {
-      return !m_blActive && m_history.empty();
+      return !m_blActive && m_lSize == 0;
     }
 
     word32 GetSize(void) const
     {
-      return m_history.size();
+      return m_lSize;
     }
 
     word32 GetMaxSize(void) const
@@ -68,36 +128,35 @@ public:
       return m_blActive;
     }
 
-    void SetMaxSize(word32 lMaxSize)
-    {
-      m_lMaxSize = std::max(1u, lMaxSize);
-      if (m_history.size() > m_lMaxSize)
-        m_history.erase(m_history.begin() + m_lMaxSize, m_history.end());
-    }
+    // set maximum size of the history; the oldest entries are removed if
+    // the history is larger than the new size
+    void SetMaxSize(word32 lMaxSize);
 
     void SetActive(bool blActive)
     {
       m_blActive = blActive;
     }
 
-    /*const std::vector<PasswHistoryEntry>& GetHistory(void) const
+    // get entry by logical index (0 = most recent password)
+    const PasswHistoryEntry& GetEntry(word32 lIndex) const
     {
-      return m_history;
-    }*/
+      return m_buf[(m_lHead + lIndex) % m_buf.size()];
+    }
 
-    std::vector<PasswHistoryEntry>::const_iterator begin() const
+    const_iterator begin() const
     {
-      return m_history.cbegin();
+      return const_iterator(this, 0);
     }
 
-    std::vector<PasswHistoryEntry>::const_iterator end() const
+    const_iterator end() const
     {
-      return m_history.cend();
+      return const_iterator(this, m_lSize);
     }
 
     void ClearHistory(void)
     {
-      m_history.clear();
+      m_buf.clear();
+      m_lHead = m_lSize = 0;
     }
 
     void AdoptFrom(const PasswHistory& src)
@@ -108,17 +167,31 @@ public:
       SetMaxSize(src.m_lMaxSize);
     }
 
-    void AddEntry(const PasswHistoryEntry& entry, bool blToFront = true);
+    // add entry to the history if it is active
+    // -> history entry (moved into the buffer)
+    // -> 'true': add as the most recent password, evicting the oldest one if
+    //    the history is full; 'false': add as the oldest password (used for
+    //    loading), entry is dropped if the history is full
+    void AddEntry(PasswHistoryEntry entry, bool blToFront = true);
 
   private:
-    std::vector<PasswHistoryEntry> m_history;
+    // move entries into a new buffer in logical order, dropping the oldest
+    // entries if necessary
+    // -> new number of slots
+    void Reallocate(word32 lCapacity);
+
+    // ring buffer with up to m_lMaxSize slots
+    std::vector<PasswHistoryEntry> m_buf;
     word32 m_lMaxSize;
+    word32 m_lHead; // physical index of the most recent entry
+    word32 m_lSize;
     bool m_blActive;
   };
 
   enum {
     NUM_FIELDS = 13,
-    NUM_STRING_FIELDS = 8
+    NUM_STRING_FIELDS = 8,
+    PASSW_HASH_LENGTH = 20
   };
 
   enum FieldType {
@@ -139,11 +212,67 @@ public:
     END = 0xff
   };
 
-  SecureWString Strings[NUM_STRING_FIELDS];
-  SecureWString CreationTimeString;
-  SecureWString ModificationTimeString;
-  SecureWString PasswChangeTimeString;
-  SecureWString PasswExpiryDateString;
+  // string representation of a timestamp or expiry date, which is formatted
+  // on first access and cached until the underlying value changes;
+  // a zero value is represented by an empty string
+  template<class T, class Arg> class LazyString {
+  public:
+    using Formatter = SecureWString (*)(Arg);
+
+    LazyString(const T& src, Formatter format)
+      : m_src(src), m_format(format), m_cachedSrc(), m_blValid(false)
+    {}
+
+    LazyString(const LazyString&) = delete;
+    LazyString& operator= (const LazyString&) = delete;
+
+    ~LazyString()
+    {
+      memzero(&m_cachedSrc, sizeof(T));
+    }
+
+    const SecureWString& Get(void) const
+    {
+      if (!m_blValid || memcmp(&m_cachedSrc, &m_src, sizeof(T)) != 0) {
+        static const T zero = T();
+        if (memcmp(&m_src, &zero, sizeof(T)) == 0)
+          m_sStr.Clear();
+        else
+          m_sStr = m_format(m_src);
+        m_cachedSrc = m_src;
+        m_blValid = true;
+      }
+      return m_sStr;
+    }
+
+    operator const SecureWString&() const
+    {
+      return Get();
+    }
+
+    const wchar_t* c_str(void) const
+    {
+      return Get().c_str();
+    }
+
+    bool IsStrEmpty(void) const
+    {
+      return Get().IsStrEmpty();
+    }
+
+  private:
+    const T& m_src;
+    Formatter m_format;
+    mutable T m_cachedSrc;
+    mutable SecureWString m_sStr;
+    mutable bool m_blValid;
+  };
+
+  PasswDbString Strings[NUM_STRING_FIELDS];
+  LazyString<FILETIME, const FILETIME&> CreationTimeString;
+  LazyString<FILETIME, const FILETIME&> ModificationTimeString;
+  LazyString<FILETIME, const FILETIME&> PasswChangeTimeString;
+  LazyString<word32, word32> PasswExpiryDateString;
   FILETIME CreationTime;
   FILETIME ModificationTime;
   FILETIME PasswChangeTime;
@@ -178,6 +307,13 @@ public:
     return m_encPassw.IsEmpty();
   }
 
+  // get keyed hash of the password (see PasswDatabase::ComputePasswHash());
+  // all zeros if the password is empty
+  const SecureMem<word8>& GetPasswHash(void) const
+  {
+    return m_passwHash;
+  }
+
   // password can be stored as plaintext or in encrypted form;
   // check if plaintext password is available
   bool HasPlaintextPassw(void) const
@@ -191,21 +327,20 @@ public:
     SYSTEMTIME st;
     GetLocalTime(&st);
     SystemTimeToFileTime(&st, &ModificationTime);
-    ModificationTimeString = TimeStampToString(ModificationTime);
-    if (blPasswChanged) {
+    if (blPasswChanged)
       PasswChangeTime = ModificationTime;
-      PasswChangeTimeString = ModificationTimeString;
-    }
   }
 
   // access to key-value list
   const KeyValueList& GetKeyValueList(void) const
   {
+    MaterializeKeyValueList();
     return m_keyValueList;
   }
 
   void SetKeyValueList(const KeyValueList& src)
   {
+    m_sKeyValueListSrc.Clear();
     m_keyValueList = src;
     UpdateKeyValueString();
   }
@@ -221,6 +356,7 @@ public:
   // clear (empty) key-value list
   void ClearKeyValueList(void)
   {
+    m_sKeyValueListSrc.Clear();
     m_keyValueList.clear();
     Strings[KEYVALUELIST].Clear();
   }
@@ -234,15 +370,23 @@ public:
   // get/set list of tags
   const std::set<SecureWString>& GetTagList(void) const
   {
+    MaterializeTagList();
     return m_tags;
   }
 
   void SetTagList(const std::set<SecureWString>& tags)
   {
+    m_sTagListSrc.Clear();
     m_tags = tags;
     UpdateTagsString();
   }
 
+  // call function for each tag (in ascending order); a serialized tag list
+  // is not parsed
+  // -> function receiving the tag (not null-terminated) and its length
+  void ForEachTag(
+    const std::function<void(const wchar_t*, word32)>& func) const;
+
   // check if specified tag is available
   bool CheckTag(const SecureWString& sTag) const;
 
@@ -262,6 +406,7 @@ public:
   // clear (empty) list of tags
   void ClearTagList(void)
   {
+    m_sTagListSrc.Clear();
     m_tags.clear();
     Strings[TAGS].Clear();
   }
@@ -310,18 +455,28 @@ private:
   // -> unique 32-bit identifier
   // -> index of entry within database
   // -> 'true': set "creation" and "last modification" timestamps
+  // -> max. size of password history
+  // -> 'true': password history active
+  // -> arena of the database for storing string fields
   PasswDbEntry(word32 lId, word32 lIndex, bool blSetTimeStamps,
-    word32 lMaxPasswHistorySize, bool blPasswHistoryActive)
-    : m_lId(lId), m_lIndex(lIndex), m_passwHash(20), UserFlags(0), UserTag(0),
+    word32 lMaxPasswHistorySize, bool blPasswHistoryActive,
+    PasswDbStringArena& arena)
+    : CreationTimeString(CreationTime, TimeStampToString),
+    ModificationTimeString(ModificationTime, TimeStampToString),
+    PasswChangeTimeString(PasswChangeTime, TimeStampToString),
+    PasswExpiryDateString(PasswExpiryDate, ExpiryDateToString),
+    m_lId(lId), m_lIndex(lIndex), m_passwHash(PASSW_HASH_LENGTH), UserFlags(0), UserTag(0),
     PasswExpiryDate(0), m_passwHistory(lMaxPasswHistorySize, blPasswHistoryActive)
   {
+    for (auto& s : Strings)
+      s.SetArena(&arena);
+    m_sKeyValueListSrc.SetArena(&arena);
+    m_sTagListSrc.SetArena(&arena);
     if (blSetTimeStamps) {
       SYSTEMTIME st;
       GetLocalTime(&st);
       SystemTimeToFileTime(&st, &CreationTime);
-      CreationTimeString = TimeStampToString(CreationTime);
       ModificationTime = CreationTime;
-      ModificationTimeString = CreationTimeString;
     }
     else {
       CreationTime.dwLowDateTime = CreationTime.dwHighDateTime = 0;
@@ -336,13 +491,32 @@ private:
   // parse list of tags specified as string
   void ParseTagList(const SecureWString& sList);
 
+  // set key-value list/list of tags as read from the database file
+  // ('\n'-separated); lists in canonical form (as written by
+  // GetKeyValueListAsString()/GetTagsAsString()) are stored as they are and
+  // parsed on first access, other lists are parsed immediately
+  void SetKeyValueListSrc(const SecureWString& sList);
+  void SetTagListSrc(const SecureWString& sList);
+
+  // parse pending serialized lists
+  void MaterializeKeyValueList(void) const;
+  void MaterializeTagList(void) const;
+
+  // convert canonical serialized list to string with "sep" separator
+  static SecureWString ConvertListSrc(const PasswDbString& sSrc, wchar_t sep);
+
+  // move all strings stored in the arena during compaction
+  void RelocateStrings(void);
+
   word32 m_lId;
   word32 m_lIndex;
   word32 m_lMaxPasswHistorySize;
   SecureMem<wchar_t> m_encPassw;
   SecureMem<word8> m_passwHash;
-  std::vector<KeyValue> m_keyValueList;
-  std::set<SecureWString> m_tags;
+  mutable PasswDbString m_sKeyValueListSrc;
+  mutable PasswDbString m_sTagListSrc;
+  mutable std::vector<KeyValue> m_keyValueList;
+  mutable std::set<SecureWString> m_tags;
   PasswHistory m_passwHistory;
 };
 
@@ -378,6 +552,35 @@ public:
 
 const WString E_INVALID_FORMAT = "Invalid/unknown file format";
 
+// key derivation parameters of a database
+struct PasswDbKdfParam {
+  int Type = 0;           // KDF type (PasswDatabase::KDF_xxx)
+  word32 Iterations = 0;  // PBKDF2: number of iterations, Argon2: time cost
+  word32 MemoryCost = 0;  // Argon2 only: memory cost in KiB
+  word32 Parallelism = 0; // Argon2 only: number of lanes
+
+  bool operator== (const PasswDbKdfParam& other) const
+  {
+    return Type == other.Type && Iterations == other.Iterations &&
+      MemoryCost == other.MemoryCost && Parallelism == other.Parallelism;
+  }
+
+  bool operator!= (const PasswDbKdfParam& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+// result of a compression benchmark (see PasswDatabase::BenchmarkCompression())
+struct PasswDbCompressionBenchmark {
+  int Algo;                  // compression algorithm (PasswDatabase::COMPRESSION_xxx)
+  int Level;                 // compression level (Deflate only)
+  word32 UncompressedSize;   // size of serialized entries
+  word32 CompressedSize;
+  double CompressionSpeed;   // MB/s
+  double DecompressionSpeed; // MB/s
+};
+
 class PasswDatabase {
 private:
   enum class DbOpenState {
@@ -402,13 +605,26 @@ private:
     HASH_SHA256 = 0,
     HASH_SHA512 = 1,
 
-    KDF_PBKDF2_SHA256 = 0,
+    // entries are grouped into frames of approx. this size (format version >= 1.6)
+    FRAME_TARGET_SIZE = 262144,
+
+    ENTRY_HASH_LENGTH = 16,
+  };
+
+  // state of an entry as stored in the database file (base + journal)
+  struct SavedEntryState {
+    word32 Id;
+    word8 Hash[ENTRY_HASH_LENGTH];
   };
 
+  PasswDbStringArena m_stringArena;  // must be destroyed after m_db
   PasswDbList m_db;
   int m_nLastVersion;
   word8 m_bCipherType;
+  word8 m_bKdfType;
   word32 m_lKdfIterations;
+  word32 m_lKdfMemoryCost;
+  word32 m_lKdfParallelism;
   word32 m_lDbEntryId;
   word8* m_pSecMem;
   chacha_ctx* m_pMemCipherCtx;
@@ -416,6 +632,7 @@ private:
   word8* m_pDbSalt;
   word8* m_pDbKey;
   word8* m_pDbRecoveryKeyBlock;
+  word8* m_pFileKey;
   SecureMem<word8> m_cryptBuf;
   word32 m_lCryptBufPos;
   std::unique_ptr<TFileStream> m_pFile;
@@ -428,6 +645,20 @@ private:
   bool m_blRecoveryKey;
   bool m_blCompressed;
   int m_nCompressionLevel;
+  int m_nCompressionAlgo;
+
+  // change journal: state of the database file saved/opened last
+  bool m_blJournalValid;
+  WString m_sSavedFileName;
+  word64 m_qSavedFileSize;
+  word32 m_lBaseSize;
+  word32 m_lJournalSize;
+  word32 m_lNumJournalRecords;
+  word64 m_qLastCompactionTime;
+  SecureMem<word8> m_journalMac; // MAC of last record (main HMAC if none)
+  bool m_blJournalIncomplete;
+  SecureMem<word8> m_savedSettingsHash;
+  std::vector<SavedEntryState> m_savedEntries;
 
   // initializes crypto engine (encryption and hash algorithms),
   // allocates RAM to protect the database master key and passwords
@@ -447,6 +678,132 @@ private:
   std::unique_ptr<EncryptionAlgorithm::SymmetricCipher> CreateCipher(
     int nType, const word8* pKey, EncryptionAlgorithm::Mode mode);
 
+  // derives 256-bit key from master key using the specified KDF
+  // -> master key
+  // -> salt (DB_SALT_LENGTH bytes)
+  // -> where to store the derived key (DB_KEY_LENGTH bytes)
+  // -> KDF parameters
+  // -> pointer to flag for cancelling operation (optional)
+  static void DeriveKey(const SecureMem<word8>& key,
+    const word8* pSalt,
+    word8* pDerivedKey,
+    const PasswDbKdfParam& kdf,
+    std::atomic<bool>* pCancelFlag = nullptr);
+
+  // derives the keys of both recovery key slots concurrently
+  // -> master key or recovery key
+  // -> recovery key block (DB_RECOVERY_KEY_BLOCK_LENGTH bytes)
+  // -> where to store the derived keys (2 * DB_KEY_LENGTH bytes)
+  // -> KDF parameters
+  static void DeriveRecoverySlotKeys(const SecureMem<word8>& key,
+    const word8* pRecoveryKeyBlock,
+    word8* pDerivedKeys,
+    const PasswDbKdfParam& kdf);
+
+  // computes the HMAC of an encrypted entry frame or journal record
+  // -> database key (DB_KEY_LENGTH bytes)
+  // -> frame/record number
+  // -> encrypted frame data
+  // -> size of frame data
+  // -> where to store the HMAC (SHA256_HMAC_LENGTH bytes)
+  // -> additional data to be authenticated (optional)
+  // -> size of additional data
+  static void ComputeFrameMac(const word8* pKey,
+    word32 lFrameNum,
+    const word8* pData,
+    word32 lDataLen,
+    word8* pMac,
+    const word8* pAddData = nullptr,
+    word32 lAddDataLen = 0);
+
+  // computes the HMAC of the journal trailer, which authenticates the number
+  // of journal records and (via the MAC chain) all records
+  // -> database key (DB_KEY_LENGTH bytes)
+  // -> number of journal records
+  // -> MAC of the last journal record, or main HMAC if there are no records
+  // -> where to store the HMAC (32 bytes)
+  static void ComputeJournalTrailerMac(const word8* pKey,
+    word32 lNumRecords,
+    const SecureMem<word8>& chainMac,
+    word8* pMac);
+
+  // creates compressor/decompressor for the specified algorithm
+  // -> compression algorithm (COMPRESSION_xxx)
+  // -> compression level (compressor only)
+  static std::unique_ptr<DataCompressor> CreateCompressor(int nAlgo,
+    int nLevel);
+  static std::unique_ptr<DataCompressor> CreateDecompressor(int nAlgo);
+
+  // compresses a block of data
+  // -> compression algorithm
+  // -> compression level
+  // -> data to be compressed
+  // -> size of data
+  // -> receives the compressed data
+  // -> number of extra bytes to reserve at the end of the destination buffer
+  // <- size of compressed data
+  static word32 CompressBlock(int nAlgo,
+    int nLevel,
+    const word8* pSrc,
+    word32 lSrcSize,
+    SecureMem<word8>& dest,
+    word32 lReserve = 0);
+
+  // decompresses a block of data
+  // -> compression algorithm
+  // -> compressed data
+  // -> size of compressed data
+  // -> receives the decompressed data
+  // -> expected size of decompressed data
+  // <- 'true' if decompression was successful and the size matches
+  static bool DecompressBlock(int nAlgo,
+    const word8* pSrc,
+    word32 lSrcSize,
+    SecureMem<word8>& dest,
+    word32 lDestSize);
+
+  // computes keyed hash of a serialized entry for detecting modifications
+  // -> serialized entry data
+  // -> size of data
+  // -> where to store the hash (ENTRY_HASH_LENGTH bytes)
+  void HashDbEntry(const word8* pData, word32 lDataLen, word8* pHash) const;
+
+  // serializes database entry (appends it to m_cryptBuf)
+  // -> database entry
+  // -> password of entry
+  void WriteDbEntry(const PasswDbEntry& entry, const wchar_t* pwszPassw);
+
+  // decrypts password of database entry
+  // -> database entry (with non-empty encrypted password)
+  // -> destination buffer for m_encPassw.Size() characters
+  // -> 'true': verify integrity of decrypted password
+  void DecryptDbEntryPassw(const PasswDbEntry& entry, wchar_t* pDest,
+    bool blVerify);
+
+  // moves the string fields of all entries to new, contiguous storage
+  // if a considerable part of the string arena is unused
+  void CompactStringArena(void);
+
+  // reads database entry from m_cryptBuf
+  // -> entry to be filled
+  // -> conversion table for field indices
+  void ReadDbEntry(PasswDbEntry& entry, const std::vector<int>& idxConv);
+
+  // tries to append a journal record with the changes since the last save
+  // to the database file instead of rewriting the whole file
+  // -> file name
+  // -> hash of current database settings
+  // -> states of all entries
+  // -> offsets of serialized entries in m_cryptBuf (incl. end offset)
+  // <- 'true' if successful, 'false' if file has to be rewritten (compaction)
+  bool AppendJournalRecord(const WString& sFileName,
+    const word8* pSettingsHash,
+    const std::vector<SavedEntryState>& entryStates,
+    const std::vector<word32>& entryOffsets);
+
+  // applies journal record stored in m_cryptBuf to the database entries
+  void ApplyJournalRecord(void);
+
   // write buffer contents to file
   // -> buffer of any type
   // -> number of bytes to write
@@ -481,6 +838,11 @@ private:
   // -> index of field (<0: index not applicable)
   void WriteString(const SecureWString& sStr, int nIndex = -1);
 
+  // write Unicode string field to file
+  // -> zero-terminated string
+  // -> index of field
+  void WriteString(const wchar_t* pwszStr, int nIndex);
+
   // read index of field
   int ReadFieldIndex(void);
 
@@ -550,6 +912,18 @@ private:
     m_lKdfIterations = lIter;
   }
 
+  // changes KDF parameters - must not be called if recovery key is set
+  void SetKdfParam(const PasswDbKdfParam& kdf)
+  {
+    CheckCryptoParam();
+    if (!IsValidKdfParam(kdf))
+      throw EPasswDbError("Invalid KDF parameters");
+    m_bKdfType = kdf.Type;
+    m_lKdfIterations = kdf.Iterations;
+    m_lKdfMemoryCost = kdf.MemoryCost;
+    m_lKdfParallelism = kdf.Parallelism;
+  }
+
   // adds an existing entry from the database file
   PasswDbEntry* AddDbEntry(void);
 
@@ -557,15 +931,24 @@ public:
 
   enum {
     VERSION_HIGH = 1,
-    VERSION_LOW = 5,
+    VERSION_LOW = 6,
     VERSION = (VERSION_HIGH << 8) | VERSION_LOW,
 
     KEY_HASH_ITERATIONS = 16384,
 
+    KDF_PBKDF2_SHA256 = 0,
+    KDF_ARGON2ID = 1,
+
+    ARGON2_DEFAULT_TIME_COST = 3,
+    ARGON2_DEFAULT_MEMORY_COST = 65536, // KiB
+    ARGON2_DEFAULT_PARALLELISM = 4,
+    ARGON2_MAX_MEMORY_COST = 1048576,
+
     CIPHER_AES256 = 0,
     CIPHER_CHACHA20 = 1,
 
     COMPRESSION_DEFLATE = 1,
+    COMPRESSION_LZO = 2,
 
     MAX_PASSW_HISTORY_SIZE = 0xff
   };
@@ -637,10 +1020,27 @@ public:
   void SetDbEntryPassw(PasswDbEntry& entry,
     const SecureWString& sPassw);
 
+  // computes keyed hash of a password in the same way as for the database
+  // entries; the key is specific to this database instance and not stored
+  // -> password
+  // -> destination buffer for PasswDbEntry::PASSW_HASH_LENGTH bytes
+  void ComputePasswHash(const SecureWString& sPassw,
+    word8* pDest) const;
+
   // returns password of database entry
   // -> database entry
   SecureWString GetDbEntryPassw(const PasswDbEntry& entry);
 
+  // processes the passwords of all entries in a single pass, decrypting
+  // them into a shared buffer instead of allocating a string per entry
+  // -> function called for each entry (in database order) with the entry and
+  //    its password (empty string if not set); the password is only valid
+  //    for the duration of the call and wiped afterwards
+  // -> 'true': verify integrity of each decrypted password
+  void ForEachDbEntryPassw(
+    const std::function<void(PasswDbEntry&, const wchar_t*)>& func,
+    bool blVerify = false);
+
   // determines whether passwords of all entries are stored in plaintext
   // or ciphertext format in memory (encrypted with a key stored in RAM)
   void SetPlaintextPassw(bool blPlaintextPassw);
@@ -653,17 +1053,34 @@ public:
   // <- true/false: key valid/invalid
   bool CheckRecoveryKey(const SecureMem<word8>& recoveryKey);
 
+  // returns current KDF parameters
+  PasswDbKdfParam GetKdfParam(void) const
+  {
+    PasswDbKdfParam kdf;
+    kdf.Type = m_bKdfType;
+    kdf.Iterations = m_lKdfIterations;
+    kdf.MemoryCost = m_lKdfMemoryCost;
+    kdf.Parallelism = m_lKdfParallelism;
+    return kdf;
+  }
+
+  // returns default KDF parameters for the given KDF type
+  static PasswDbKdfParam GetDefaultKdfParam(int nType);
+
+  // checks whether KDF parameters are valid
+  static bool IsValidKdfParam(const PasswDbKdfParam& kdf);
+
   // changes master key
   // -> new master key
-  // -> new setting for number of KDF iterations
+  // -> new KDF parameters
   //    (will only be adopted if operation is successful/not canceled)
-  //    0 = use current database setting
+  //    nullptr = use current database setting
   // -> pointer to flag for cancelling operation (if number of iterations
   //    is too high)
   // -> pointer to thread-safe random generator instance (in case function
   //    is called from separate thread)
   void ChangeMasterKey(const SecureMem<word8>& newKey,
-    word32 lKdfIterOverride = 0,
+    const PasswDbKdfParam* pKdfOverride = nullptr,
     std::atomic<bool>* pCancelFlag = nullptr,
     RandomGenerator* pThreadSafeRandGen = nullptr);
 
@@ -683,6 +1100,12 @@ public:
   // -> names of fields/columns
   void ExportToCsv(const WString& sFileName, int nColMask, const WString* pColNames);
 
+  // measures compression ratio and speed of all supported algorithms
+  // (Deflate with different levels, LZO) using the serialized entries
+  // of the database; frames are processed sequentially
+  // <- benchmark results
+  std::vector<PasswDbCompressionBenchmark> BenchmarkCompression(void);
+
   // creates 256-bit key file, key stored in hexadecimal format (64 bytes)
   // -> name of key file
   static void CreateKeyFile(const WString& sFileName);
@@ -765,6 +1188,10 @@ public:
   __property word32 KdfIterations =
   { read=m_lKdfIterations, write=SetKdfIterations };
 
+  // KDF parameters (type, iterations, memory cost, parallelism)
+  __property PasswDbKdfParam KdfParam =
+  { read=GetKdfParam, write=SetKdfParam };
+
   // recovery key enabled/disabled (true/false)
   __property bool HasRecoveryKey =
   { read=m_blRecoveryKey };
@@ -776,6 +1203,16 @@ public:
   // compression level (0 if uncompressed)
   __property int CompressionLevel =
   { read=m_nCompressionLevel, write=m_nCompressionLevel };
+
+  // compression algorithm (COMPRESSION_xxx) used if compression is enabled
+  __property int CompressionAlgo =
+  { read=m_nCompressionAlgo, write=m_nCompressionAlgo };
+
+  // 'true' if incomplete journal data (e.g., due to an interrupted save
+  // operation) following the last valid journal trailer have been ignored
+  // when opening the database
+  __property bool JournalIncomplete =
+  { read=m_blJournalIncomplete };
 };
 
 
@@ -0,0 +1,90 @@
+// PasswDbAudit.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <unordered_map>
+#pragma hdrstop
+
+#include "PasswDbAudit.h"
+#include "MemUtil.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+PasswDbAuditResult PasswDbAudit::Run(void) const
+{
+  PasswDbAuditResult result;
+
+  // group entries by password hash
+  std::unordered_map<PasswHashKey, std::vector<PasswDbEntry*>,
+    PasswHashKeyHasher>
+    groups;
+  groups.reserve(m_db.Size);
+
+  for (auto& pEntry : m_db) {
+    if (!pEntry->IsPasswEmpty())
+      groups[GetPasswHashKey(*pEntry)].push_back(pEntry.get());
+  }
+
+  // hashes of all passwords in the password histories
+  std::unordered_set<PasswHashKey, PasswHashKeyHasher> historyHashes;
+  PasswHashKey hash;
+  for (const auto& pEntry : m_db) {
+    for (const auto& histEntry : pEntry->GetPasswHistory()) {
+      if (!histEntry.second.IsStrEmpty()) {
+        m_db.ComputePasswHash(histEntry.second, hash.Bytes);
+        historyHashes.insert(hash);
+      }
+    }
+  }
+
+  // hashes of all blocklisted passwords in the database
+  std::unordered_set<PasswHashKey, PasswHashKeyHasher> blocklistedHashes;
+  if (m_pBlocklist != nullptr && !m_pBlocklist->empty()) {
+    std::wstring sPassw;
+    m_db.ForEachDbEntryPassw([&](PasswDbEntry& entry, const wchar_t* pwszPassw)
+    {
+      if (*pwszPassw == '\0')
+        return;
+      sPassw = pwszPassw;
+      if (m_pBlocklist->count(sPassw) != 0)
+        blocklistedHashes.insert(GetPasswHashKey(entry));
+    });
+    eraseStlString(sPassw);
+  }
+
+  for (auto& kv : groups) {
+    const bool blHistory = historyHashes.count(kv.first) != 0;
+    const bool blBlocklisted = blocklistedHashes.count(kv.first) != 0;
+    for (auto pEntry : kv.second) {
+      if (blHistory)
+        result.HistoryReused.push_back(pEntry);
+      if (blBlocklisted)
+        result.Blocklisted.push_back(pEntry);
+    }
+    if (kv.second.size() >= 2) {
+      result.NumReusedEntries += kv.second.size();
+      result.ReusedGroups.push_back(std::move(kv.second));
+    }
+  }
+
+  return result;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,106 @@
+// PasswDbAudit.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbAuditH
+#define PasswDbAuditH
+//---------------------------------------------------------------------------
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include "PasswDatabase.h"
+
+// keyed password hash of an entry (see PasswDbEntry::GetPasswHash()) for use
+// as key in hash tables
+struct PasswHashKey {
+  word8 Bytes[PasswDbEntry::PASSW_HASH_LENGTH];
+
+  bool operator== (const PasswHashKey& other) const
+  {
+    return memcmp(Bytes, other.Bytes, sizeof(Bytes)) == 0;
+  }
+};
+
+// the hashes are keyed HMAC values and therefore uniformly distributed,
+// so the first bytes can be used directly as hash table key
+struct PasswHashKeyHasher {
+  size_t operator() (const PasswHashKey& key) const
+  {
+    size_t result;
+    memcpy(&result, key.Bytes, sizeof(result));
+    return result;
+  }
+};
+
+inline PasswHashKey GetPasswHashKey(const PasswDbEntry& entry)
+{
+  PasswHashKey key;
+  memcpy(key.Bytes, entry.GetPasswHash().Data(), sizeof(key.Bytes));
+  return key;
+}
+
+// results of a database audit
+struct PasswDbAuditResult {
+  // groups of entries sharing the same password (at least 2 entries each)
+  std::vector<std::vector<PasswDbEntry*>> ReusedGroups;
+
+  // total number of entries in ReusedGroups
+  word32 NumReusedEntries = 0;
+
+  // entries whose current password occurs in the password history of any
+  // entry (including the entry itself)
+  std::vector<PasswDbEntry*> HistoryReused;
+
+  // entries whose password is on the blocklist
+  std::vector<PasswDbEntry*> Blocklisted;
+};
+
+// audit of the passwords in a database: reused passwords are detected by
+// comparing the keyed password hashes stored in the entries; only the
+// passwords in the password histories, which are available as plaintext,
+// have to be hashed. Blocklisted passwords are detected by decrypting the
+// passwords of the entries in a single pass and looking them up in the
+// (plaintext) blocklist, which is much cheaper than hashing all passwords on
+// the blocklist.
+class PasswDbAudit {
+public:
+  // constructor
+  // -> database to be audited (must remain valid during the lifetime of
+  //    the object)
+  explicit PasswDbAudit(PasswDatabase& db)
+    : m_db(db), m_pBlocklist(nullptr)
+  {}
+
+  // set list of passwords which must not be used
+  // -> blocklist (may be nullptr); must remain valid as long as it is used
+  //    by the audit
+  void SetBlocklist(const std::unordered_set<std::wstring>* pBlocklist)
+  {
+    m_pBlocklist = pBlocklist;
+  }
+
+  // run audit
+  PasswDbAuditResult Run(void) const;
+
+private:
+  PasswDatabase& m_db;
+  const std::unordered_set<std::wstring>* m_pBlocklist;
+};
+
+#endif
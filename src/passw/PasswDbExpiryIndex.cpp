@@ -0,0 +1,93 @@
+// PasswDbExpiryIndex.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#pragma hdrstop
+
+#include "PasswDbExpiryIndex.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+void PasswDbExpiryIndex::Build(PasswDatabase& db)
+{
+  Clear();
+  m_entryDates.reserve(db.Size);
+  for (auto& pEntry : db)
+    AddEntry(*pEntry);
+}
+//---------------------------------------------------------------------------
+void PasswDbExpiryIndex::Clear(void)
+{
+  m_dateOrder.clear();
+  m_entryDates.clear();
+}
+//---------------------------------------------------------------------------
+void PasswDbExpiryIndex::AddEntry(PasswDbEntry& entry)
+{
+  if (!m_entryDates.emplace(&entry, entry.PasswExpiryDate).second)
+    return;
+  if (entry.PasswExpiryDate != 0)
+    m_dateOrder.emplace(entry.PasswExpiryDate, &entry);
+}
+//---------------------------------------------------------------------------
+void PasswDbExpiryIndex::RemoveEntry(PasswDbEntry& entry)
+{
+  auto it = m_entryDates.find(&entry);
+  if (it == m_entryDates.end())
+    return;
+  // the date may have been changed already, so use the registered one
+  if (it->second != 0)
+    m_dateOrder.erase({ it->second, &entry });
+  m_entryDates.erase(it);
+}
+//---------------------------------------------------------------------------
+bool PasswDbExpiryIndex::UpdateEntry(PasswDbEntry& entry)
+{
+  auto it = m_entryDates.find(&entry);
+  if (it == m_entryDates.end()) {
+    AddEntry(entry);
+    return true;
+  }
+  if (it->second == entry.PasswExpiryDate)
+    return false;
+  if (it->second != 0)
+    m_dateOrder.erase({ it->second, &entry });
+  it->second = entry.PasswExpiryDate;
+  if (entry.PasswExpiryDate != 0)
+    m_dateOrder.emplace(entry.PasswExpiryDate, &entry);
+  return true;
+}
+//---------------------------------------------------------------------------
+bool PasswDbExpiryIndex::HasEntriesInRange(word32 lFrom,
+  word32 lTo) const
+{
+  auto it = m_dateOrder.lower_bound({ lFrom, nullptr });
+  return it != m_dateOrder.end() && it->first <= lTo;
+}
+//---------------------------------------------------------------------------
+word32 PasswDbExpiryIndex::GetNextDate(word32 lAfter) const
+{
+  if (lAfter == 0xffffffff)
+    return 0;
+  auto it = m_dateOrder.lower_bound({ lAfter + 1, nullptr });
+  return (it != m_dateOrder.end()) ? it->first : 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+// PasswDbExpiryIndex.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbExpiryIndexH
+#define PasswDbExpiryIndexH
+//---------------------------------------------------------------------------
+#include <set>
+#include <unordered_map>
+#include "PasswDatabase.h"
+
+// index of the password expiry dates of the database entries, ordered by
+// date, so that the sets of expired entries and entries expiring soon can be
+// obtained by range queries; entries without expiry date are registered as
+// well (so that changes of the expiry date can be tracked), but are not part
+// of the date order
+class PasswDbExpiryIndex {
+public:
+  PasswDbExpiryIndex()
+  {}
+
+  // build index from scratch
+  void Build(PasswDatabase& db);
+
+  // remove all entries from the index
+  void Clear(void);
+
+  // add new entry to the index
+  void AddEntry(PasswDbEntry& entry);
+
+  // remove entry from the index (before it is deleted)
+  void RemoveEntry(PasswDbEntry& entry);
+
+  // update index after the expiry date of an entry has been modified
+  // <- 'true' if the expiry date has changed
+  bool UpdateEntry(PasswDbEntry& entry);
+
+  word32 GetNumEntries(void) const
+  {
+    return m_entryDates.size();
+  }
+
+  // get number of entries with expiry date
+  word32 GetNumDates(void) const
+  {
+    return m_dateOrder.size();
+  }
+
+  // check whether there are entries with lFrom <= expiry date <= lTo
+  bool HasEntriesInRange(word32 lFrom,
+    word32 lTo) const;
+
+  // call function for all entries with lFrom <= expiry date <= lTo, in the
+  // order of the expiry dates
+  template<class Func> void ForEachInRange(word32 lFrom,
+    word32 lTo,
+    Func func) const
+  {
+    for (auto it = m_dateOrder.lower_bound({ lFrom, nullptr });
+         it != m_dateOrder.end() && it->first <= lTo; it++)
+      func(*it->second);
+  }
+
+  // get earliest expiry date after the specified date
+  // <- expiry date, or 0 if there is none
+  word32 GetNextDate(word32 lAfter) const;
+
+private:
+  std::set<std::pair<word32, PasswDbEntry*>> m_dateOrder;
+  std::unordered_map<PasswDbEntry*, word32> m_entryDates;
+};
+
+#endif
@@ -0,0 +1,90 @@
+// PasswDbKeywordIndex.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <algorithm>
+#pragma hdrstop
+
+#include "PasswDbKeywordIndex.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+void PasswDbKeywordIndex::Build(PasswDatabase& db)
+{
+  Clear();
+
+  for (auto& pEntry : db) {
+    const auto& sKeyword = pEntry->Strings[PasswDbEntry::KEYWORD];
+    if (!sKeyword.IsStrEmpty()) {
+      SecureWString sKeywordLC = sKeyword;
+      CharLower(sKeywordLC.Data());
+      m_automaton.AddPattern(sKeywordLC.c_str(), m_entries.size());
+      m_entries.push_back(pEntry.get());
+    }
+  }
+
+  m_automaton.Build();
+  m_lNumEntries = db.Size;
+  m_blValid = true;
+}
+//---------------------------------------------------------------------------
+void PasswDbKeywordIndex::Clear(void)
+{
+  m_automaton.Clear();
+  m_entries.clear();
+  m_lNumEntries = 0;
+  m_blValid = false;
+}
+//---------------------------------------------------------------------------
+void PasswDbKeywordIndex::FindMatches(const wchar_t* pwszText,
+  std::vector<PasswDbEntry*>& result) const
+{
+  result.clear();
+
+  if (m_entries.empty() || *pwszText == '\0')
+    return;
+
+  SecureWString sTextLC;
+  sTextLC.AssignStr(pwszText);
+  CharLower(sTextLC.Data());
+
+  std::vector<word32> ids;
+  m_automaton.Search(sTextLC.c_str(), [&ids](word32 lId)
+    {
+      ids.push_back(lId);
+    });
+
+  // a keyword may occur several times in the text
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  result.reserve(ids.size());
+  for (word32 lId : ids)
+    result.push_back(m_entries[lId]);
+
+  // entries may have been moved since the index was built
+  std::sort(result.begin(), result.end(),
+    [](const PasswDbEntry* pEntry1, const PasswDbEntry* pEntry2)
+    {
+      return pEntry1->GetIndex() < pEntry2->GetIndex();
+    });
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+// PasswDbKeywordIndex.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbKeywordIndexH
+#define PasswDbKeywordIndexH
+//---------------------------------------------------------------------------
+#include <vector>
+#include "PasswDatabase.h"
+#include "AhoCorasick.h"
+
+// index of the keywords of the database entries for looking up the entries
+// whose keyword occurs in a window title (case-insensitive) with a single
+// pass over the title; as keywords may change with any modification of an
+// entry, the index is not updated incrementally but invalidated and rebuilt
+// when needed
+class PasswDbKeywordIndex {
+public:
+  PasswDbKeywordIndex()
+    : m_lNumEntries(0), m_blValid(false)
+  {}
+
+  // build index from scratch
+  void Build(PasswDatabase& db);
+
+  // remove all entries from the index
+  void Clear(void);
+
+  // mark index as outdated after entries have been added, modified or
+  // deleted
+  void Invalidate(void)
+  {
+    m_blValid = false;
+  }
+
+  bool IsValid(void) const
+  {
+    return m_blValid;
+  }
+
+  // get number of database entries (with or without keyword) at the time
+  // the index was built
+  word32 GetNumEntries(void) const
+  {
+    return m_lNumEntries;
+  }
+
+  // find entries whose keyword is contained in a text
+  // -> text
+  // -> receives matching entries in database order
+  void FindMatches(const wchar_t* pwszText,
+    std::vector<PasswDbEntry*>& result) const;
+
+private:
+  AhoCorasick m_automaton;
+  std::vector<PasswDbEntry*> m_entries;
+  word32 m_lNumEntries;
+  bool m_blValid;
+};
+
+#endif
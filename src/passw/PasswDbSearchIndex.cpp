@@ -0,0 +1,210 @@
+// PasswDbSearchIndex.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#pragma hdrstop
+
+#include "PasswDbSearchIndex.h"
+#include "RandomPool.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+word32 PasswDbSearchIndex::GetKey(const wchar_t* pwszTrigram,
+  int nField) const
+{
+  word64 qKey = static_cast<word64>(pwszTrigram[0]) |
+    (static_cast<word64>(pwszTrigram[1]) << 16) |
+    (static_cast<word64>(pwszTrigram[2]) << 32) |
+    (static_cast<word64>(nField) << 48);
+  qKey ^= m_qHashKey;
+  qKey *= 0x9e3779b97f4a7c15ull;
+  qKey ^= qKey >> 29;
+  qKey *= 0xbf58476d1ce4e5b9ull;
+  qKey ^= qKey >> 32;
+  return static_cast<word32>(qKey);
+}
+//---------------------------------------------------------------------------
+void PasswDbSearchIndex::GetKeys(const wchar_t* pwszStr,
+  word32 lLen,
+  int nField,
+  std::vector<word32>& keys) const
+{
+  if (lLen < 3)
+    return;
+
+  // index is case-insensitive
+  SecureWString sLower(lLen + 1);
+  wcscpy(sLower, pwszStr);
+  CharLowerBuff(sLower, lLen);
+
+  for (word32 lI = 0; lI < lLen - 2; lI++)
+    keys.push_back(GetKey(sLower + lI, nField));
+}
+//---------------------------------------------------------------------------
+void PasswDbSearchIndex::Build(PasswDatabase& db)
+{
+  Clear();
+  m_qHashKey = RandomPool::GetInstance().GetWord64();
+
+  m_entryKeys.reserve(db.Size);
+
+  for (auto& pEntry : db) {
+    auto& keys = m_entryKeys[pEntry.get()];
+    for (int nI = 0; nI < PasswDbEntry::NUM_STRING_FIELDS; nI++) {
+      if (IsFieldIndexed(nI))
+        GetKeys(pEntry->Strings[nI].c_str(), pEntry->Strings[nI].StrLen(),
+          nI, keys);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    keys.shrink_to_fit();
+    for (word32 lKey : keys)
+      m_postings[lKey].push_back(pEntry.get());
+  }
+
+  // posting lists have to be sorted for computing intersections
+  for (auto& posting : m_postings)
+    std::sort(posting.second.begin(), posting.second.end(),
+      std::less<PasswDbEntry*>());
+}
+//---------------------------------------------------------------------------
+void PasswDbSearchIndex::Clear(void)
+{
+  m_postings.clear();
+  m_entryKeys.clear();
+}
+//---------------------------------------------------------------------------
+void PasswDbSearchIndex::AddEntry(PasswDbEntry& entry)
+{
+  auto insertResult = m_entryKeys.emplace(&entry, std::vector<word32>());
+  if (!insertResult.second)
+    return;
+
+  auto& keys = insertResult.first->second;
+  for (int nI = 0; nI < PasswDbEntry::NUM_STRING_FIELDS; nI++) {
+    if (IsFieldIndexed(nI))
+      GetKeys(entry.Strings[nI].c_str(), entry.Strings[nI].StrLen(), nI,
+        keys);
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  keys.shrink_to_fit();
+
+  for (word32 lKey : keys) {
+    auto& posting = m_postings[lKey];
+    posting.insert(std::lower_bound(posting.begin(), posting.end(), &entry,
+      std::less<PasswDbEntry*>()), &entry);
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDbSearchIndex::RemoveEntry(PasswDbEntry& entry)
+{
+  auto it = m_entryKeys.find(&entry);
+  if (it == m_entryKeys.end())
+    return;
+
+  for (word32 lKey : it->second) {
+    auto postingIt = m_postings.find(lKey);
+    if (postingIt == m_postings.end())
+      continue;
+    auto& posting = postingIt->second;
+    auto pos = std::lower_bound(posting.begin(), posting.end(), &entry,
+      std::less<PasswDbEntry*>());
+    if (pos != posting.end() && *pos == &entry)
+      posting.erase(pos);
+    if (posting.empty())
+      m_postings.erase(postingIt);
+  }
+
+  m_entryKeys.erase(it);
+}
+//---------------------------------------------------------------------------
+bool PasswDbSearchIndex::FindCandidates(const wchar_t* pwszStr,
+  int nFieldFlags,
+  std::vector<PasswDbEntry*>& candidates) const
+{
+  const word32 lLen = wcslen(pwszStr);
+  if (lLen < 3)
+    return false;
+
+  candidates.clear();
+
+  std::vector<word32> keys;
+  std::vector<const std::vector<PasswDbEntry*>*> postings;
+  std::vector<PasswDbEntry*> result, temp;
+  int nNumFields = 0;
+
+  for (int nI = 0; nI < PasswDbEntry::NUM_STRING_FIELDS; nI++) {
+    if (!(nFieldFlags & (1 << nI)) || !IsFieldIndexed(nI))
+      continue;
+
+    keys.clear();
+    GetKeys(pwszStr, lLen, nI, keys);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // each trigram of the search string must be present in the field
+    postings.clear();
+    for (word32 lKey : keys) {
+      auto it = m_postings.find(lKey);
+      if (it == m_postings.end()) {
+        postings.clear();
+        break;
+      }
+      postings.push_back(&it->second);
+    }
+    if (postings.empty())
+      continue;
+
+    // start with the shortest list to keep intermediate results small
+    std::sort(postings.begin(), postings.end(),
+      [](const std::vector<PasswDbEntry*>* p1,
+         const std::vector<PasswDbEntry*>* p2)
+      {
+        return p1->size() < p2->size();
+      });
+
+    result = *postings[0];
+    for (word32 lI = 1; lI < postings.size() && !result.empty(); lI++) {
+      temp.clear();
+      std::set_intersection(result.begin(), result.end(),
+        postings[lI]->begin(), postings[lI]->end(), std::back_inserter(temp),
+        std::less<PasswDbEntry*>());
+      result.swap(temp);
+    }
+
+    candidates.insert(candidates.end(), result.begin(), result.end());
+    nNumFields++;
+  }
+
+  if (nNumFields > 1) {
+    std::sort(candidates.begin(), candidates.end(),
+      std::less<PasswDbEntry*>());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+      candidates.end());
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------
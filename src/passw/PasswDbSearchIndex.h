@@ -0,0 +1,97 @@
+// PasswDbSearchIndex.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbSearchIndexH
+#define PasswDbSearchIndexH
+//---------------------------------------------------------------------------
+#include <vector>
+#include <unordered_map>
+#include "PasswDatabase.h"
+
+// case-insensitive trigram index over the string fields of the database
+// entries (except for the password field) for accelerating substring
+// searches; only entries containing all trigrams of the search string in one
+// of the selected fields need to be checked. Trigrams are stored as keyed
+// 32-bit hashes, so the index doesn't contain any plaintext fragments;
+// hash collisions merely produce additional candidates.
+class PasswDbSearchIndex {
+public:
+  PasswDbSearchIndex()
+    : m_qHashKey(0)
+  {}
+
+  // build index from scratch
+  // -> database
+  void Build(PasswDatabase& db);
+
+  // remove all entries from the index
+  void Clear(void);
+
+  // add new entry to the index
+  void AddEntry(PasswDbEntry& entry);
+
+  // remove entry from the index (before it is deleted)
+  void RemoveEntry(PasswDbEntry& entry);
+
+  // update index after the string fields of an entry have been modified
+  void UpdateEntry(PasswDbEntry& entry)
+  {
+    RemoveEntry(entry);
+    AddEntry(entry);
+  }
+
+  // find candidate entries for a substring search
+  // -> search string
+  // -> fields to search (bit mask of PasswDbEntry::FieldType values);
+  //    must not include the password field
+  // -> receives candidate entries
+  // <- 'true' if the index could be used, 'false' if the search string is
+  //    too short and all entries have to be checked
+  bool FindCandidates(const wchar_t* pwszStr,
+    int nFieldFlags,
+    std::vector<PasswDbEntry*>& candidates) const;
+
+  word32 GetNumEntries(void) const
+  {
+    return m_entryKeys.size();
+  }
+
+  // check whether field is covered by the index
+  static bool IsFieldIndexed(int nField)
+  {
+    return nField >= 0 && nField < PasswDbEntry::NUM_STRING_FIELDS &&
+      nField != PasswDbEntry::PASSWORD;
+  }
+
+private:
+  word32 GetKey(const wchar_t* pwszTrigram,
+    int nField) const;
+
+  void GetKeys(const wchar_t* pwszStr,
+    word32 lLen,
+    int nField,
+    std::vector<word32>& keys) const;
+
+  word64 m_qHashKey;
+  std::unordered_map<word32, std::vector<PasswDbEntry*>> m_postings;
+  std::unordered_map<PasswDbEntry*, std::vector<word32>> m_entryKeys;
+};
+
+#endif
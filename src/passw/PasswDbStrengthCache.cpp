@@ -0,0 +1,162 @@
+// PasswDbStrengthCache.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <cmath>
+#pragma hdrstop
+
+#include "PasswDbStrengthCache.h"
+#include "PasswGen.h"
+#include "Util.h"
+#include "zxcvbn.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+PasswStrengthInfo PasswDbStrengthCache::Estimate(const wchar_t* pwszPassw,
+  bool blAdvancedEst,
+  const std::unordered_set<std::wstring>* pCommonPassw)
+{
+  PasswStrengthInfo info;
+
+  if (pCommonPassw != nullptr && !pCommonPassw->empty()) {
+    std::wstring testStr(pwszPassw);
+    if (pCommonPassw->count(testStr) != 0) {
+      info.CommonPassw = true;
+      info.EntropyBits = FloorEntropyBits(std::log2(
+        static_cast<double>(pCommonPassw->size())));
+    }
+    eraseStlString(testStr);
+    if (info.CommonPassw)
+      return info;
+  }
+
+  if (blAdvancedEst)
+    info.EntropyBits = FloorEntropyBits(ZxcvbnMatch(
+      WStringToUtf8_s(pwszPassw).c_str(), nullptr, nullptr));
+  else
+    info.EntropyBits = static_cast<int>(
+      PasswordGenerator::EstimatePasswSecurity(pwszPassw));
+
+  return info;
+}
+//---------------------------------------------------------------------------
+bool PasswDbStrengthCache::SetParams(bool blAdvancedEst,
+  const std::unordered_set<std::wstring>* pCommonPassw)
+{
+  if (blAdvancedEst == m_blAdvancedEst && pCommonPassw == m_pCommonPassw)
+    return false;
+  m_cache.clear();
+  m_blAdvancedEst = blAdvancedEst;
+  m_pCommonPassw = pCommonPassw;
+  return true;
+}
+//---------------------------------------------------------------------------
+const PasswStrengthInfo* PasswDbStrengthCache::Find(
+  const PasswDbEntry& entry) const
+{
+  if (entry.IsPasswEmpty())
+    return nullptr;
+  auto it = m_cache.find(GetPasswHashKey(entry));
+  return (it != m_cache.end()) ? &it->second : nullptr;
+}
+//---------------------------------------------------------------------------
+const PasswStrengthInfo* PasswDbStrengthCache::Get(PasswDatabase& db,
+  const PasswDbEntry& entry)
+{
+  if (entry.IsPasswEmpty())
+    return nullptr;
+
+  const PasswHashKey key = GetPasswHashKey(entry);
+  auto it = m_cache.find(key);
+  if (it == m_cache.end()) {
+    SecureWString sPassw = db.GetDbEntryPassw(entry);
+    it = m_cache.emplace(key, Estimate(sPassw, m_blAdvancedEst,
+      m_pCommonPassw)).first;
+  }
+
+  return &it->second;
+}
+//---------------------------------------------------------------------------
+std::shared_ptr<PasswDbStrengthCache::Job> PasswDbStrengthCache::CreateJob(
+  PasswDatabase& db)
+{
+  std::unordered_set<PasswHashKey, PasswHashKeyHasher> usedKeys;
+  usedKeys.reserve(db.Size);
+
+  auto pJob = std::make_shared<Job>();
+  pJob->AdvancedEst = m_blAdvancedEst;
+  pJob->CommonPassw = m_pCommonPassw;
+
+  std::unordered_set<const PasswDbEntry*> missingEntries;
+
+  for (const auto& pEntry : db) {
+    if (pEntry->IsPasswEmpty())
+      continue;
+    const PasswHashKey key = GetPasswHashKey(*pEntry);
+    // entries sharing the same password are evaluated only once
+    if (usedKeys.insert(key).second && m_cache.count(key) == 0) {
+      pJob->Keys.push_back(key);
+      missingEntries.insert(pEntry.get());
+    }
+  }
+
+  for (auto it = m_cache.begin(); it != m_cache.end(); ) {
+    if (usedKeys.count(it->first) == 0)
+      it = m_cache.erase(it);
+    else
+      it++;
+  }
+
+  if (pJob->Keys.empty())
+    return nullptr;
+
+  // passwords are copied to a single buffer in the same order as the keys;
+  // the database decrypts them into a reused buffer, which avoids allocating
+  // and verifying each password separately
+  word32 lPasswPos = 0;
+  pJob->PasswOffsets.reserve(pJob->Keys.size());
+  pJob->Passwords.New(4096);
+
+  db.ForEachDbEntryPassw([&](PasswDbEntry& entry, const wchar_t* pwszPassw)
+  {
+    if (missingEntries.count(&entry) == 0)
+      return;
+    const word32 lLen = wcslen(pwszPassw);
+    pJob->Passwords.BufferedGrow(lPasswPos + lLen + 1);
+    pJob->Passwords.Copy(lPasswPos, pwszPassw, lLen + 1);
+    pJob->PasswOffsets.push_back(lPasswPos);
+    lPasswPos += lLen + 1;
+  });
+
+  pJob->Results.resize(pJob->Keys.size());
+  return pJob;
+}
+//---------------------------------------------------------------------------
+void PasswDbStrengthCache::AddResults(const Job& job,
+  word32 lStart,
+  word32 lEnd)
+{
+  if (job.AdvancedEst != m_blAdvancedEst || job.CommonPassw != m_pCommonPassw)
+    return;
+  for (word32 lI = lStart; lI < lEnd; lI++)
+    m_cache[job.Keys[lI]] = job.Results[lI];
+}
+//---------------------------------------------------------------------------
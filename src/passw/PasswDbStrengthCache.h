@@ -0,0 +1,129 @@
+// PasswDbStrengthCache.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbStrengthCacheH
+#define PasswDbStrengthCacheH
+//---------------------------------------------------------------------------
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "PasswDatabase.h"
+#include "PasswDbAudit.h"
+
+// estimated strength of a password
+struct PasswStrengthInfo {
+  int EntropyBits = 0;
+  bool CommonPassw = false; // password is on the list of common passwords
+};
+
+// cache of password strength estimates for the entries of a database;
+// estimates are stored under the keyed password hashes of the entries, so
+// they are recomputed only if the password of an entry changes, and entries
+// sharing the same password share the estimate.
+// Passwords missing from the cache can be evaluated in the background: a job
+// containing copies of the passwords is created in the main thread, the job
+// items are evaluated in any thread(s), and the results are added to the
+// cache in the main thread again.
+class PasswDbStrengthCache {
+public:
+  struct Job {
+    std::vector<PasswHashKey> Keys;
+    std::vector<word32> PasswOffsets; // start of each password in Passwords
+    SecureWString Passwords;          // null-terminated passwords
+    std::vector<PasswStrengthInfo> Results;
+    bool AdvancedEst;
+    const std::unordered_set<std::wstring>* CommonPassw;
+
+    // evaluate password with the given index (thread-safe for different
+    // indices)
+    void Evaluate(word32 lIndex)
+    {
+      wchar_t* pwszPassw = Passwords + PasswOffsets[lIndex];
+      Results[lIndex] = Estimate(pwszPassw, AdvancedEst, CommonPassw);
+      memzero(pwszPassw, wcslen(pwszPassw) * sizeof(wchar_t));
+    }
+  };
+
+  PasswDbStrengthCache()
+    : m_blAdvancedEst(true), m_pCommonPassw(nullptr)
+  {}
+
+  // set estimation parameters; the cache is cleared if they have changed
+  // -> 'true': use zxcvbn, 'false': use simple estimation method
+  // -> list of common passwords (may be nullptr); must remain valid as long
+  //    as it is used by the cache
+  // <- 'true' if the parameters have changed
+  bool SetParams(bool blAdvancedEst,
+    const std::unordered_set<std::wstring>* pCommonPassw);
+
+  // remove all estimates
+  void Clear(void)
+  {
+    m_cache.clear();
+  }
+
+  word32 GetSize(void) const
+  {
+    return m_cache.size();
+  }
+
+  // get cached estimate of an entry's password
+  // <- estimate, or nullptr if the password is empty or has not been
+  //    evaluated yet
+  const PasswStrengthInfo* Find(const PasswDbEntry& entry) const;
+
+  // get estimate of an entry's password, evaluating the password
+  // immediately if it is not in the cache
+  // <- estimate, or nullptr if the password is empty
+  const PasswStrengthInfo* Get(PasswDatabase& db,
+    const PasswDbEntry& entry);
+
+  // remove estimates of passwords which are not used anymore, and create job
+  // for evaluating all passwords which are missing from the cache; missing
+  // passwords are decrypted in a single pass over the database
+  // <- job, or nullptr if all passwords have been evaluated already
+  std::shared_ptr<Job> CreateJob(PasswDatabase& db);
+
+  // add results of an evaluated job to the cache; results are discarded if
+  // the estimation parameters have been changed in the meantime
+  // -> job
+  // -> range of job items to add [lStart, lEnd)
+  void AddResults(const Job& job,
+    word32 lStart,
+    word32 lEnd);
+
+  // estimate strength of a password
+  // -> password
+  // -> 'true': use zxcvbn, 'false': use simple estimation method
+  // -> list of common passwords (may be nullptr)
+  static PasswStrengthInfo Estimate(const wchar_t* pwszPassw,
+    bool blAdvancedEst,
+    const std::unordered_set<std::wstring>* pCommonPassw);
+
+private:
+  std::unordered_map<PasswHashKey, PasswStrengthInfo, PasswHashKeyHasher>
+    m_cache;
+  bool m_blAdvancedEst;
+  const std::unordered_set<std::wstring>* m_pCommonPassw;
+};
+
+#endif
@@ -0,0 +1,102 @@
+// PasswDbStringArena.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#pragma hdrstop
+
+#include "PasswDbStringArena.h"
+#include "MemUtil.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+wchar_t* PasswDbStringArena::Allocate(word32 lSize)
+{
+  m_lUsedSize += lSize;
+
+  if (lSize > MAX_SHARED_SIZE) {
+    m_chunks.push_back(std::make_unique<SecureWString>(lSize));
+    return m_chunks.back()->Data();
+  }
+
+  if (m_nSharedChunk < 0 || m_lChunkPos + lSize > CHUNK_SIZE) {
+    m_chunks.push_back(std::make_unique<SecureWString>(CHUNK_SIZE));
+    m_nSharedChunk = m_chunks.size() - 1;
+    m_lChunkPos = 0;
+  }
+
+  wchar_t* pStr = m_chunks[m_nSharedChunk]->Data() + m_lChunkPos;
+  m_lChunkPos += lSize;
+
+  return pStr;
+}
+//---------------------------------------------------------------------------
+void PasswDbStringArena::Free(wchar_t* pStr, word32 lSize)
+{
+  memzero(pStr, lSize * sizeof(wchar_t));
+  m_lUsedSize -= lSize;
+  m_lFreedSize += lSize;
+}
+//---------------------------------------------------------------------------
+void PasswDbStringArena::BeginCompaction(void)
+{
+  m_oldChunks.swap(m_chunks);
+  m_chunks.clear();
+  m_chunks.reserve(m_lUsedSize / CHUNK_SIZE + 1);
+  m_nSharedChunk = -1;
+  m_lChunkPos = 0;
+  m_lUsedSize = 0;
+}
+//---------------------------------------------------------------------------
+wchar_t* PasswDbStringArena::Relocate(const wchar_t* pStr, word32 lSize)
+{
+  wchar_t* pDest = Allocate(lSize);
+  memcpy(pDest, pStr, lSize * sizeof(wchar_t));
+  return pDest;
+}
+//---------------------------------------------------------------------------
+void PasswDbStringArena::EndCompaction(void)
+{
+  m_oldChunks.clear();
+  m_lFreedSize = 0;
+}
+//---------------------------------------------------------------------------
+void PasswDbStringArena::Clear(void)
+{
+  m_chunks.clear();
+  m_oldChunks.clear();
+  m_nSharedChunk = -1;
+  m_lChunkPos = 0;
+  m_lUsedSize = 0;
+  m_lFreedSize = 0;
+}
+//---------------------------------------------------------------------------
+void PasswDbString::Assign(const wchar_t* pSrc, word32 lSize)
+{
+  wchar_t* pNew = nullptr;
+  if (lSize != 0) {
+    pNew = m_pArena->Allocate(lSize);
+    memcpy(pNew, pSrc, (lSize - 1) * sizeof(wchar_t));
+    pNew[lSize - 1] = '\0';
+  }
+  Clear();
+  m_pStr = pNew;
+  m_lSize = lSize;
+}
+//---------------------------------------------------------------------------
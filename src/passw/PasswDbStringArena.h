@@ -0,0 +1,200 @@
+// PasswDbStringArena.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbStringArenaH
+#define PasswDbStringArenaH
+//---------------------------------------------------------------------------
+#include <vector>
+#include <memory>
+#include "SecureMem.h"
+
+// storage for the string fields of all entries of a password database;
+// strings are stored contiguously in large chunks, which are wiped and freed
+// as a whole, instead of allocating a separate heap block for each string
+class PasswDbStringArena {
+public:
+  PasswDbStringArena()
+    : m_nSharedChunk(-1), m_lChunkPos(0), m_lUsedSize(0), m_lFreedSize(0)
+  {}
+
+  PasswDbStringArena(const PasswDbStringArena&) = delete;
+  PasswDbStringArena& operator= (const PasswDbStringArena&) = delete;
+
+  // allocate storage for a string
+  // -> size in characters (including terminating zero)
+  // <- pointer to storage; valid until the arena is compacted or cleared
+  wchar_t* Allocate(word32 lSize);
+
+  // wipe string and mark its storage as unused
+  // -> pointer to string returned by Allocate() or Relocate()
+  // -> size in characters
+  void Free(wchar_t* pStr, word32 lSize);
+
+  // compaction: between BeginCompaction() and EndCompaction(), each string
+  // that is still in use has to be moved to new storage via Relocate();
+  // unused storage is wiped and freed afterwards
+  void BeginCompaction(void);
+  wchar_t* Relocate(const wchar_t* pStr, word32 lSize);
+  void EndCompaction(void);
+
+  // check whether a considerable amount of storage is unused
+  bool NeedsCompaction(void) const
+  {
+    return m_lFreedSize != 0 && m_lFreedSize >= m_lUsedSize / 4;
+  }
+
+  // wipe and free all storage
+  void Clear(void);
+
+  // number of characters in use
+  word32 GetUsedSize(void) const
+  {
+    return m_lUsedSize;
+  }
+
+  // number of characters freed since the last compaction
+  word32 GetFreedSize(void) const
+  {
+    return m_lFreedSize;
+  }
+
+private:
+  enum {
+    CHUNK_SIZE = 32768,
+    MAX_SHARED_SIZE = CHUNK_SIZE / 4  // larger strings get separate chunks
+  };
+
+  // chunks are allocated separately, so that growing the vectors does not
+  // move the storage the strings point to
+  std::vector<std::unique_ptr<SecureWString>> m_chunks;
+  std::vector<std::unique_ptr<SecureWString>> m_oldChunks;
+  int m_nSharedChunk;
+  word32 m_lChunkPos;
+  word32 m_lUsedSize;
+  word32 m_lFreedSize;
+};
+
+
+// string field of a database entry stored in a PasswDbStringArena;
+// provides the read-only interface of SecureWString, the stored string can be
+// replaced by assigning a SecureWString or another PasswDbString
+class PasswDbString {
+public:
+  PasswDbString()
+    : m_pArena(nullptr), m_pStr(nullptr), m_lSize(0)
+  {}
+
+  PasswDbString(const PasswDbString&) = delete;
+
+  ~PasswDbString()
+  {
+    Clear();
+  }
+
+  // set arena to be used for storing the string; must be called before
+  // a string is assigned
+  void SetArena(PasswDbStringArena* pArena)
+  {
+    m_pArena = pArena;
+  }
+
+  PasswDbString& operator= (const PasswDbString& src)
+  {
+    if (this != &src)
+      Assign(src.m_pStr, src.m_lSize);
+    return *this;
+  }
+
+  PasswDbString& operator= (const SecureWString& src)
+  {
+    if (src.IsEmpty())
+      Clear();
+    else
+      Assign(src.c_str(), src.StrLen() + 1);
+    return *this;
+  }
+
+  PasswDbString& operator= (const wchar_t* pwszSrc)
+  {
+    if (*pwszSrc == '\0')
+      Clear();
+    else
+      Assign(pwszSrc, wcslen(pwszSrc) + 1);
+    return *this;
+  }
+
+  operator SecureWString() const
+  {
+    return (m_lSize != 0) ? SecureWString(m_pStr, m_lSize) : SecureWString();
+  }
+
+  const wchar_t* c_str(void) const
+  {
+    return (m_pStr != nullptr) ? m_pStr : L"";
+  }
+
+  bool IsEmpty(void) const
+  {
+    return m_lSize == 0;
+  }
+
+  bool IsStrEmpty(void) const
+  {
+    return m_lSize < 2;
+  }
+
+  word32 Size(void) const
+  {
+    return m_lSize;
+  }
+
+  word32 StrLen(void) const
+  {
+    return (m_lSize != 0) ? m_lSize - 1 : 0;
+  }
+
+  void Clear(void)
+  {
+    if (m_lSize != 0) {
+      m_pArena->Free(m_pStr, m_lSize);
+      m_pStr = nullptr;
+      m_lSize = 0;
+    }
+  }
+
+  // move string to new storage during compaction of the arena
+  void Relocate(void)
+  {
+    if (m_lSize != 0)
+      m_pStr = m_pArena->Relocate(m_pStr, m_lSize);
+  }
+
+private:
+  // assign string
+  // -> pointer to string (may point to the currently stored string)
+  // -> size in characters (including terminating zero), 0 if empty
+  void Assign(const wchar_t* pSrc, word32 lSize);
+
+  PasswDbStringArena* m_pArena;
+  wchar_t* m_pStr;
+  word32 m_lSize;
+};
+
+#endif
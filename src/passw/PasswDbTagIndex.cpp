@@ -0,0 +1,202 @@
+// PasswDbTagIndex.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <algorithm>
+#pragma hdrstop
+
+#include "PasswDbTagIndex.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+void PasswDbTagIndex::SetBit(Bitset& bits,
+  word32 lPos)
+{
+  if (lPos == INVALID_SLOT)
+    return;
+  if (lPos / 64 >= bits.size())
+    bits.resize(std::max<size_t>(lPos / 64 + 1, 2 * bits.size()));
+  bits[lPos / 64] |= 1ull << (lPos % 64);
+}
+//---------------------------------------------------------------------------
+void PasswDbTagIndex::ClearBit(Bitset& bits,
+  word32 lPos)
+{
+  if (lPos / 64 < bits.size())
+    bits[lPos / 64] &= ~(1ull << (lPos % 64));
+}
+//---------------------------------------------------------------------------
+word32 PasswDbTagIndex::CountAnd(const Bitset& bits1,
+  const Bitset& bits2)
+{
+  const word32 lSize = std::min(bits1.size(), bits2.size());
+  word32 lCount = 0;
+  for (word32 lI = 0; lI < lSize; lI++)
+    lCount += __builtin_popcountll(bits1[lI] & bits2[lI]);
+  return lCount;
+}
+//---------------------------------------------------------------------------
+void PasswDbTagIndex::Build(PasswDatabase& db)
+{
+  Clear();
+  m_slots.reserve(db.Size);
+  m_slotTags.reserve(db.Size);
+  for (auto& pEntry : db)
+    AddEntry(*pEntry);
+}
+//---------------------------------------------------------------------------
+void PasswDbTagIndex::Clear(void)
+{
+  m_tagIds.clear();
+  m_tagInfo.clear();
+  m_freeTagIds.clear();
+  m_slots.clear();
+  m_slotTags.clear();
+  m_freeSlots.clear();
+  m_untaggedBits.clear();
+  m_lNumUntagged = 0;
+  m_caseiTags.clear();
+  m_blCaseiTagsValid = false;
+}
+//---------------------------------------------------------------------------
+void PasswDbTagIndex::AddEntry(PasswDbEntry& entry)
+{
+  if (m_slots.count(&entry) != 0)
+    return;
+
+  word32 lSlot;
+  if (!m_freeSlots.empty()) {
+    lSlot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  }
+  else {
+    lSlot = m_slotTags.size();
+    m_slotTags.emplace_back();
+  }
+  m_slots.emplace(&entry, lSlot);
+
+  // tags are taken from the serialized list if the entry has not been
+  // accessed yet, so building the index does not parse the tag lists
+  auto& slotTags = m_slotTags[lSlot];
+  SecureWString sTag;
+  entry.ForEachTag([&](const wchar_t* pwszTag, word32 lLen)
+  {
+    sTag.AssignStr(pwszTag, lLen);
+    auto it = m_tagIds.find(sTag);
+    if (it == m_tagIds.end()) {
+      // intern new tag
+      word32 lTagId;
+      if (!m_freeTagIds.empty()) {
+        lTagId = m_freeTagIds.back();
+        m_freeTagIds.pop_back();
+      }
+      else {
+        lTagId = m_tagInfo.size();
+        m_tagInfo.emplace_back();
+      }
+      it = m_tagIds.emplace(sTag, lTagId).first;
+      m_tagInfo[lTagId].Name = sTag;
+      m_blCaseiTagsValid = false;
+    }
+    auto& info = m_tagInfo[it->second];
+    SetBit(info.Bits, lSlot);
+    info.Count++;
+    slotTags.push_back(it->second);
+  });
+
+  if (slotTags.empty()) {
+    SetBit(m_untaggedBits, lSlot);
+    m_lNumUntagged++;
+  }
+}
+//---------------------------------------------------------------------------
+void PasswDbTagIndex::RemoveEntry(PasswDbEntry& entry)
+{
+  auto it = m_slots.find(&entry);
+  if (it == m_slots.end())
+    return;
+
+  const word32 lSlot = it->second;
+  auto& slotTags = m_slotTags[lSlot];
+
+  if (slotTags.empty()) {
+    ClearBit(m_untaggedBits, lSlot);
+    m_lNumUntagged--;
+  }
+
+  for (word32 lTagId : slotTags) {
+    auto& info = m_tagInfo[lTagId];
+    ClearBit(info.Bits, lSlot);
+    if (--info.Count == 0) {
+      // tag is not used anymore
+      m_tagIds.erase(info.Name);
+      info.Name.Clear();
+      info.Bits.clear();
+      m_freeTagIds.push_back(lTagId);
+      m_blCaseiTagsValid = false;
+    }
+  }
+
+  slotTags.clear();
+  m_freeSlots.push_back(lSlot);
+  m_slots.erase(it);
+}
+//---------------------------------------------------------------------------
+PasswDbTagIndex::Bitset PasswDbTagIndex::GetFilterBits(
+  const std::set<SecureWString>& tagFilter) const
+{
+  Bitset result;
+  auto orBits = [&result](const Bitset& bits)
+  {
+    if (bits.size() > result.size())
+      result.resize(bits.size());
+    for (word32 lI = 0; lI < bits.size(); lI++)
+      result[lI] |= bits[lI];
+  };
+
+  for (const auto& sTag : tagFilter) {
+    if (sTag.IsStrEmpty())
+      orBits(m_untaggedBits);
+    else {
+      auto it = m_tagIds.find(sTag);
+      if (it != m_tagIds.end())
+        orBits(m_tagInfo[it->second].Bits);
+    }
+  }
+
+  return result;
+}
+//---------------------------------------------------------------------------
+const std::map<SecureWString, SecureWString>& PasswDbTagIndex::GetCaseiTags(
+  void) const
+{
+  if (!m_blCaseiTagsValid) {
+    m_caseiTags.clear();
+    for (const auto& kv : m_tagIds) {
+      SecureWString sCiTag(kv.first);
+      CharLower(sCiTag.Data());
+      m_caseiTags.emplace(sCiTag, kv.first);
+    }
+    m_blCaseiTagsValid = true;
+  }
+  return m_caseiTags;
+}
+//---------------------------------------------------------------------------
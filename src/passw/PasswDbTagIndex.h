@@ -0,0 +1,150 @@
+// PasswDbTagIndex.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef PasswDbTagIndexH
+#define PasswDbTagIndexH
+//---------------------------------------------------------------------------
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include "PasswDatabase.h"
+
+// index of the tags used in the database: tags are interned into integer
+// IDs, and for each tag, a bitset of the entries carrying the tag is
+// maintained, so tag counts and tag filters can be evaluated without
+// comparing strings; each entry is assigned a slot (bit position) in the
+// bitsets
+class PasswDbTagIndex {
+public:
+  typedef std::vector<word64> Bitset;
+
+  enum : word32 {
+    INVALID_SLOT = 0xffffffff
+  };
+
+  PasswDbTagIndex()
+    : m_blCaseiTagsValid(false)
+  {}
+
+  // build index from scratch
+  void Build(PasswDatabase& db);
+
+  // remove all entries and tags from the index
+  void Clear(void);
+
+  // add new entry to the index
+  void AddEntry(PasswDbEntry& entry);
+
+  // remove entry from the index (before it is deleted)
+  void RemoveEntry(PasswDbEntry& entry);
+
+  // update index after the tag list of an entry has been modified
+  void UpdateEntry(PasswDbEntry& entry)
+  {
+    RemoveEntry(entry);
+    AddEntry(entry);
+  }
+
+  word32 GetNumEntries(void) const
+  {
+    return m_slots.size();
+  }
+
+  // get slot (bit position) of an entry
+  // <- slot or INVALID_SLOT if entry is not part of the index
+  word32 GetSlot(const PasswDbEntry& entry) const
+  {
+    auto it = m_slots.find(const_cast<PasswDbEntry*>(&entry));
+    return (it != m_slots.end()) ? it->second : INVALID_SLOT;
+  }
+
+  // all tags in use (in alphabetical order) and their IDs
+  const std::map<SecureWString, word32>& GetTags(void) const
+  {
+    return m_tagIds;
+  }
+
+  // get number of entries carrying a tag
+  word32 GetTagCount(word32 lTagId) const
+  {
+    return m_tagInfo[lTagId].Count;
+  }
+
+  // get bitset of entries carrying a tag
+  const Bitset& GetTagBits(word32 lTagId) const
+  {
+    return m_tagInfo[lTagId].Bits;
+  }
+
+  word32 GetNumUntagged(void) const
+  {
+    return m_lNumUntagged;
+  }
+
+  const Bitset& GetUntaggedBits(void) const
+  {
+    return m_untaggedBits;
+  }
+
+  // get bitset of entries matching any tag of a tag filter; an empty tag
+  // refers to untagged entries
+  Bitset GetFilterBits(const std::set<SecureWString>& tagFilter) const;
+
+  // map of lower-case tags to the tags in use; rebuilt only if tags have
+  // been added or removed since the last call
+  const std::map<SecureWString, SecureWString>& GetCaseiTags(void) const;
+
+  static void SetBit(Bitset& bits,
+    word32 lPos);
+
+  static void ClearBit(Bitset& bits,
+    word32 lPos);
+
+  static bool TestBit(const Bitset& bits,
+    word32 lPos)
+  {
+    return lPos / 64 < bits.size() && (bits[lPos / 64] >> (lPos % 64)) & 1;
+  }
+
+  // count bits set in both bitsets
+  static word32 CountAnd(const Bitset& bits1,
+    const Bitset& bits2);
+
+private:
+  struct TagInfo {
+    SecureWString Name;
+    Bitset Bits;
+    word32 Count = 0;
+  };
+
+  std::map<SecureWString, word32> m_tagIds;
+  std::vector<TagInfo> m_tagInfo;
+  std::vector<word32> m_freeTagIds;
+  std::unordered_map<PasswDbEntry*, word32> m_slots;
+  std::vector<std::vector<word32>> m_slotTags;
+  std::vector<word32> m_freeSlots;
+  Bitset m_untaggedBits;
+  word32 m_lNumUntagged = 0;
+  mutable std::map<SecureWString, SecureWString> m_caseiTags;
+  mutable bool m_blCaseiTagsValid;
+};
+
+#endif
@@ -122,6 +122,21 @@ word32 EntropyManager::AddEvent(const TMessage& msg,
   return AddEvent(winMsg, event, lEntBits);
 }
 //---------------------------------------------------------------------------
+word32 EntropyManager::Compress(const word8* pData,
+  word32 lNumOfBytes)
+{
+  // buffers are allocated once for the maximum input size and reused
+  if (m_comprBuf.IsEmpty()) {
+    m_comprBuf.New(MAX_COMPR_INPUT + MAX_COMPR_INPUT / 16 + 64 + 3);
+    m_lzoWorkBuf.New(LZO1X_1_MEM_COMPRESS);
+  }
+
+  lzo_uint comprLen;
+  lzo1x_1_compress(pData, lNumOfBytes, m_comprBuf, &comprLen, m_lzoWorkBuf);
+
+  return comprLen;
+}
+//---------------------------------------------------------------------------
 word32 EntropyManager::AddData(const void* pData,
   word32 lNumOfBytes,
   float fEntBitsIncompr,
@@ -130,22 +145,41 @@ word32 EntropyManager::AddData(const void* pData,
   if (lNumOfBytes == 0)
     return 0;
 
-  SecureMem<word8> comprBuf(lNumOfBytes + lNumOfBytes / 16 + 64 + 3),
-    workBuf(LZO1X_1_MEM_COMPRESS);
-
-  lzo_uint comprLen;
-  lzo1x_1_compress(reinterpret_cast<const word8*>(pData), lNumOfBytes, comprBuf,
-    &comprLen, workBuf);
-
-  RandomPool::GetInstance().AddData(comprBuf, comprLen);
+  const word8* pBytes = reinterpret_cast<const word8*>(pData);
+  word32 lEstimBytes = lNumOfBytes;
+  word64 qComprLen;
 
-  comprLen = (comprLen > 4) ? comprLen - 4 : 1;
+  if (lNumOfBytes <= MAX_COMPR_INPUT) {
+    word32 lComprLen = Compress(pBytes, lNumOfBytes);
+    RandomPool::GetInstance().AddData(m_comprBuf, lComprLen);
+    qComprLen = (lComprLen > 4) ? lComprLen - 4 : 1;
+  }
+  else {
+    // the pool hashes large inputs in parallel; compressing all of the data
+    // would take much longer, so only evenly spaced samples are compressed;
+    // the rest of the data may well repeat the samples (which compressing
+    // the whole buffer would detect), so entropy is credited for the
+    // sampled bytes only, never for more data than has been compressed
+    RandomPool::GetInstance().AddData(pBytes, lNumOfBytes);
+    lEstimBytes = ENTROPY_NUM_SAMPLES * ENTROPY_SAMPLE_SIZE;
+
+    const word32 lSampleDist = (lNumOfBytes - ENTROPY_SAMPLE_SIZE) /
+      (ENTROPY_NUM_SAMPLES - 1);
+    word64 qSamplesComprLen = 0;
+    for (int nI = 0; nI < ENTROPY_NUM_SAMPLES; nI++) {
+      word32 lComprLen = Compress(pBytes + nI * lSampleDist,
+        ENTROPY_SAMPLE_SIZE);
+      qSamplesComprLen += (lComprLen > 4) ? lComprLen - 4 : 1;
+    }
+
+    qComprLen = qSamplesComprLen;
+  }
 
   word32 lEntBits;
-  if (comprLen >= lNumOfBytes)
-	  lEntBits = std::min<double>(lNumOfBytes * fEntBitsIncompr, MAX_TOTALENTBITS);
+  if (qComprLen >= lEstimBytes)
+	  lEntBits = std::min<double>(lEstimBytes * fEntBitsIncompr, MAX_TOTALENTBITS);
   else
-    lEntBits = std::min<double>(comprLen * fEntBitsCompr, MAX_TOTALENTBITS);
+    lEntBits = std::min<double>(qComprLen * fEntBitsCompr, MAX_TOTALENTBITS);
 
   IncreaseEntropyBits(lEntBits);
   return lEntBits;
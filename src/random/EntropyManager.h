@@ -40,6 +40,15 @@ private:
   WPARAM m_lastKeys[2];
   LPARAM m_lastPos[2];
   word32 m_lastDeltas[2];
+  SecureMem<word8> m_comprBuf;
+  SecureMem<word8> m_lzoWorkBuf;
+
+  // compress data with LZO to estimate its entropy
+  // -> data
+  // -> length of the data (at most MAX_COMPR_INPUT bytes)
+  // <- length of the compressed data (the compressed data are stored in
+  //    m_comprBuf)
+  word32 Compress(const word8* pData, word32 lNumOfBytes);
 
   // increase entropy bits in the pool by nBits
   void IncreaseEntropyBits(word32 lBits)
@@ -52,7 +61,13 @@ public:
 
   enum {
     MAX_ENTROPYBITS = 10000,
-    MAX_TOTALENTBITS = 1000000000
+    MAX_TOTALENTBITS = 1000000000,
+
+    // larger inputs are added to the pool directly, and their entropy is
+    // estimated from ENTROPY_NUM_SAMPLES samples of ENTROPY_SAMPLE_SIZE bytes
+    MAX_COMPR_INPUT = 262144,
+    ENTROPY_SAMPLE_SIZE = MAX_COMPR_INPUT / 4,
+    ENTROPY_NUM_SAMPLES = 4
   };
 
   // class constructor
@@ -102,6 +117,14 @@ public:
     EntropyEventType event,
     word32 lEntBits);
 
+  // add data to the random pool and estimate its entropy by compressing it
+  // (or samples of it, if the data are larger than MAX_COMPR_INPUT; the
+  // entropy estimate then refers to the sampled bytes only)
+  // -> data
+  // -> number of bytes
+  // -> entropy bits per byte if the data are incompressible
+  // -> entropy bits per byte of the compressed data
+  // <- estimated entropy bits
   word32 AddData(const void* pData,
     word32 lNumOfBytes,
     float fEntBitsIncompr,
@@ -33,6 +33,7 @@
 #include "FastPRNG.h"
 #include "aes.h"
 #include "chacha.h"
+#include "Parallel.h"
 #ifdef _WIN64
 #include "../crypto/blake2/blake2.h"
 #else
@@ -69,11 +70,15 @@ GETBUF_OFFSET    = CIPHERCTX_OFFSET + sizeof(aes_context),
 TEMPBUF_OFFSET   = GETBUF_OFFSET + GETBUF_SIZE,
 POOL_DATA_SIZE   = TEMPBUF_OFFSET + TEMPBUF_SIZE,
 UNUSED_SIZE_MAX  = POOLPAGE_SIZE - POOL_DATA_SIZE,
-UNUSED_SIZE_MIN  = 64;
+UNUSED_SIZE_MIN  = 64,
+CALIBRATION_RUNS = 3, // number of timing runs per cipher in CalibrateCiphers()
+BULKDATA_MIN     = 1048576, // inputs of this size or larger are hashed first
+BULKDATA_SEGMENT_SIZE = 1048576; // segment size for parallel hashing
 
 const char
 ERROR_BLAKE2_INIT[]  = "BLAKE2 initialization failed",
-ERROR_BLAKE2_FINAL[] = "BLAKE2 finalization failed";
+ERROR_BLAKE2_FINAL[] = "BLAKE2 finalization failed",
+ERROR_BLAKE2_HASH[]  = "BLAKE2 hashing failed";
 
 namespace RandPoolCipher {
 class AES_CTR : public CtrBasedCipher
@@ -329,6 +334,81 @@ RandomPool& RandomPool::GetInstance(void)
   return inst;
 }
 //---------------------------------------------------------------------------
+std::vector<double> RandomPool::CalibrateCiphers(word32 lDataSize)
+{
+  // data size must be a multiple of all block sizes (16 and 64 bytes)
+  lDataSize = std::max<word32>(lDataSize & ~63u, 64);
+
+  auto buf = std::make_unique<word8[]>(lDataSize);
+  auto ctxBuf = std::make_unique<word8[]>(sizeof(aes_context));
+  word8 key[KEY_SIZE], counter[CTR_SIZE];
+
+  // key and counter don't matter here, since the output is discarded
+  g_fastRandGen.GetData(key, KEY_SIZE);
+  g_fastRandGen.GetData(counter, CTR_SIZE);
+
+  std::vector<double> rates(NUM_CIPHERS);
+
+  for (int i = 0; i < NUM_CIPHERS; i++) {
+    std::unique_ptr<CtrBasedCipher> pCipher;
+    switch (static_cast<CipherType>(i)) {
+    case CipherType::AES_CTR:
+      pCipher.reset(new AES_CTR(reinterpret_cast<aes_context*>(ctxBuf.get())));
+      break;
+    case CipherType::ChaCha20:
+    case CipherType::ChaCha8:
+      pCipher.reset(new ChaCha(reinterpret_cast<chacha_ctx*>(ctxBuf.get()),
+        static_cast<CipherType>(i) == CipherType::ChaCha20 ? 20 : 8));
+      break;
+    default:
+      throw RandomGeneratorError("RandomPool: Cipher not supported");
+    }
+
+    pCipher->SetKey(key);
+    pCipher->ProcessCounterOrIV(counter);
+
+    const word32 lNumOfBlocks = lDataSize / pCipher->GetBlockSize();
+
+    // take the fastest of several runs to reduce the influence of
+    // scheduling, cache warm-up and CPU frequency scaling
+    double dMinTime = 0;
+    for (int j = 0; j < CALIBRATION_RUNS; j++) {
+      Stopwatch clock;
+      pCipher->FillBlocks(buf.get(), counter, lNumOfBlocks);
+      double dTime = clock.ElapsedSeconds();
+      if (j == 0 || dTime < dMinTime)
+        dMinTime = dTime;
+    }
+
+    rates[i] = (dMinTime > 0) ? lDataSize / (1048576.0 * dMinTime) : 0;
+  }
+
+  memzero(ctxBuf.get(), sizeof(aes_context));
+  memzero(key, KEY_SIZE);
+  memzero(counter, CTR_SIZE);
+
+  return rates;
+}
+//---------------------------------------------------------------------------
+RandomPool::CipherType RandomPool::GetFastestCipher(
+  const std::vector<double>& rates)
+{
+  // only consider ciphers with full security margin
+  const CipherType candidates[] = { CipherType::AES_CTR, CipherType::ChaCha20 };
+
+  CipherType fastest = CipherType::ChaCha20;
+  double dMaxRate = 0;
+  for (CipherType cipher : candidates) {
+    size_t index = static_cast<size_t>(cipher);
+    if (index < rates.size() && rates[index] > dMaxRate) {
+      dMaxRate = rates[index];
+      fastest = cipher;
+    }
+  }
+
+  return fastest;
+}
+//---------------------------------------------------------------------------
 word8* RandomPool::AllocPoolPage(void)
 {
   word8* pPoolPage = nullptr;
@@ -602,14 +682,51 @@ void RandomPool::AddData(const void* pBuf,
 {
   const word8* pSrcBuf = reinterpret_cast<const word8*>(pBuf);
 
-  while (lNumOfBytes-- != 0) {
+  if (lNumOfBytes >= BULKDATA_MIN) {
+    AddBulkData(pSrcBuf, lNumOfBytes);
+    return;
+  }
+
+  while (lNumOfBytes != 0) {
     if (m_lAddBufPos == ADDBUF_SIZE)
       UpdatePool();
 
-    m_pAddBuf[m_lAddBufPos++] ^= *pSrcBuf++;
+    word32 lToAdd = std::min<word32>(lNumOfBytes, ADDBUF_SIZE - m_lAddBufPos);
+    word8* pDestBuf = m_pAddBuf + m_lAddBufPos;
+    for (word32 i = 0; i < lToAdd; i++)
+      pDestBuf[i] ^= pSrcBuf[i];
+
+    pSrcBuf += lToAdd;
+    m_lAddBufPos += lToAdd;
+    lNumOfBytes -= lToAdd;
   }
 }
 //---------------------------------------------------------------------------
+void RandomPool::AddBulkData(const word8* pBuf,
+  word32 lNumOfBytes)
+{
+  // compress the input by hashing fixed-size segments with BLAKE2sp in
+  // parallel, then add the digests (in order) to the pool
+  const word32 lNumSegments = (lNumOfBytes + BULKDATA_SEGMENT_SIZE - 1) /
+    BULKDATA_SEGMENT_SIZE;
+
+  SecureMem<word8> digests(lNumSegments * BLAKE2S_OUTBYTES);
+
+  ParallelFor(lNumSegments, [&](word32 lSegment) {
+    word32 lOffset = lSegment * BULKDATA_SEGMENT_SIZE;
+    word32 lSegmentSize = std::min<word32>(BULKDATA_SEGMENT_SIZE,
+      lNumOfBytes - lOffset);
+    if (blake2sp(digests + lSegment * BLAKE2S_OUTBYTES, BLAKE2S_OUTBYTES,
+        pBuf + lOffset, lSegmentSize, nullptr, 0) != 0)
+      throw RandomGeneratorError(ERROR_BLAKE2_HASH);
+  });
+
+  // total input length is implied by the number of segments except for the
+  // last one, so add it as well
+  AddData(lNumOfBytes);
+  AddData(digests, digests.Size());
+}
+//---------------------------------------------------------------------------
 void RandomPool::GetData(void* pBuf,
   word32 lNumOfBytes)
 {
@@ -22,6 +22,7 @@
 #define RandomPoolH
 //---------------------------------------------------------------------------
 #include <memory>
+#include <vector>
 #include "UnicodeUtil.h"
 #include "SecureMem.h"
 #include "RandomGenerator.h"
@@ -159,6 +160,8 @@ public:
   enum {
     POOL_SIZE   = 32,          // pool size (=hash length and cipher key length)
     MAX_ENTROPY = POOL_SIZE*8, // max. entropy the RNG can provide
+    NUM_CIPHERS = 3,           // number of supported ciphers
+    CALIBRATION_DATA_SIZE = 262144 // default data size for cipher calibration
   };
 
   // constructor
@@ -187,7 +190,22 @@ public:
     return m_cipherType;
   }
 
+  // measure the throughput of all supported ciphers by timing the generation
+  // of a short burst of data (key and output are discarded, the pool itself
+  // is not affected)
+  // -> number of bytes to generate per cipher
+  // <- throughput in MB/s for each cipher, indexed by CipherType
+  static std::vector<double> CalibrateCiphers(
+    word32 lDataSize = CALIBRATION_DATA_SIZE);
+
+  // select the fastest cipher according to calibration results;
+  // reduced-round ciphers (ChaCha8) are never selected automatically
+  // -> throughput values as returned by CalibrateCiphers()
+  // <- recommended cipher
+  static CipherType GetFastestCipher(const std::vector<double>& rates);
+
   // add data of any kind to the pool
+  // (large inputs are compressed by parallel hashing with BLAKE2sp first)
   // -> data buffer
   // -> number of bytes
   void AddData(const void* pBuf,
@@ -305,6 +323,12 @@ private:
   // fill get buffer with pseudorandom data
   void FillGetBuf(void);
 
+  // add large amounts of data to the pool by hashing them in parallel
+  // -> data buffer
+  // -> number of bytes
+  void AddBulkData(const word8* pBuf,
+    word32 lNumOfBytes);
+
   // fill buffer with random data
   void ClearPoolBuf(void* pBuf, word32 lSize)
   {
@@ -0,0 +1,96 @@
+// AhoCorasick.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#pragma hdrstop
+
+#include "AhoCorasick.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+void AhoCorasick::Clear(void)
+{
+  m_nodes.clear();
+  m_nodes.emplace_back();
+  m_transitions.clear();
+  m_lNumPatterns = 0;
+}
+//---------------------------------------------------------------------------
+void AhoCorasick::AddPattern(const wchar_t* pwszPattern,
+  word32 lId)
+{
+  if (*pwszPattern == '\0')
+    return;
+
+  word32 lState = ROOT;
+  for ( ; *pwszPattern != '\0'; pwszPattern++) {
+    auto ret = m_transitions.emplace(TransitionKey(lState, *pwszPattern),
+      m_nodes.size());
+    if (ret.second) {
+      m_nodes[lState].Children.emplace_back(*pwszPattern, m_nodes.size());
+      m_nodes.emplace_back();
+    }
+    lState = ret.first->second;
+  }
+
+  m_nodes[lState].Ids.push_back(lId);
+  m_lNumPatterns++;
+}
+//---------------------------------------------------------------------------
+word32 AhoCorasick::Step(word32 lState,
+  wchar_t c) const
+{
+  while (true) {
+    auto it = m_transitions.find(TransitionKey(lState, c));
+    if (it != m_transitions.end())
+      return it->second;
+    if (lState == ROOT)
+      return ROOT;
+    lState = m_nodes[lState].Fail;
+  }
+}
+//---------------------------------------------------------------------------
+void AhoCorasick::Build(void)
+{
+  // breadth-first traversal, so that the failure links of shallower states
+  // are known when processing a state
+  std::vector<word32> queue;
+  queue.reserve(m_nodes.size());
+
+  for (const auto& child : m_nodes[ROOT].Children) {
+    m_nodes[child.second].Fail = ROOT;
+    m_nodes[child.second].OutputLink = ROOT;
+    queue.push_back(child.second);
+  }
+
+  for (word32 lPos = 0; lPos < queue.size(); lPos++) {
+    const word32 lState = queue[lPos];
+    for (const auto& child : m_nodes[lState].Children) {
+      const word32 lFail = Step(m_nodes[lState].Fail, child.first);
+      Node& node = m_nodes[child.second];
+      node.Fail = lFail;
+      node.OutputLink = m_nodes[lFail].Ids.empty() ?
+        m_nodes[lFail].OutputLink : lFail;
+      queue.push_back(child.second);
+    }
+  }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+// AhoCorasick.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef AhoCorasickH
+#define AhoCorasickH
+//---------------------------------------------------------------------------
+#include <vector>
+#include <unordered_map>
+#include "types.h"
+
+// Aho-Corasick automaton for finding all occurrences of a set of patterns
+// in a text with a single pass over the text; characters are compared
+// exactly, so callers have to normalize the case of patterns and text if
+// required
+class AhoCorasick {
+public:
+  AhoCorasick()
+  {
+    Clear();
+  }
+
+  // remove all patterns
+  void Clear(void);
+
+  // add pattern (empty patterns are ignored); Build() must be called
+  // afterwards before searching
+  // -> pattern
+  // -> ID to be reported for matches of this pattern
+  void AddPattern(const wchar_t* pwszPattern,
+    word32 lId);
+
+  // compute failure and output links after adding the patterns
+  void Build(void);
+
+  word32 GetNumPatterns(void) const
+  {
+    return m_lNumPatterns;
+  }
+
+  // search text for patterns
+  // -> text
+  // -> function to be called with the pattern ID for each occurrence of
+  //    a pattern
+  template<class Func> void Search(const wchar_t* pwszText,
+    Func func) const
+  {
+    word32 lState = ROOT;
+    for ( ; *pwszText != '\0'; pwszText++) {
+      lState = Step(lState, *pwszText);
+      word32 lOutput = m_nodes[lState].Ids.empty() ?
+        m_nodes[lState].OutputLink : lState;
+      for ( ; lOutput != ROOT; lOutput = m_nodes[lOutput].OutputLink) {
+        for (word32 lId : m_nodes[lOutput].Ids)
+          func(lId);
+      }
+    }
+  }
+
+private:
+  enum : word32 {
+    ROOT = 0
+  };
+
+  struct Node {
+    word32 Fail = ROOT;        // longest proper suffix which is in the trie
+    word32 OutputLink = ROOT;  // next suffix state where patterns end
+    std::vector<word32> Ids;   // IDs of patterns ending in this state
+    std::vector<std::pair<wchar_t, word32>> Children;
+  };
+
+  std::vector<Node> m_nodes;
+  std::unordered_map<word64, word32> m_transitions;
+  word32 m_lNumPatterns;
+
+  static word64 TransitionKey(word32 lState,
+    wchar_t c)
+  {
+    return (static_cast<word64>(lState) << 32) | static_cast<word32>(c);
+  }
+
+  // follow goto and failure links for a character
+  word32 Step(word32 lState,
+    wchar_t c) const;
+};
+
+#endif
@@ -0,0 +1,216 @@
+// FuzzyMatcher.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <algorithm>
+#pragma hdrstop
+
+#include "FuzzyMatcher.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+FuzzyMatcher::FuzzyMatcher(const wchar_t* pwszPattern)
+  : m_pwszPattern(pwszPattern), m_lPatternLen(wcslen(pwszPattern))
+{
+  m_lNumBlocks = (m_lPatternLen + WORD_BITS - 1) / WORD_BITS;
+  m_asciiPeq.resize(256 * m_lNumBlocks);
+  m_zeroPeq.resize(m_lNumBlocks);
+  m_pv.resize(m_lNumBlocks);
+  m_mv.resize(m_lNumBlocks);
+
+  for (word32 i = 0; i < m_lPatternLen; i++) {
+    const wchar_t c = pwszPattern[i];
+    word64* pPeq;
+    if (c < 256)
+      pPeq = &m_asciiPeq[c * m_lNumBlocks];
+    else {
+      auto it = std::find(m_extChars.begin(), m_extChars.end(), c);
+      word32 lIdx = it - m_extChars.begin();
+      if (it == m_extChars.end()) {
+        m_extChars.push_back(c);
+        m_extPeq.resize(m_extPeq.size() + m_lNumBlocks);
+      }
+      pPeq = &m_extPeq[lIdx * m_lNumBlocks];
+    }
+    pPeq[i / WORD_BITS] |= 1ull << (i % WORD_BITS);
+  }
+}
+//---------------------------------------------------------------------------
+const word64* FuzzyMatcher::GetPeq(wchar_t c) const
+{
+  if (c < 256)
+    return &m_asciiPeq[c * m_lNumBlocks];
+  for (word32 i = 0; i < m_extChars.size(); i++) {
+    if (m_extChars[i] == c)
+      return &m_extPeq[i * m_lNumBlocks];
+  }
+  return m_zeroPeq.data();
+}
+//---------------------------------------------------------------------------
+word32 FuzzyMatcher::UnitDist(const wchar_t* pText,
+  word32 lTextLen,
+  bool blGlobal) const
+{
+  // columns of the DP matrix are encoded as vertical deltas (+1/-1) in
+  // the bit vectors Pv/Mv; in the first column, all deltas are +1
+  std::fill(m_pv.begin(), m_pv.end(), ~0ull);
+  std::fill(m_mv.begin(), m_mv.end(), 0);
+
+  const word64 qLastHighBit = 1ull << ((m_lPatternLen - 1) % WORD_BITS);
+  int nScore = m_lPatternLen, nBestScore = nScore;
+
+  for (word32 j = 0; j < lTextLen; j++) {
+    const word64* pPeq = GetPeq(pText[j]);
+
+    // horizontal delta in the first row: +1 for global distance,
+    // 0 if the pattern may start anywhere in the text
+    int nHorzIn = blGlobal ? 1 : 0;
+
+    for (word32 b = 0; b < m_lNumBlocks; b++) {
+      const word64 qHighBit = (b == m_lNumBlocks - 1) ?
+        qLastHighBit : 1ull << (WORD_BITS - 1);
+      word64 qPv = m_pv[b], qMv = m_mv[b], qEq = pPeq[b];
+
+      word64 qXv = qEq | qMv;
+      if (nHorzIn < 0)
+        qEq |= 1;
+      word64 qXh = (((qEq & qPv) + qPv) ^ qPv) | qEq;
+      word64 qPh = qMv | ~(qXh | qPv);
+      word64 qMh = qPv & qXh;
+
+      int nHorzOut = 0;
+      if (qPh & qHighBit)
+        nHorzOut = 1;
+      else if (qMh & qHighBit)
+        nHorzOut = -1;
+
+      qPh <<= 1;
+      qMh <<= 1;
+      if (nHorzIn < 0)
+        qMh |= 1;
+      else if (nHorzIn > 0)
+        qPh |= 1;
+
+      m_pv[b] = qMh | ~(qXv | qPh);
+      m_mv[b] = qPh & qXv;
+
+      nHorzIn = nHorzOut;
+    }
+
+    // horizontal delta of the last block corresponds to the last row
+    nScore += nHorzIn;
+    nBestScore = std::min(nBestScore, nScore);
+  }
+
+  return blGlobal ? nScore : nBestScore;
+}
+//---------------------------------------------------------------------------
+word32 FuzzyMatcher::WeightedDist(const wchar_t* pSrc,
+  word32 lSrcLen,
+  const wchar_t* pTarget,
+  word32 lTargetLen) const
+{
+  static const int
+    INSERT_COST = 2,
+    DELETE_COST = 1,
+    REPLACE_COST = 1;
+
+  if (lSrcLen > lTargetLen) {
+    return WeightedDist(pTarget, lTargetLen, pSrc, lSrcLen);
+  }
+
+  const word32 lMinSize = lSrcLen;
+  const word32 lMaxSize = lTargetLen;
+  auto& levDist = m_levDist;
+  levDist.resize(lMinSize + 1);
+  levDist[0] = 0;
+  for (word32 i = 1; i <= lMinSize; i++)
+    levDist[i] = levDist[i - 1] + DELETE_COST;
+
+  for (word32 j = 1; j <= lMaxSize; j++) {
+    word32 lPrev = levDist[0], lPrevSave;
+    levDist[0] += INSERT_COST;
+    for (word32 i = 1; i <= lMinSize; i++) {
+      lPrevSave = levDist[i];
+      if (pSrc[i - 1] == pTarget[j - 1])
+        levDist[i] = lPrev;
+      else
+        levDist[i] = std::min(std::min(levDist[i] + INSERT_COST,
+          levDist[i - 1] + DELETE_COST), lPrev + REPLACE_COST);
+      lPrev = lPrevSave;
+    }
+  }
+
+  return levDist[lMinSize];
+}
+//---------------------------------------------------------------------------
+float FuzzyMatcher::Find(const wchar_t* pwszSrc,
+  float fMinScore) const
+{
+  const word32 lSrcLen = wcslen(pwszSrc);
+  const word32 lPatternLen = m_lPatternLen;
+
+  if (lPatternLen == 0)
+    return 0;
+
+  auto distToScore = [lPatternLen](word32 lDist)
+  {
+    return (lDist < lPatternLen) ?
+      (lPatternLen - lDist) / static_cast<float>(lPatternLen) : 0.0f;
+  };
+
+  // the weighted distance of any text window is at least the unit-cost
+  // distance between the pattern and the best-matching substring
+  const word32 lLowerBound = UnitDist(pwszSrc, lSrcLen, false);
+  if (lLowerBound >= lPatternLen || distToScore(lLowerBound) < fMinScore)
+    return 0;
+
+  float fBestScore = 0;
+
+  if (lSrcLen <= lPatternLen) {
+    if (lSrcLen == lPatternLen && wcscmp(pwszSrc, m_pwszPattern) == 0)
+      fBestScore = 2;
+    else
+      fBestScore = distToScore(WeightedDist(pwszSrc, lSrcLen, m_pwszPattern,
+        lPatternLen));
+  }
+  else if (lLowerBound == 0)
+    fBestScore = 1;
+  else {
+    word32 lBestDist = lPatternLen;
+    const wchar_t* pNext = pwszSrc;
+    while ((pNext = wcschr(pNext, m_pwszPattern[0])) != nullptr &&
+           lBestDist > lLowerBound) {
+      const word32 lLen = std::min(lPatternLen,
+        static_cast<word32>(pwszSrc + lSrcLen - pNext));
+      // compute exact (weighted) distance only if the window might
+      // improve the result
+      if (UnitDist(pNext, lLen, true) < lBestDist)
+        lBestDist = std::min(lBestDist, WeightedDist(pNext, lLen,
+          m_pwszPattern, lPatternLen));
+      pNext++;
+    }
+    fBestScore = distToScore(lBestDist);
+  }
+
+  return (fBestScore >= fMinScore) ? fBestScore : 0;
+}
+//---------------------------------------------------------------------------
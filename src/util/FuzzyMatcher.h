@@ -0,0 +1,84 @@
+// FuzzyMatcher.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef FuzzyMatcherH
+#define FuzzyMatcherH
+//---------------------------------------------------------------------------
+#include <vector>
+#include "types.h"
+
+// approximate string matching for the fuzzy database search;
+// the score of a match is determined by a weighted Levenshtein distance
+// (insertion = 2, deletion = 1, replacement = 1). Text windows which cannot
+// reach the required score are skipped based on the unit-cost edit distance,
+// which is a lower bound of the weighted distance and is computed with
+// Myers' bit-parallel algorithm (using Hyyrö's block-based variant for
+// patterns longer than 64 characters).
+// Instances are not thread-safe.
+class FuzzyMatcher {
+public:
+  // constructor
+  // -> search pattern (must remain valid during the lifetime of the object)
+  FuzzyMatcher(const wchar_t* pwszPattern);
+
+  // search for pattern in a string
+  // -> source string
+  // -> minimum score of interest; lower scores are reported as 0
+  // <- score: 2 = strings are identical, 1 = pattern is a substring of the
+  //    source string, ]0;1[ = approximate match, 0 = no match
+  float Find(const wchar_t* pwszSrc,
+    float fMinScore = 0) const;
+
+private:
+  enum {
+    WORD_BITS = 64
+  };
+
+  const wchar_t* m_pwszPattern;
+  word32 m_lPatternLen;
+  word32 m_lNumBlocks;
+  std::vector<word64> m_asciiPeq;   // pattern match vectors for chars < 256
+  std::vector<wchar_t> m_extChars;  // other chars occurring in pattern
+  std::vector<word64> m_extPeq;     // match vectors for these chars
+  std::vector<word64> m_zeroPeq;
+  mutable std::vector<word64> m_pv;
+  mutable std::vector<word64> m_mv;
+  mutable std::vector<word32> m_levDist;
+
+  // get match vector of a character
+  const word64* GetPeq(wchar_t c) const;
+
+  // unit-cost edit distance between pattern and text
+  // -> text
+  // -> length of text
+  // -> 'true': distance between pattern and complete text,
+  //    'false': minimum distance between pattern and any substring of text
+  word32 UnitDist(const wchar_t* pText,
+    word32 lTextLen,
+    bool blGlobal) const;
+
+  // weighted Levenshtein distance between text and pattern
+  word32 WeightedDist(const wchar_t* pSrc,
+    word32 lSrcLen,
+    const wchar_t* pTarget,
+    word32 lTargetLen) const;
+};
+
+#endif
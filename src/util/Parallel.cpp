@@ -0,0 +1,82 @@
+// Parallel.cpp
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#include <vcl.h>
+#include <System.Threading.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <vector>
+#pragma hdrstop
+
+#include "Parallel.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+word32 GetNumWorkerThreads(void)
+{
+  return std::max(1, TThread::ProcessorCount);
+}
+//---------------------------------------------------------------------------
+void ParallelFor(word32 lNumItems,
+  const std::function<void(word32)>& func,
+  word32 lMaxThreads)
+{
+  if (lNumItems == 0)
+    return;
+
+  word32 lNumThreads = (lMaxThreads != 0) ? lMaxThreads : GetNumWorkerThreads();
+  lNumThreads = std::min(lNumThreads, lNumItems);
+
+  std::atomic<word32> nextIndex(0);
+  std::atomic<bool> abortFlag(false);
+  std::exception_ptr pFirstError;
+  std::mutex errorLock;
+
+  auto worker = [&]() {
+    try {
+      word32 lIndex;
+      while (!abortFlag && (lIndex = nextIndex++) < lNumItems)
+        func(lIndex);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(errorLock);
+      if (!pFirstError)
+        pFirstError = std::current_exception();
+      abortFlag = true;
+    }
+  };
+
+  std::vector<_di_ITask> tasks;
+  tasks.reserve(lNumThreads - 1);
+  for (word32 i = 1; i < lNumThreads; i++)
+    tasks.push_back(TTask::Run(worker));
+
+  worker();
+
+  for (auto& pTask : tasks)
+    pTask->Wait();
+
+  if (pFirstError)
+    std::rethrow_exception(pFirstError);
+}
+//---------------------------------------------------------------------------
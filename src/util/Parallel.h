@@ -0,0 +1,43 @@
+// Parallel.h
+//
+// PASSWORD TECH
+// Copyright (c) 2002-2025 by Christian Thoeing <c.thoeing@web.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//---------------------------------------------------------------------------
+#ifndef ParallelH
+#define ParallelH
+//---------------------------------------------------------------------------
+#include <functional>
+#include "types.h"
+
+// returns number of worker threads to be used for parallel processing
+// (= number of logical processors)
+word32 GetNumWorkerThreads(void);
+
+// calls a function for each index in the range [0, lNumItems) using a pool
+// of worker tasks; the calling thread also acts as a worker. Indices are
+// distributed dynamically, so the function must not depend on the order of
+// execution. If the function throws, remaining items are skipped and the
+// first exception is rethrown in the calling thread.
+// -> number of items
+// -> function to call for each item index
+// -> max. number of threads (0 = GetNumWorkerThreads())
+void ParallelFor(word32 lNumItems,
+  const std::function<void(word32)>& func,
+  word32 lMaxThreads = 0);
+
+#endif
@@ -243,19 +243,19 @@ void SendKeys::SendComplexString(const WString& sStr,
               int nIdx = -it->second;
 
               if (pPasswDbEntry && pPasswDb) {
-                const SecureWString* psSrc;
+                const wchar_t* pwszSrc;
                 SecureWString sPassw;
                 if (nIdx == PasswDbEntry::PASSWORD && !pPasswDbEntry->HasPlaintextPassw()) {
                   sPassw = pPasswDb->GetDbEntryPassw(*pPasswDbEntry);
-                  psSrc = &sPassw;
+                  pwszSrc = sPassw.c_str();
                 }
                 else
-                  psSrc = &pPasswDbEntry->Strings[nIdx];
-                if (!psSrc->IsStrEmpty()) {
+                  pwszSrc = pPasswDbEntry->Strings[nIdx].c_str();
+                if (*pwszSrc != '\0') {
                   if (pDest != nullptr)
-                    AddString(psSrc->c_str(), *pDest);
+                    AddString(pwszSrc, *pDest);
                   else
-                    SendString(psSrc->c_str());
+                    SendString(pwszSrc);
                 }
               }
               else {